@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <sstream>
+#include <cstring>
+
+#include "definitions.h"
+#include "database_type.hpp"
+#include "path-oram/definitions.h"
+
+
+/**
+ * @brief This struct defines the leaf pages used by the AVLTree if the index mode LEAF_PAGES is set.
+ * A leaf page packs up to pageSize consecutive records of one column into a single ORAM block. The records in a page are sorted by the key of this column and the nodeHash.
+ * The pages of one column form a linked list (via next), which is followed during range scans instead of the next pointers of single AVLTreeNodes.
+ * Only the keys and the nodeHash of each record are stored, as these are the values returned by range queries.
+ *
+ * Example (pageSize 3, column 0):
+ *  Page 1 (count 3): [1-h1, 2-h7, 2-h9] -> Page 4 (count 2): [5-h2, 7-h3, -] -> NULL
+ *
+ */
+
+#define NULL_PTR (ulong)0
+
+namespace DOSM{
+
+using namespace PathORAM;
+
+
+struct LeafPage {
+
+    ulong pageID;
+    ulong next;
+    number count;
+
+    vector<vector<db_t>> keys; //one slot per record, only the first count slots are valid
+    vector<size_t> nodeHashes;
+    bool empty;
+
+    number pageSize;
+    ulong numColumns;
+    vector<AType> columnFormat;
+
+    LeafPage();
+    LeafPage(vector<AType> columnFormat, number pageSize);
+    LeafPage(ulong pageID, vector<AType> columnFormat, number pageSize);
+    LeafPage(bytes serializedPage, bool dummy, vector<AType> columnFormat, number pageSize);
+
+    bytes serialize();
+    bytes padToBlockSize(number blockSize);
+
+    string toString(ulong column=0);
+};
+
+number getPageBytesWhenSerialized(vector<AType> columnFormat, number pageSize);
+
+bool recordSmaller(db_t key1, size_t hash1, db_t key2, size_t hash2);
+
+tuple<LeafPage,LeafPage,bool> insertIntoPage(LeafPage page, vector<db_t> key, size_t nodeHash, ulong column, ulong newPageID);
+bool removeFromPage(LeafPage *page, db_t key, size_t nodeHash, ulong column, bool execute, vector<db_t> *removedRecord);
+tuple<LeafPage,LeafPage,bool> mergePages(LeafPage page, LeafPage nextPage, bool execute);
+
+}
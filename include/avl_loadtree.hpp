@@ -1,3 +1,4 @@
+#pragma once
 //#include "database_type.hpp"
 #include "avl_treenode.hpp"
 #include "globals.hpp"
@@ -5,11 +6,11 @@
 
 namespace DOSM{
 using namespace MENHIR;
-tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(vector<vector<db_t>> *inputData, size_t num, size_t valueSize, vector<AType> columnFormat, size_t oramBlockSize);
+tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(vector<vector<db_t>> *inputData, size_t num, size_t valueSize, vector<AType> columnFormat, size_t oramBlockSize, vector<size_t> *nodeHashes=nullptr, bool augmented=false, ulong aggregateColumn=0);
 //void loadTreeBulkNonObliv(size_t num, AVLTree *avl_tree);
-tuple<ulong,vector<AVLTreeNode>> buildTreeFromSortedList(vector<AVLTreeNode>  allNodes, int sortIndex);
+tuple<ulong,vector<AVLTreeNode>> buildTreeFromSortedList(vector<AVLTreeNode>  allNodes, int sortIndex, ulong aggregateColumn=0);
 //ulong buildTreeFromSortedList(vector<AVLTreeNode>  allNodes, int sortIndex);
-tuple<ulong,int> updateTreeConstruction(vector<AVLTreeNode> *nodes, int start,int sizeSubArray, int index);
+tuple<ulong,int,double> updateTreeConstruction(vector<AVLTreeNode> *nodes, int start,int sizeSubArray, int index, ulong aggregateColumn=0);
 
 //void createTreeNonObliv(vector<vector<db_t>> records,AVLTree *avl_tree);
 
@@ -4,6 +4,7 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <queue>
 #include <string>
 #include <cmath>
@@ -13,7 +14,10 @@
 #include "definitions.h"
 #include "database_type.hpp"
 #include "avl_treenode.hpp"
+#include "avl_leafpage.hpp"
+#include "avl_ranklayout.hpp"
 #include "avl_loadtree.hpp"
+#include "concurrent_oram.hpp"
 #include "path-oram/definitions.h"
 #include "path-oram/oram.hpp"
 #include "path-oram/position-map-adapter.hpp"
@@ -33,6 +37,7 @@ using namespace PathORAM;
 
 class AVLTree {
     uint treeSize;
+    number numNodeTombstones=0; //number of nodes that are marked as deleted (tombstone mode), they are still counted in treeSize
     vector<ulong> ptrRoot;
     uint maxCapacity;
     std::queue<ulong> availableBlockNumbers;
@@ -46,6 +51,10 @@ class AVLTree {
     //for padding and dummy operations
     bytes nullNodeBytes;
 
+    //if augmented, each node stores the number of nodes and the sum of aggregateColumn of its subtrees, so aggregates over a range need two padded descents (see aggregateInterval)
+    bool augmented=false;
+    ulong aggregateColumn=0;
+
     //if USE_ORAM is true
     shared_ptr<PathORAM::ORAM> oram;  //make_shared ensures that the object is allocated on the heap
     number ORAM_BLOCK_SIZE; 
@@ -54,10 +63,32 @@ class AVLTree {
     number STASH_FACTOR=4ull;
     number BATCH_SIZE= 1ull;    				
     number LEN_PADDING=0ull;
+    //if set, all node accesses go through this thread-safe front-end, so multiple threads can run read-only operations at the same time
+    shared_ptr<ConcurrentORAM> concurrentOram;
+
+    //if indexMode is LEAF_PAGES, the records of each column are additionally packed into leaf pages stored in a separate ORAM
+    INDEX_MODE_T indexMode=AVL_ONLY;
+    shared_ptr<PathORAM::ORAM> pageOram;
+    number PAGE_BLOCK_SIZE;
+    number pageSize=16ull;
+    number maxPages;
+    std::queue<ulong> availablePageNumbers;
+    vector<vector<pair<db_t,size_t>>> fenceKeys; //for each column the smallest record (key, nodeHash) of every page in the order of the linked list
+    vector<vector<ulong>> fencePages; //for each column the IDs of all pages in the order of the linked list
+    bytes nullPageBytes;
+
+    //if indexMode is RANK_LAYOUT, the records of each column are additionally stored sorted by rank in a separate ORAM
+    shared_ptr<PathORAM::ORAM> rankOram;
+    number RANK_BLOCK_SIZE;
+    number rankCapacity; //number of ranks reserved per column
+    number rankSize=0; //number of ranks used by the current layout, identical for all columns
+    vector<RankRecord> rankBuffer; //records inserted since the last rebuild
+    number numRankTombstones=0; //number of deletes since the last rebuild
+    bytes nullRankBytes;
 
     //ORAM operations
     ulong getNewORAMID();
-    void deleteNodeORAM(ulong nodePtr); 
+    void deleteNodeORAM(ulong nodePtr, bool dummy=false); 
     
     //Inserstion and Rebalancing
     void rightRotate(AVLTreeNode *node,ulong nodePtr, AVLTreeNode *L, ulong column);
@@ -67,19 +98,22 @@ class AVLTree {
     /*tuple<AVLTreeNode ,ulong,uint,uint,uint> 
             insertHelper(db_t key, size_t nodeHash, uchar* data, ulong nodePtr);*/
     void insertHelper(vector<db_t> key, size_t nodeHash, bytes value, ulong nodeID);
-    tuple<vector<AVLTreeNode>,vector<bool>, bool, ulong,ulong> insertHelper_findParent( int column, AVLTreeNode newNode);
-    tuple<ulong,ulong,ulong, int>  insertHelper_updateParents(int column, AVLTreeNode newNode, vector<AVLTreeNode> nodes, vector<bool> lORr, bool toInsert);
-    void insertHelper_updateNext(ulong nodeID, int column, ulong prePtr,ulong nextIDIfFirst);
-    void insertHelper_rebalance(uint column, ulong balance_n, ulong balance_child, ulong balance_childschild, int balanceType); 
+    void insertHelper_column(ulong column, AVLTreeNode *newNode, unordered_map<ulong,AVLTreeNode> *fragment);
+    tuple<vector<AVLTreeNode>,vector<bool>, bool, ulong,ulong> insertHelper_findParent( int column, AVLTreeNode newNode, unordered_map<ulong,AVLTreeNode> *fragment=nullptr);
+    tuple<ulong,ulong,ulong, int>  insertHelper_updateParents(int column, AVLTreeNode newNode, vector<AVLTreeNode> *nodes, vector<bool> lORr, bool toInsert);
+    void insertHelper_updateNext(AVLTreeNode *newNode, int column, vector<AVLTreeNode> *nodes, ulong prePtr,ulong nextIDIfFirst);
+    void insertHelper_rebalance(uint column, vector<AVLTreeNode> *nodes, AVLTreeNode *newNode, ulong balance_n, ulong balance_child, ulong balance_childschild, int balanceType); 
     tuple<AVLTreeNode ,ulong,uint>  balance(AVLTreeNode node, ulong nodePtr, ulong column);
+
+    //Batch Insertion
+    number insertBatch_prefetch(ulong column, vector<RankRecord> batch, unordered_map<ulong,AVLTreeNode> *fragment, int pad);
+    AVLTreeNode getNodeFragment(ulong nodePtr, unordered_map<ulong,AVLTreeNode> *fragment);
     
     //Deletion
-    void  deleteHelper(db_t key, size_t nodeHash, ulong column);
+    bool  deleteHelper(db_t key, size_t nodeHash, ulong column, vector<db_t> *removedKeys);
     tuple<ulong, vector<AVLTreeNode >, vector<ulong>,vector<bool>>  deleteHelper_findNode(db_t key, size_t nodeHash, ulong column);
-    tuple<ulong,int,db_t> deleteHelper_findReplacement(ulong deletePtr,AVLTreeNode delNode, ulong column);
-    ulong findReplacement_twoSubtrees(int pad, ulong deletePtr,AVLTreeNode delNode, ulong column, bool dummyExc);
-    void deleteHelper_updateNodes(  ulong deletePtr, ulong repPtr, int repHeight, db_t repKey, 
-                                     vector<AVLTreeNode > nodes, vector<ulong> ptrsNodes,vector<bool> lORr,ulong column); 
+    void deleteHelper_removeNode(ulong deletePtr, AVLTreeNode delNode, ulong column);
+    void deleteHelper_updateNext(AVLTreeNode delNode, ulong column);
 
     //Find Functions
     tuple<vector<db_t>,bool> findNodeHelper(db_t key, size_t nodeHash, ulong column);
@@ -87,11 +121,33 @@ class AVLTree {
     vector<AVLTreeNode > findIntervalHelperOblix(db_t key,int i, int j,ulong column);
     vector<AVLTreeNode > findIntervalHelperOblix_volumePadded(db_t startKey,  int si,  db_t endKey,int ei,ulong estimate, ulong column);
     
-    DBT::dbResponse  findIntervalHelperMenhir(db_t startKey, db_t endKey,  ulong column,number estimate);
+    number findIntervalHelperMenhir(db_t startKey, db_t endKey,  ulong column,number estimate, DBT::recordVisitor visit);
+
+    //Leaf Pages
+    void initLeafPages(vector<vector<db_t>> records, vector<size_t> nodeHashes);
+    ulong getNewPageID();
+    LeafPage getPageORAM(ulong pageID, bool dummy=false);
+    void putPageORAM(LeafPage page, bool dummy=false);
+    ulong findPageIndex(db_t key, size_t nodeHash, ulong column);
+    void insertLeafPages(vector<db_t> key, size_t nodeHash);
+    void deleteLeafPages(db_t key, size_t nodeHash, ulong column);
+    number findIntervalHelperLeafPages(db_t startKey, db_t endKey, ulong column, number estimate, DBT::recordVisitor visit);
+
+    //Rank Layout
+    void buildRankLayout(vector<RankRecord> records);
+    void rebuildRankLayout();
+    number getRankBlockID(ulong column, number rank);
+    RankRecord getRankRecordORAM(ulong column, number rank, bool dummy=false);
+    vector<RankRecord> getRankRecordsORAM(ulong column, number firstRank, number num);
+    number findRank(db_t key, size_t nodeHash, ulong column);
+    void insertRankLayout(vector<db_t> key, size_t nodeHash);
+    void deleteRankLayout(db_t key, size_t nodeHash, ulong column);
+    number findIntervalHelperRankLayout(db_t startKey, db_t endKey, ulong column, number estimate, DBT::recordVisitor visit);
 
 
     // Util
     int getPad();
+    AVLTreeNode selectNode(bool condition, AVLTreeNode first, AVLTreeNode second);
     #ifdef NDEBUG
         shared_ptr<PathORAM::ORAM> getORAM();
         AVLTreeNode getNodeORAM(ulong nodeptr, bool dummy=false);
@@ -102,13 +158,21 @@ class AVLTree {
 
 
 public:
-    AVLTree(vector<AType> columnFormat, size_t sizeValue, number capacity, bool USE_ORAM=true);
-    AVLTree(vector<AType> columnFormat,  size_t sizeValue, number ORAM_LOG_CAPACITY,number ORAM_Z, number STASH_FACTOR, number BATCH_SIZE, vector<vector<db_t>> *inputData, size_t numDatapointsAtStart, bool USE_ORAM=true );
-    AVLTree(vector<AType> cF, size_t vSize, number capacity, number ORAM_Z, number STASH_FACTOR, number BATCH_SIZE, bool USE_ORAM);
+    AVLTree(vector<AType> columnFormat, size_t sizeValue, number capacity, bool USE_ORAM=true, INDEX_MODE_T indexMode=AVL_ONLY);
+    AVLTree(vector<AType> columnFormat,  size_t sizeValue, number ORAM_LOG_CAPACITY,number ORAM_Z, number STASH_FACTOR, number BATCH_SIZE, vector<vector<db_t>> *inputData, size_t numDatapointsAtStart, bool USE_ORAM=true, INDEX_MODE_T indexMode=AVL_ONLY, vector<size_t> *inputHashes=nullptr);
+    AVLTree(vector<AType> cF, size_t vSize, number capacity, number ORAM_Z, number STASH_FACTOR, number BATCH_SIZE, bool USE_ORAM, INDEX_MODE_T indexMode=AVL_ONLY);
 
     ~AVLTree();
 
     number getORAMBLOCKSIZE();
+    number getORAMLogCapacity();
+    number getCapacity();
+    void growORAM();
+    static int getMaxHeight(number treeSize);
+    double measureAccessTime(number numAccesses);
+    void setConcurrentAccess(bool enable);
+    double getMeanBatchSize();
+    INDEX_MODE_T getIndexMode();
 
 
 
@@ -117,13 +181,17 @@ public:
     
     size_t insert(vector<db_t> key, bytes value);
     size_t insert(vector<db_t> key);
+    vector<size_t> insertBatch(vector<vector<db_t>> keys);
     #ifndef NDEBUG
         void insert(vector<db_t> key, size_t valueHash);
     #endif
 
     
     //the whole node will be deleted
-    void deleteEntry(db_t key, size_t nodeHash, ulong column);
+    bool deleteEntry(db_t key, size_t nodeHash, ulong column, vector<db_t> *removedKeys=nullptr);
+    //tombstone mode: the node is only marked as deleted
+    bool markDeleted(db_t key, size_t nodeHash, ulong column, vector<db_t> *removedKeys=nullptr);
+    number getNumTombstones();
 
     bool empty() const;
     size_t size();
@@ -133,6 +201,11 @@ public:
 
 
     DBT::dbResponse findIntervalMenhir(db_t startKey, db_t endKey, ulong column, number estimate);
+    number scanInterval(db_t startKey, db_t endKey, ulong column, number estimate, DBT::recordVisitor visit);
+    tuple<number,double> aggregateInterval(db_t startKey, db_t endKey, ulong column);
+    tuple<number,double> aggregateBelow(db_t bound, bool inclusive, ulong column);
+    bool isAugmented();
+    vector<RankRecord> exportRecords();
     
     
 
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <sstream>
+#include <cstring>
+
+#include "definitions.h"
+#include "database_type.hpp"
+#include "path-oram/definitions.h"
+
+
+/**
+ * @brief This struct defines the records of the rank addressed layout used by the AVLTree if the index mode RANK_LAYOUT is set.
+ * For each column, all records are stored sorted by (key, nodeHash) in consecutive ORAM blocks, so the record with rank r in column c is stored in block c*rankCapacity+r+2.
+ * As the IDs of the following records are known in advance, range scans can fetch multiple records with one ORAM::multiple call.
+ * Records that are deleted are not removed but marked as deleted (valid=false) until the layout is rebuilt.
+ *
+ * Example (column 0):
+ *  rank:   0      1      2      3
+ *  record: [1-h1, 2-h7, 2-h9 (deleted), 5-h2]
+ *
+ */
+
+namespace DOSM{
+
+using namespace PathORAM;
+
+
+struct RankRecord {
+
+    vector<db_t> keys;
+    size_t nodeHash;
+    bool valid;
+
+    ulong numColumns;
+    vector<AType> columnFormat;
+
+    RankRecord();
+    RankRecord(vector<AType> columnFormat);
+    RankRecord(vector<db_t> keys, size_t nodeHash, vector<AType> columnFormat);
+    RankRecord(bytes serializedRecord, vector<AType> columnFormat);
+
+    bytes serialize();
+    string toString(ulong column=0);
+};
+
+number getRankRecordBytesWhenSerialized(vector<AType> columnFormat);
+
+bool rankRecordSmaller(RankRecord a, RankRecord b, ulong column);
+void obliviousSortRecords(vector<RankRecord> *records, ulong column);
+
+}
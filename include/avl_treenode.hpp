@@ -56,6 +56,15 @@ struct AVLTreeNode {
     bytes value;
     size_t nodeHash;
     bool empty;
+    bool tombstone; //if true, the node was deleted in tombstone mode and is skipped by scans until the tree is rebuilt
+
+    //subtree aggregates (see USE_SUBTREE_AGGREGATES): for each column the number of nodes and the sum of the aggregated column in the left and right subtree.
+    //They are only serialized if augmented is set.
+    bool augmented;
+    vector<number> lCount;
+    vector<number> rCount;
+    vector<double> lSum;
+    vector<double> rSum;
 
     ulong numColumns;
     vector<AType> columnFormat;    
@@ -73,10 +82,13 @@ struct AVLTreeNode {
                 vector<AType> columnFormat,ulong nodeID);
 
     
-    AVLTreeNode(bytes serializedNode,bool dummy, vector<AType> columnFormat, size_t sizeValue);
+    AVLTreeNode(bytes serializedNode,bool dummy, vector<AType> columnFormat, size_t sizeValue, bool augmented=false);
 
+    void resetAggregates();
     uint height(ulong column=0);
     int balanceFactor(ulong column=0);
+    number subtreeCount(ulong column);
+    double subtreeSum(ulong column, ulong aggregateColumn);
     bytes serialize();
     bytes padToBlockSize(number blockSize);
 
@@ -88,7 +100,7 @@ struct AVLTreeNode {
 
 };
 
-number getNumBytesWhenSerialized(vector<AType> columnFormat, size_t sizeValue);
+number getNumBytesWhenSerialized(vector<AType> columnFormat, size_t sizeValue, bool augmented=false);
 
 size_t getNodeHash(vector<db_t> key, bytes value, ulong r);
 
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include "definitions.h"
+#include "utility.hpp"
+#include "path-oram/definitions.h"
+#include "path-oram/oram.hpp"
+
+
+/**
+ * @brief This file contains a thread-safe front-end for a PathORAM::ORAM. PathORAM::ORAM has no internal synchronization,
+ * so without the front-end each ORAM may only be accessed from one thread.
+ * Threads put their requests into a queue and receive a future. A dispatcher thread takes up to batchSize requests from the queue at once,
+ * executes them with one ORAM::multiple call and resolves the futures. Requests are executed in the order they were queued.
+ *
+ */
+
+namespace DOSM{
+
+using namespace PathORAM;
+
+class ConcurrentORAM {
+
+    struct Request {
+        number block;
+        bytes data; //empty for reads
+        promise<bytes> response;
+    };
+
+    shared_ptr<PathORAM::ORAM> oram;
+    number batchSize;
+
+    deque<unique_ptr<Request>> requests;
+    mutex lock;
+    condition_variable wakeUp;
+    bool stop=false;
+    thread dispatcher;
+
+    number numBatches=0;
+    number numRequests=0;
+
+    future<bytes> enqueue(number block, bytes data);
+    void run();
+
+public:
+    ConcurrentORAM(shared_ptr<PathORAM::ORAM> oram, number batchSize);
+    ~ConcurrentORAM();
+
+    future<bytes> get(number block);
+    future<bytes> put(number block, bytes data);
+    double getMeanBatchSize();
+};
+
+}
@@ -2,6 +2,7 @@
 
 #include <climits>
 #include <vector>
+#include <functional>
 #include <string>
 #include <stdexcept>
 #include <sstream>
@@ -150,7 +151,7 @@ class db_t {
             }
 
 
-            bool operator>(const db_t& b) {
+            bool operator>(const db_t& b) const {
                 if(isFloat==b.isFloat){
                     if(isFloat){
                         return val.f>b.val.f;
@@ -163,7 +164,7 @@ class db_t {
             }
 
 
-            bool operator<=(const db_t& b) {
+            bool operator<=(const db_t& b) const {
                 if(isFloat==b.isFloat){
                     if(isFloat){
                         return val.f<=b.val.f;
@@ -175,7 +176,7 @@ class db_t {
                 }
             }
 
-            bool operator>=(const db_t& b) {
+            bool operator>=(const db_t& b) const {
                 if(isFloat==b.isFloat){
                     if(isFloat){
                         return val.f>=b.val.f;
@@ -187,7 +188,7 @@ class db_t {
                 }
             }
 
-            bool operator!=(const db_t& b) {
+            bool operator!=(const db_t& b) const {
                 if(isFloat==b.isFloat){
                     if(isFloat){
                         return val.f!=b.val.f;
@@ -199,7 +200,7 @@ class db_t {
                 }
             }
 
-            bool operator==(const db_t& b) {
+            bool operator==(const db_t& b) const {
                 if(isFloat==b.isFloat){
                     if(isFloat){
                         return val.f==b.val.f;
@@ -222,6 +223,7 @@ namespace DBT{
     using namespace std;
     using number = unsigned long long;
     using dbResponse=vector<tuple<vector<db_t>,bool>>;
+    using recordVisitor=function<void(const vector<db_t>&,bool)>; //called for each record of a scan, the bool indicates wether the record is a dummy
 
 
     string aTypeToString(AType type);
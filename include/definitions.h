@@ -53,7 +53,6 @@ namespace MENHIR
 	using uchar	 = unsigned char;
 	using uint	 = unsigned int;
 	using bytes	 = vector<uchar>;
-	using npmap	 = map<pair<number,number>,number>;
     using profile = tuple<bool, number, number, number>;
     using measurement = tuple<number, number, number,number, number, number, number, number>;
     using queryResult = tuple<vector<string>,number, chrono::steady_clock::rep, number>;
@@ -121,4 +120,11 @@ enum DATASOURCE_T{
 		DATASOURCE_T_INVALID
 };
 
+enum INDEX_MODE_T{
+		AVL_ONLY,
+		LEAF_PAGES,
+		RANK_LAYOUT,
+		INDEX_MODE_T_INVALID
+};
+
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "definitions.h"
 #include "struct_error.hpp"
 #include "database_type.hpp"
@@ -15,18 +17,56 @@ double laplace_mech(double value, double sensitivity, double epsilon);
 vector<db_t> clipping(vector<db_t> data, db_t lower, db_t upper);
 vector<double> clipping(vector<double> data, double lower, double upper);
 
-tuple<double,Error>  dp_count(vector<db_t> data, vector<bool> ignoring, double epsilon, db_t lower, db_t upper, bool clip);
-tuple<double,Error>  dp_count(vector<double> data, vector<bool> ignoring, double epsilon, double lower, double upper, bool clip);
+tuple<double,Error>  dp_count(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon, db_t lower, db_t upper, bool clip);
+tuple<double,Error>  dp_count(const vector<double> &data, const vector<bool> &ignoring, double epsilon, double lower, double upper, bool clip);
+
+/**
+ * @brief Sums computed by fused_sums() in one pass over a column. All sums only contain values that are not ignored.
+ * 
+ */
+struct FusedSums {
+    double count=0.0;
+    double sum=0.0; //sum of the clipped values
+    double sumAbsDeviation=0.0; //sum of |clipped value - center|
+};
+
+vector<double> toDoubleArray(const vector<db_t> &data);
+vector<MENHIR::uchar> toMaskArray(const vector<bool> &ignoring);
+FusedSums fused_sums(const double *values, const MENHIR::uchar *ignoring, size_t n, double lower, double upper, double center=0.0);
 
+tuple<double,Error>  dp_sum_int(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon, db_t lower, db_t upper, bool clip);
+double kahan_sensitivity(double lower, double upper);
+tuple<double,Error>  dp_sum_double(const vector<double> &data, const vector<bool> &ignoring, double epsilon, double lower, double upper, bool clip);
+tuple<double,Error>  dp_sum(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon, db_t lower, db_t upper, bool clip = true);
+
+tuple<double,Error>  dp_mean(const vector<db_t> &data, const vector<bool> &ignoring,  double epsilon, db_t lower, db_t upper, bool clip=true);
+tuple<double,Error> dp_var(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon, int ddof, db_t lower, db_t upper, bool clip=true);
+
+//for aggregates that were computed without retrieving records
+tuple<double,Error> dp_count_aggregate(DBT::number count, double epsilon);
+tuple<double,Error> dp_sum_aggregate(double sum, AType type, double epsilon, db_t lower, db_t upper);
+tuple<double,Error> dp_mean_aggregate(DBT::number count, double sum, AType type, double epsilon, db_t lower, db_t upper);
+/**
+ * @brief Running count and sum of the values of one column. Used for computing COUNT, SUM and MEAN while the records are streamed from the OSMs, without storing them.
+ * Values are clipped to [lower, upper] as in dp_sum(), floating point values are added with compensated (Kahan) summation.
+ * 
+ */
+struct StreamingAggregate {
+    AType type;
+    db_t lower;
+    db_t upper;
+    DBT::number count=0;
+    long long intSum=0;
+    double sum=0.0;
+    double compensation=0.0;
 
-tuple<double,Error>  dp_sum_int(vector<db_t> data, vector<bool> ignoring, double epsilon, db_t lower, db_t upper, bool clip);
-double kahan_sum(vector<double> vec, vector<bool> ignoring);
-double pairwise_sum(vector<double> vec, vector<bool> ignoring);
-tuple<double,Error>  dp_sum_double(vector<double> data, vector<bool> ignoring, double epsilon, double lower, double upper, bool clip);
-tuple<double,Error>  dp_sum(vector<db_t> data, vector<bool> ignoring, double epsilon, db_t lower, db_t upper, bool clip = true);
+    StreamingAggregate(AType type, db_t lower, db_t upper);
+    void add(db_t value, bool ignore);
+    void merge(const StreamingAggregate &other);
+    double getSum() const;
+};
 
-tuple<double,Error>  dp_mean(vector<db_t> data, vector<bool> ignoring,  double epsilon, db_t lower, db_t upper, bool clip=true);
-tuple<double,Error> dp_var(vector<db_t> data, vector<bool> ignoring, double epsilon, int ddof, db_t lower, db_t upper, bool clip=true);
+tuple<double,Error> dp_quantile(function<double(double)> rankDifference, double lower, double upper, double resolution, double epsilon);
 
 
 
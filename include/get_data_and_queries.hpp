@@ -16,6 +16,7 @@ namespace MENHIR{
    	using genType2	 = vector<db_t>;
  
     void getDataset();
+    void addQueryOutputs();
     void generateFromReal();
     void generateArtificial();
 
@@ -101,6 +101,7 @@ namespace MENHIR{
     
     extern number NUM_QUERIES;
     extern AggregateFunc QUERY_FUNCTION;
+    extern vector<AggregateFunc> ADDITIONAL_QUERY_FUNCTIONS;
     extern uint QUERY_INDEX;
     extern uint WHERE_INDEX;//only applicable if there are more than one column
     extern bool POINT_QUERIES;
@@ -135,6 +136,34 @@ namespace MENHIR{
     extern bool USE_ORAM;
     extern number BATCH_SIZE;
 
+    extern INDEX_MODE_T INDEX_MODE;
+    extern number LEAF_PAGE_SIZE;
+    extern number RANK_REBUILD_THRESHOLD;
+
+    extern bool USE_LSM;
+    extern number LSM_BUFFER_SIZE;
+    extern number LSM_SIZE_RATIO;
+    extern bool USE_TOMBSTONES;
+    extern double TOMBSTONE_RATIO;
+    extern number WORKER_POOL_SIZE;
+    extern bool PIN_WORKERS;
+    extern number QUERIES_IN_FLIGHT;
+    extern number NUM_REPLICAS;
+    extern number ORAM_CONCURRENCY;
+    extern bool AUTO_SHARDING;
+    extern number RAM_BUDGET;
+    extern number PREDICTED_QUERY_TIME;
+    extern bool USE_SPARE_OSM;
+    extern double SPARE_OSM_THRESHOLD;
+    extern number GROW_LOG_CAPACITY;
+    extern double COMPACTION_FILL_RATIO;
+    extern bool USE_SHARD_HANDLES;
+    extern number SHARD_HANDLE_DUMMIES;
+    extern number HISTOGRAM_FANOUT;
+    extern bool CHECK_HISTOGRAMS;
+    extern bool USE_SUBTREE_AGGREGATES;
+    extern number AGGREGATE_COLUMN;
+    extern bool STREAM_RESULTS;
    
     extern bool USE_GAMMA;
 
@@ -158,12 +187,10 @@ namespace MENHIR{
     extern vector<number> *INSERTION_MEASUREMENTS;
     extern vector<number> *DELETION_MEASUREMENTS;    
     extern number INSERTION_TOTAL;
+    extern number DELETION_TOTAL;
+    extern number QUERYING_TOTAL;
     extern vector<measurement> *QUERY_MEASUREMENTS;
     extern number NUM_THREADS;
     extern bool DELETION;
-    extern chrono::steady_clock::time_point timestampBeforeORAMs;
-    extern chrono::steady_clock::time_point timestampAfterORAMs;			 
-    extern chrono::steady_clock::time_point startTimeQuery;
-    extern chrono::steady_clock::time_point endTimeQuery;
 
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string>
 #include <thread>
 #include <future>
+#include <atomic>
 
 
 #include "definitions.h"
@@ -12,6 +13,9 @@
 #include "avl_multiset.hpp"
 #include "linear_db.hpp"
 #include "volume_sanitizer_utility.hpp"
+#include "worker_pool.hpp"
+#include "record_handle.hpp"
+#include "struct_querying.hpp"
 
 /**
  * @brief This file contains functions for parallelized access to the AVLTrees. Each Tree is stored in one ORAM. 
@@ -24,35 +28,141 @@
 using namespace PathORAM;
 using namespace DBT;
 using namespace MENHIR;
-using hist_t=vector<pair<db_t,number>>;
+
+/**
+ * @brief Histogram of one column of an OSM. It is stored as a structure of arrays so that getTotalFromHistograms() can scan it without branches.
+ * The buckets are stored as double, which represents every INT and FLOAT value exactly.
+ * If HISTOGRAM_FANOUT is set, the histogram is hierarchical: counts is a k-ary prefix-count tree stored level by level, starting with the buckets.
+ * Each node holds the number of data points in the buckets below it. The layout only depends on the domain, not on the data.
+ * The tree has one leaf per bucket, so it speeds up range counts but needs about as much memory as the flat histogram (it does not store the bucket values).
+ * Coarser leaves would save memory, but the volume padding relies on exact counts per OSM.
+ * 
+ */
+struct Histogram {
+    vector<double> values; //lowest value of each bucket, only for flat histograms
+    vector<number> counts; //number of data points in each bucket, or in each node of the tree for hierarchical histograms
+    number fanout=0; //0 for flat histograms
+    vector<number> levelOffsets; //index of the first node of each level in counts, the last entry is the number of nodes (only for hierarchical histograms)
+    number numBuckets=0;
+    double minValue=0.0;
+    double resolution=1.0;
+    size_t size() const { return counts.size(); }
+};
+using hist_t=Histogram;
+
+/**
+ * @brief A query that was dispatched to the workers of all OSMs but whose results were not collected yet.
+ * 
+ */
+struct PendingQuery {
+    vector<promise<dbResponse>> promises; //one per OSM
+    vector<future<dbResponse>> futures;
+    vector<chrono::steady_clock::time_point> finishedORAMs; //time at which each OSM finished
+    QueryTiming timing;
+};
 
 class OSMInterface {
 
+    unique_ptr<WorkerPool> workers; //OSM i is always accessed by the same worker
 
     void createNewTree();
     void createNewTreeWithDataParallel(size_t osmIndex, vector<vector<db_t>> inputSplit, size_t thisSize,promise<tuple<void *, vector<hist_t>>> *promise);
     vector<hist_t> createNewHistogram();
+    void addToHistograms(vector<hist_t> *osmHistos, vector<db_t> keys, number weight=1ull, bool masked=true);
+    number countInInterval(const hist_t &histogram, double from, double to);
+    number countBelow(const hist_t &histogram, number bucket);
 	void generateVolumeSanitizer();
+    void ensureVolumeSanitizers();
+    void prepareLastOSM();
+    void growLastOSM();
+    size_t chooseSharding();
+
+    //LSM mode: the last OSM is a small write buffer. Full buffers are merged with the newest OSMs into one OSM in the background.
+    void createNewBuffer();
+    void flushBuffer();
+    void mergeOSMsParallel(vector<DOSM::RankRecord> records, number minLogCapacity, promise<tuple<DOSM::AVLTree *, vector<hist_t>>> *promise);
+    void startMerge(size_t first, size_t last, vector<DOSM::RankRecord> records, number minLogCapacity);
+    vector<DOSM::RankRecord> exportOSMs(size_t first, size_t last);
+    void installMerge(bool wait);
+
+    //tombstone mode: OSMs with many marked records are rebuilt in the background with the same mechanism as merges.
+    //After deletions, neighbouring OSMs filled less than COMPACTION_FILL_RATIO are merged into one OSM in the same way.
+    void startCompaction();
+    bool startUnderfullMerge();
+    number getNumLive(size_t osmIndex);
+    vector<tuple<db_t,size_t,ulong>> deletesDuringMerge; //deletes that have to be applied to the result of the running merge
+
+    bool mergePending=false;
+    size_t mergeFirst=0; //the OSMs mergeFirst to mergeLast are replaced by the result of the running merge
+    size_t mergeLast=0;
+    thread mergeThread;
+    promise<tuple<DOSM::AVLTree *, vector<hist_t>>> mergePromise;
+    future<tuple<DOSM::AVLTree *, vector<hist_t>>> mergeFuture;
+
+    //read-only copies of the OSMs for the querying phase. replicas[r][i] is copy r+1 of OSM i, copy 0 is the OSM itself
+    vector<vector<DOSM::AVLTree *>> replicas;
+    atomic<size_t> nextQuery{0};
+    DOSM::AVLTree *buildTreeFromRecords(vector<DOSM::RankRecord> records, number minLogCapacity);
+    DOSM::AVLTree *getReplica(size_t osmIndex, size_t replica);
+    size_t getWorkerIndex(size_t osmIndex, size_t replica, size_t lane=0);
+    void dropReplicas();
+    tuple<number,double> aggregateOSMs(function<tuple<number,double>(DOSM::AVLTree *)> aggregate, QueryTiming *timing);
+
+    //the next OSM is created in the background once the last OSM is filled up to SPARE_OSM_THRESHOLD, a full OSM is then replaced without waiting for the new ORAM
+    void prepareSpareOSM();
+    void createSpareOSMParallel(number logCapacity, promise<tuple<void *,vector<hist_t>>> *promise);
+    void installSpareOSM();
+    bool sparePending=false;
+    thread spareThread;
+    promise<tuple<void *,vector<hist_t>>> sparePromise;
+    future<tuple<void *,vector<hist_t>>> spareFuture;
+
+    //stable IDs of the OSMs (parallel to trees) for record handles. Handles of merged OSMs are forwarded via mergedInto
+    vector<number> osmIDs;
+    number nextOSMID=0;
+    map<number,number> mergedInto;
+    unique_ptr<HandleSealer> handleSealer; //only set if USE_SHARD_HANDLES
+    size_t resolveOSM(number osmID);
+
+    //number of workers that query each copy of an OSM at the same time through its ConcurrentORAM, 1 outside of the querying phase
+    size_t numLanes=1;
+    void setConcurrentAccess(bool enable);
+    void endQuerying();
 
 public:
     size_t numOSMs;
     vector<DOSM::AVLTree *> trees;
     vector<LinearDB::LinearOblivDB *> lists;
-    size_t maxPerTree;
+    size_t maxPerTree=0;
     vector<vector<hist_t>> histograms; //one for ODB and each column one histogram 
     bool USE_ORAM=true;
     vector<VolumeSanitizer> volumeSanitizers;
 
     OSMInterface();
+    ~OSMInterface();
 
     size_t insert(vector<db_t> key);
+    vector<size_t> insertBatch(vector<vector<db_t>> keys, vector<number> *insertedInto=nullptr);
+    RecordHandle insertWithHandle(vector<db_t> key);
+    vector<RecordHandle> insertBatchWithHandles(vector<vector<db_t>> keys);
     #ifndef NDEBUG
         void insert(vector<db_t> key, size_t nodeHash);
     #endif
     void deleteEntry(db_t key, size_t nodeHash, ulong column);
+    void deleteEntry(db_t key, RecordHandle handle, ulong column);
+    void finishMerges();
+    void prepareQuerying();
+    void createReplicas();
+    size_t getNumReplicas();
 
     tuple<number,vector<number>> getTotalFromHistograms(db_t from, db_t to, size_t column);
-    void findIntervalParallel(size_t osmIndex, db_t startKey, db_t endKey, ushort column, number estimate,promise<dbResponse> *promise);
-    dbResponse findInterval(db_t startKey, db_t endKey, ushort column, vector<number> estimates);
+    number checkHistograms(bool repair);
+    void findIntervalParallel(size_t osmIndex, size_t replica, db_t startKey, db_t endKey, ushort column, number estimate, shared_ptr<PendingQuery> pending);
+    dbResponse findInterval(db_t startKey, db_t endKey, ushort column, vector<number> estimates, QueryTiming *timing=nullptr);
+    shared_ptr<PendingQuery> submitFindInterval(db_t startKey, db_t endKey, ushort column, vector<number> estimates, QueryTiming timing);
+    dbResponse collectFindInterval(shared_ptr<PendingQuery> pending);
+    number scanInterval(db_t startKey, db_t endKey, ushort column, vector<number> estimates, vector<recordVisitor> visitors, QueryTiming *timing=nullptr);
+    tuple<number,double> aggregateInterval(db_t startKey, db_t endKey, ushort column, QueryTiming *timing=nullptr);
+    tuple<number,double> aggregateBelow(db_t bound, bool inclusive, ushort column, QueryTiming *timing=nullptr);
 
 };
@@ -32,6 +32,7 @@ namespace MENHIR
 	void storeInputs(vector<Query>& QUERIES, vector<vector<db_t>> &data);
 	void loadInputs();
 	pair<number, number> avg(function<number(const measurement&)> getter);
+	number getThroughput(vector<number> *measurements);
 
 
 	void writeOutput();
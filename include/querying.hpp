@@ -4,6 +4,9 @@
 #include "struct_querying.hpp"
 #include "struct_error.hpp"
 #include  "globals_osm.hpp"
+#include "dp_query_functions.hpp"
+
+#include <deque>
 
 /**
  * @brief This file contains functions for querying the database and determining the amount of volume sanitation required.
@@ -13,8 +16,22 @@
 namespace MENHIR{
 	using namespace DBT;
 	tuple<db_t,double, Error> runQuery(Query query);
-	tuple<number,dbResponse,Error> runQueryEval(Query query);
+	vector<tuple<db_t,double, Error>> runMultiQuery(Query query);
+	tuple<number,dbResponse,Error> runQueryEval(Query query, QueryTiming *timing);
+	tuple<number,vector<number>,Error> getQueryEstimate(Query query);
+	void finishQueryEval(Query query, dbResponse allRecords);
+	vector<QueryOutput> getQueryOutputs(Query query);
+	vector<tuple<db_t,double, Error>> computeQueryOutputs(Query query, dbResponse allRecords);
+	bool streamable(Query query);
+	tuple<vector<StreamingAggregate>,ScanCounts> scanQuery(Query query, vector<number> noiseToAdd, QueryTiming *timing);
+	vector<tuple<db_t,double, Error>> computeStreamedOutputs(Query query, vector<StreamingAggregate> aggregates);
+	tuple<number,ScanCounts,Error> runQueryStreamedEval(Query query, QueryTiming *timing);
 	tuple<db_t,double, Error> computeQueryFunctionPrivate(Query query, vector<db_t> values,  vector<bool> ignoring);
+	bool answeredByAggregates(Query query);
+	tuple<db_t,double, Error> computeQueryFunctionAggregates(Query query, number count, double sum);
+	bool isQuantile(Query query);
+	double getQuantileFraction(Query query);
+	tuple<db_t,double, Error> computeQuantileAggregates(Query query, QueryTiming *timing);
 
 
 	tuple<number, vector<number>,Error> getNoisePointQuery(Query query);
@@ -23,6 +40,8 @@ namespace MENHIR{
 	tuple<number,vector<number>,Error> getTotalNoise(Query query);
 
 	void automated_querying();
-	void processMeasurement(Query query, int q, number estimate, dbResponse allRecords);
+	void finishOldestQuery(deque<tuple<Query,int,number,shared_ptr<PendingQuery>>> *inFlight, int maxTries);
+	void processMeasurement(Query query, int q, number estimate, dbResponse allRecords, QueryTiming timing);
+	void processMeasurement(Query query, int q, number estimate, ScanCounts counts, QueryTiming timing);
 
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <openssl/aes.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <stdexcept>
+
+#include "definitions.h"
+#include "utility.hpp"
+#include "path-oram/definitions.h"
+#include "path-oram/utility.hpp"
+
+
+/**
+ * @brief This file contains the handles returned for inserted records if USE_SHARD_HANDLES is set.
+ * A handle stores the nodeHash of the record and the ID of the OSM it was inserted into. The OSM ID is encrypted and authenticated
+ * with keys that never leave the enclave, so the untrusted host can neither learn the OSM of a record nor forge a handle.
+ * Deletes with a handle only access the owning OSM and SHARD_HANDLE_DUMMIES other OSMs.
+ *
+ */
+
+namespace MENHIR{
+
+using namespace PathORAM;
+
+struct RecordHandle {
+    size_t nodeHash;
+    bytes sealedOSM; //IV, encrypted OSM ID and authentication tag
+};
+
+class HandleSealer {
+
+    bytes encryptionKey;
+    bytes macKey;
+
+    bytes computeTag(size_t nodeHash, bytes::const_iterator first, bytes::const_iterator last);
+
+public:
+    HandleSealer();
+
+    RecordHandle seal(number osmID, size_t nodeHash);
+    tuple<bool,number> open(RecordHandle handle);
+};
+
+}
@@ -7,10 +7,15 @@ namespace MENHIR{
 
 	//AUTHENTICATE THIS STEP
 	pair<string,string> queryServer(string queryString,string pw);
+	int getValidExtra(AggregateFunc agg, int extra);
 	
+	pair<vector<db_t>,bool> parseCrowdRecord(string datastring);
 	size_t receiveDataFromCrowd(string datastring);
+	vector<size_t> receiveBatchFromCrowd(string datastring);
 
 	bool stopCollectionPhase(string pw);
 
 	void stopQueryPhase(string pw);
+
+	void runServer();
 }
\ No newline at end of file
@@ -19,6 +19,8 @@ namespace MENHIR{
 		COUNT ,
 		MAX_COUNT , //returns element with the hightest count - only for int, requires a width parameter otherwise using 1
 		MIN_COUNT, //returns element with the lowest count- only for int, requires a width parameter otherwise using 1
+		MEDIAN , //returns an element, the 50th percentile
+		PERCENTILE , //returns an element, requires the percentile (0 to 100) is passed
 		AggregateFunc_INVALID
 	};
 
@@ -29,6 +31,17 @@ namespace MENHIR{
 
 
 
+	/**
+	 * @brief An additional aggregate of a query. It is computed from the same records as the aggregate of the query and uses its own epsilon.
+	 * 
+	 */
+	typedef struct {
+		uint attributeIndex;
+		AggregateFunc agg;
+		double epsilon;
+		int extra; //same as Query::extra
+	} QueryOutput;
+
 	typedef struct {
 		uint attributeIndex;
 		db_t from;
@@ -39,7 +52,29 @@ namespace MENHIR{
 		db_t whereTo; 	
 		AggregateFunc agg;
 		double epsilon;
-		int extra; //only applicable if agg = MAX_COUNT or agg=VARIANCE
+		int extra; //only applicable if agg = MAX_COUNT, agg=VARIANCE or agg=PERCENTILE
+		vector<QueryOutput> outputs; //additional aggregates over the same WHERE range, answered by the same retrieval
 	} Query;
 
+	/**
+	 * @brief Number of records returned for a query, used for the measurements if the records are not stored (see STREAM_RESULTS).
+	 * 
+	 */
+	typedef struct {
+		number records; //all records including padding and noise
+		number padding; //real records outside of [from,to]
+		number noise; //dummies
+	} ScanCounts;
+
+	/**
+	 * @brief Timing context of one query. Each query carries its own context, so several queries can be in flight at the same time.
+	 * 
+	 */
+	typedef struct {
+		chrono::steady_clock::time_point start; //query was admitted
+		chrono::steady_clock::time_point beforeORAMs; //query was dispatched to the OSMs
+		chrono::steady_clock::time_point afterORAMs; //last OSM finished
+		chrono::steady_clock::time_point end; //result was computed
+	} QueryTiming;
+
 }
\ No newline at end of file
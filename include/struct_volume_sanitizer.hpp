@@ -10,6 +10,58 @@
 
 namespace MENHIR{
 
+/**
+ * @brief DP noise tree of a volume sanitizer. The noise of all nodes is stored in one contiguous array, level by level, 
+ * so the noise of node (level, bucket) is found by one offset lookup instead of a search in a map.
+ * Level 0 holds one node per bucket, each further level DP_K times fewer nodes.
+ * 
+ */
+class NoiseTree{
+	private:
+		vector<number> levelOffsets; //index of the first node of each level in values, the last entry is the number of nodes
+		vector<number> values;
+	public:
+		NoiseTree(vector<number> levelSizes){
+			levelOffsets.push_back(0);
+			for(size_t l=0;l<levelSizes.size();l++){
+				levelOffsets.push_back(levelOffsets.back()+levelSizes[l]);
+			}
+			values.assign(levelOffsets.back(), 0);
+		}
+
+		number levels() const{
+			return levelOffsets.size()-1;
+		}
+
+		number size() const{
+			return values.size();
+		}
+
+		/**
+		 * @brief Noise of a node. Nodes outside of the tree have no noise.
+		 * 
+		 * @param node : pair of level and bucket
+		 * @return number 
+		 */
+		number get(pair<number,number> node) const{
+			if(node.first>=levels() or node.second>=levelOffsets[node.first+1]-levelOffsets[node.first]){
+				return 0;
+			}
+			return values[levelOffsets[node.first]+node.second];
+		}
+
+		void set(number level, number bucket, number value){
+			values[levelOffsets[level]+bucket]=value;
+		}
+
+		double mean() const{
+			double sum=0.0;
+			for(size_t i=0;i<values.size();i++){
+				sum+=(double) values[i];
+			}
+			return (values.size()>0)? sum/(double) values.size() : 0.0;
+		}
+};
 
 class VolumeSanitizer{
 	private:
@@ -19,8 +71,8 @@ class VolumeSanitizer{
 		double dp_levels;
 		double dp_domain;
 		double dp_alpha;
-		//map<pair<number, number>, number>
-		npmap  noises;
+		//shared by all copies of the sanitizer, is not changed after it was generated
+		shared_ptr<const NoiseTree> noises=make_shared<const NoiseTree>(vector<number>());
 
 
 
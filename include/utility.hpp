@@ -33,7 +33,12 @@ namespace MENHIR
 	int toInt(DATASOURCE_T source);
 	DATASOURCE_T datasourcefromString(string dataSourceString);
 
+	string toString(INDEX_MODE_T mode);
+	int toInt(INDEX_MODE_T mode);
+	INDEX_MODE_T indexModefromString(string indexModeString);
+
 	vector<number> retieveExactlyfromString(string retrieveExactlyString);
+	string additionalQueryFunctionsToString();
 	string errToString(Error err);
 
 	void print_err(Error err, LOG_LEVEL level=WARNING);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <pthread.h>
+
+#include "definitions.h"
+#include "utility.hpp"
+
+/**
+ * @brief This file contains a pool of long-lived worker threads used by the OSMInterface to access the OSMs in parallel.
+ * Each worker has its own queue. Tasks for an OSM are always put into the queue of the same worker, so each ORAM is only accessed from one thread.
+ * Optionally, worker i is pinned to core i (modulo the number of cores).
+ *
+ */
+
+namespace MENHIR{
+
+class WorkerPool {
+
+    struct WorkerQueue {
+        deque<function<void()>> tasks;
+        mutex lock;
+        condition_variable wakeUp;
+    };
+
+    vector<thread> workers;
+    vector<unique_ptr<WorkerQueue>> queues;
+    atomic<bool> stop{false};
+
+    void run(size_t workerIndex);
+
+public:
+    WorkerPool(number numWorkers, bool pinWorkers);
+    ~WorkerPool();
+
+    size_t size();
+    future<void> submit(size_t queueIndex, function<void()> task);
+    void drain();
+};
+
+}
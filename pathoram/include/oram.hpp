@@ -32,9 +32,9 @@ namespace PathORAM
 		const number dataSize; // size of the "usable" portion of the block in bytes
 		const number Z;		   // number of blocks per bucket
 
-		const number height;  // number of tree levels
-		const number buckets; // total number of buckets
-		const number blocks;  // total number of blocks
+		number height;	// number of tree levels (grows with grow())
+		number buckets; // total number of buckets
+		number blocks;	// total number of blocks
 
 		const number batchSize; // a max number of requests to process at a time (default 1)
 
@@ -254,5 +254,29 @@ namespace PathORAM
 		 * @param data the data to bulk load
 		 */
 		void load(vector<block> &data);
+
+		/**
+		 * @brief adds a level to the tree, doubling the number of leaves and blocks
+		 *
+		 * The storage, the position map and the stash are extended (they must support extend(...)).
+		 * The stash is sized for the new height, as its bound grows with the length of a path.
+		 * No block is moved: as bucket locations are numbered level by level,
+		 * the path to leaf 2p or 2p+1 of the new tree contains the whole path to leaf p of the old tree.
+		 * Every block mapped to leaf p is remapped to one of these two leaves at random,
+		 * so each block is still on its path and is rehomed to the new level lazily,
+		 * once it is accessed and evicted again.
+		 * The new block IDs are mapped to random leaves of the new tree.
+		 *
+		 * \note
+		 * Only changes the client state (position map and stash capacity) and appends empty buckets to the storage.
+		 *
+		 * @param stashCapacity the maximum number of blocks in the stash for the new height, e.g. 3 * Z * (height + 1)
+		 */
+		void grow(const number stashCapacity);
+
+		/**
+		 * @brief the number of tree levels (logCapacity), including the levels added with grow()
+		 */
+		number getHeight() const;
 	};
 }
@@ -31,6 +31,15 @@ namespace PathORAM
 		 */
 		virtual void set(const number block, const number leaf) = 0;
 
+		/**
+		 * @brief increases the number of blocks the map can hold.
+		 * Existing mappings are kept, the new ones are undefined until set.
+		 * The default implementation throws, as not every map can be extended.
+		 *
+		 * @param newCapacity the new maximum number of blocks
+		 */
+		virtual void extend(const number newCapacity);
+
 		virtual ~AbsPositionMapAdapter() = 0;
 	};
 
@@ -42,8 +51,8 @@ namespace PathORAM
 	class InMemoryPositionMapAdapter : public AbsPositionMapAdapter
 	{
 		private:
-		number* const map;
-		const number capacity; // maximum capacity, array size
+		number* map;
+		number capacity; // maximum capacity, array size
 
 		/**
 		 * @brief helper that throws exception if out-of-bounds access occurs
@@ -63,6 +72,7 @@ namespace PathORAM
 		~InMemoryPositionMapAdapter() final;
 		number get(const number block) const final;
 		void set(const number block, const number leaf) final;
+		void extend(const number newCapacity) final;
 
 		/**
 		 * @brief write state to a binary file
@@ -61,6 +61,14 @@ namespace PathORAM
 		 */
 		virtual void remove(const number block) = 0;
 
+		/**
+		 * @brief increases the number of blocks the stash can hold.
+		 * The default implementation throws, as not every stash can be extended.
+		 *
+		 * @param newCapacity the new maximum number of blocks
+		 */
+		virtual void extend(const number newCapacity);
+
 		virtual ~AbsStashAdapter() = 0;
 
 		protected:
@@ -87,7 +95,7 @@ namespace PathORAM
 	{
 		private:
 		unordered_map<number, bytes> stash;
-		const number capacity;
+		number capacity;
 
 		/**
 		 * @brief thorows exception if an insertion of this block will cause an overflow (stash size growing beyond capacity)
@@ -115,6 +123,7 @@ namespace PathORAM
 		void update(const number block, const bytes &data) final;
 		void get(const number block, bytes &response) const final;
 		void remove(const number block) final;
+		void extend(const number newCapacity) final;
 
 		/**
 		 * @brief Returns the current size of the stash (in blocks)
@@ -129,6 +129,15 @@ namespace PathORAM
 		 */
 		void fillWithZeroes();
 
+		/**
+		 * @brief increases the number of buckets the storage can hold.
+		 * The new locations are set to zeroed bytes (as in fillWithZeroes), existing locations are not changed.
+		 * Does nothing if the storage already holds newCapacity buckets.
+		 *
+		 * @param newCapacity the new maximum number of buckets
+		 */
+		void extend(const number newCapacity);
+
 		/**
 		 * @brief whether this adapter supports batch read operations.
 		 */
@@ -160,7 +169,7 @@ namespace PathORAM
 		virtual ~AbsStorageAdapter() = 0;
 
 		protected:
-		const number capacity;		// number of buckets
+		number capacity;			// number of buckets
 		const number blockSize;		// whole bucket size (Z times (user portion + ID) + IV)
 		const number userBlockSize; // number of bytes in payload portion of block
 
@@ -196,6 +205,15 @@ namespace PathORAM
 		 * @param response this vector will be appended (back-inserted) with blocks of bytes in the order defined by locations
 		 */
 		virtual void getInternal(const vector<number> &locations, vector<bytes> &response) const;
+
+		/**
+		 * @brief actual routine that makes room for the locations up to newCapacity.
+		 * Is called by extend before capacity is updated.
+		 * The default implementation throws, as not every storage can be extended.
+		 *
+		 * @param newCapacity the new maximum number of buckets
+		 */
+		virtual void extendInternal(const number newCapacity);
 	};
 
 	/**
@@ -206,7 +224,7 @@ namespace PathORAM
 	class InMemoryStorageAdapter : public AbsStorageAdapter
 	{
 		private:
-		uchar **const blocks;
+		uchar **blocks;
 
 		public:
 		InMemoryStorageAdapter(const number capacity, const number userBlockSize, const bytes key, const number Z, const number batchLimit = 0);
@@ -216,6 +234,7 @@ namespace PathORAM
 		protected:
 		void setInternal(const number location, const bytes &raw) final;
 		void getInternal(const number location, bytes &reponse) const final;
+		void extendInternal(const number newCapacity) final;
 
 		bool supportsBatchGet() const final { return false; };
 		bool supportsBatchSet() const final { return false; };
@@ -255,6 +274,7 @@ namespace PathORAM
 		protected:
 		void setInternal(const number location, const bytes &raw) final;
 		void getInternal(const number location, bytes &reponse) const final;
+		void extendInternal(const number newCapacity) final;
 
 		bool supportsBatchGet() const final { return false; };
 		bool supportsBatchSet() const final { return false; };
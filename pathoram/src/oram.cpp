@@ -190,6 +190,38 @@ ORAM::ORAM(
 		storage->set(boost::make_iterator_range(writeRequests.begin(), writeRequests.end()));
 	}
 
+	void ORAM::grow(const number stashCapacity)
+	{
+		// the cache is empty between requests, but make sure nothing is lost
+		syncCache();
+
+		const number newHeight = height + 1;
+		const number newBlocks = ((number)1 << newHeight) * Z;
+
+		// same sizes as for a new ORAM of this height
+		storage->extend((number)1 << newHeight);
+		map->extend(newBlocks + Z);
+		stash->extend(stashCapacity);
+
+		for (number i = 0; i < blocks; ++i)
+		{
+			map->set(i, 2 * map->get(i) + getRandomULong(2));
+		}
+		for (number i = blocks; i < newBlocks; ++i)
+		{
+			map->set(i, getRandomULong((number)1 << (newHeight - 1)));
+		}
+
+		height	= newHeight;
+		buckets = (number)1 << newHeight;
+		blocks	= newBlocks;
+	}
+
+	number ORAM::getHeight() const
+	{
+		return height;
+	}
+
 	void ORAM::access(const bool read, const number block, const bytes &data, bytes &response)
 	{
 		// step 1 from paper: remap block 
@@ -36,6 +36,25 @@ namespace PathORAM
 		map[block] = leaf;
 	}
 
+	void AbsPositionMapAdapter::extend(const number newCapacity)
+	{
+		throw Exception(boost::format("this position map adapter cannot be extended (requested capacity %1%)") % newCapacity);
+	}
+
+	void InMemoryPositionMapAdapter::extend(const number newCapacity)
+	{
+		if (newCapacity <= capacity)
+		{
+			return;
+		}
+
+		auto extended = new number[newCapacity];
+		copy(map, map + capacity, extended);
+		delete[] map;
+		map		 = extended;
+		capacity = newCapacity;
+	}
+
 	void InMemoryPositionMapAdapter::storeToFile(const string filename) const
 	{
 		fstream file;
@@ -68,6 +68,22 @@ namespace PathORAM
 		stash.erase(block);
 	}
 
+	void AbsStashAdapter::extend(const number newCapacity)
+	{
+		throw Exception(boost::format("this stash adapter cannot be extended (requested capacity %1%)") % newCapacity);
+	}
+
+	void InMemoryStashAdapter::extend(const number newCapacity)
+	{
+		if (newCapacity <= capacity)
+		{
+			return;
+		}
+
+		capacity = newCapacity;
+		stash.reserve(capacity);
+	}
+
 	void InMemoryStashAdapter::checkOverflow(const number block) const
 	{
 #if INPUT_CHECKS
@@ -325,6 +325,39 @@ namespace PathORAM
 		set(boost::make_iterator_range(requests.begin(), requests.end()));
 	}
 
+	void AbsStorageAdapter::extend(const number newCapacity)
+	{
+		if (newCapacity <= capacity)
+		{
+			return;
+		}
+
+		extendInternal(newCapacity);
+		const auto oldCapacity = capacity;
+		capacity			   = newCapacity;
+
+		vector<pair<const number, bucket>> requests;
+		requests.reserve(newCapacity - oldCapacity);
+
+		for (auto i = oldCapacity; i < newCapacity; i++)
+		{
+			bucket bucket;
+			for (auto j = 0uLL; j < Z; j++)
+			{
+				bucket.push_back({ULONG_MAX, bytes()});
+			}
+
+			requests.push_back({i, bucket});
+		}
+
+		set(boost::make_iterator_range(requests.begin(), requests.end()));
+	}
+
+	void AbsStorageAdapter::extendInternal(const number newCapacity)
+	{
+		throw Exception(boost::format("this storage adapter cannot be extended (requested capacity %1%)") % newCapacity);
+	}
+
 	boost::signals2::connection AbsStorageAdapter::subscribe(const OnStorageRequest::slot_type &handler)
 	{
 		return onStorageRequest.connect(handler);
@@ -419,6 +452,18 @@ namespace PathORAM
 		copy(raw.begin(), raw.end(), blocks[location]);
 	}
 
+	void InMemoryStorageAdapter::extendInternal(const number newCapacity)
+	{
+		auto extended = new uchar *[newCapacity];
+		copy(blocks, blocks + capacity, extended);
+		for (auto i = capacity; i < newCapacity; i++)
+		{
+			extended[i] = new uchar[blockSize];
+		}
+		delete[] blocks;
+		blocks = extended;
+	}
+
 #pragma endregion InMemoryStorageAdapter
 
 #pragma region FileSystemStorageAdapter
@@ -476,6 +521,11 @@ namespace PathORAM
 		file->write((const char *)placeholder, blockSize);
 	}
 
+	void FileSystemStorageAdapter::extendInternal(const number newCapacity)
+	{
+		// the file grows as the new locations are written
+	}
+
 #pragma endregion FileSystemStorageAdapter
 
 }
@@ -0,0 +1,339 @@
+#include "avl_leafpage.hpp"
+
+/**
+ * @brief This file contains the leaf pages used by the AVLTree if the index mode LEAF_PAGES is set.
+ * A leaf page packs up to pageSize consecutive records of one column into a single ORAM block.
+ * All functions modifying a page touch every slot of the page, so the work done does not depend on the position of a record inside the page.
+ *
+ */
+
+namespace DOSM{
+
+
+/**
+ * @brief Construct a new LeafPage::LeafPage object without any slots.
+ *
+ */
+LeafPage::LeafPage(){
+    pageID=NULL_PTR;
+    next=NULL_PTR;
+    count=0;
+    empty=true;
+    pageSize=0;
+    numColumns=0;
+}
+
+/**
+ * @brief Construct a new empty LeafPage::LeafPage object. This is used as dummy page (ID 0).
+ *
+ * @param columnFormat : Column format of the database. Relevant for parsing data.
+ * @param pageSize : Maximal number of records stored in this page.
+ */
+LeafPage::LeafPage(vector<AType> columnFormat, number pageSize):LeafPage::LeafPage(NULL_PTR, columnFormat, pageSize){
+    empty=true;
+}
+
+/**
+ * @brief Construct a new LeafPage::LeafPage object with a given ID but without any records.
+ *
+ * @param pageID : ID of the page, location where it is stored in the ORAM
+ * @param columnFormat : Column format of the database. Relevant for parsing data.
+ * @param pageSize : Maximal number of records stored in this page.
+ */
+LeafPage::LeafPage(ulong pageID, vector<AType> columnFormat, number pageSize){
+    this->pageID=pageID;
+    this->columnFormat=columnFormat;
+    this->numColumns=columnFormat.size();
+    this->pageSize=pageSize;
+    next=NULL_PTR;
+    count=0;
+    empty=false;
+
+    vector<db_t> zeroRow;
+    for (size_t i = 0; i < numColumns; i++){
+        zeroRow.push_back(DBT::getDBTZero(columnFormat[i]));
+    }
+    keys=vector<vector<db_t>>(pageSize, zeroRow);
+    nodeHashes=vector<size_t>(pageSize, 0);
+}
+
+/**
+ * @brief Construct a new LeafPage::LeafPage object from a serialized page.
+ *
+ * @param serializedPage : array of unsigned chars created by serializing a LeafPage
+ * @param dummy : Bool value indicating wether this is a dummy operation
+ * @param columnFormat : Column format of the database. Relevant for parsing data.
+ * @param pageSize : Maximal number of records stored in this page.
+ */
+LeafPage::LeafPage(bytes serializedPage, bool dummy, vector<AType> columnFormat, number pageSize):LeafPage::LeafPage(NULL_PTR, columnFormat, pageSize){
+    empty=dummy;
+    size_t s=0;
+
+    memcpy(&pageID, &serializedPage[s], sizeof(ulong));
+    s+=sizeof(ulong);
+    memcpy(&next, &serializedPage[s], sizeof(ulong));
+    s+=sizeof(ulong);
+    memcpy(&count, &serializedPage[s], sizeof(number));
+    s+=sizeof(number);
+
+    size_t sizeDBT=DBT::getMaxSizeDBT();
+    for (size_t j = 0; j < pageSize; j++){
+        for (size_t i = 0; i < numColumns; i++){
+            bytes k(serializedPage.begin()+s, serializedPage.begin()+s+sizeDBT);
+            keys[j][i]=DBT::deserialize(k,columnFormat[i]);
+            s+=sizeDBT;
+        }
+        memcpy(&nodeHashes[j], &serializedPage[s], sizeof(size_t));
+        s+=sizeof(size_t);
+    }
+}
+
+/**
+ * @brief Serializes the current LeafPage. All slots are serialized, so every page has the same size.
+ *
+ * @return bytes
+ */
+bytes LeafPage::serialize(){
+    bytes serialized;
+    size_t sizeDBT=DBT::getMaxSizeDBT();
+    serialized.reserve(2*sizeof(ulong)+sizeof(number)+pageSize*(numColumns*sizeDBT+sizeof(size_t)));
+
+    uchar* uBytes=(uchar*)&pageID;
+    serialized.insert(serialized.end(), uBytes, uBytes+sizeof(ulong));
+    uBytes=(uchar*)&next;
+    serialized.insert(serialized.end(), uBytes, uBytes+sizeof(ulong));
+    uBytes=(uchar*)&count;
+    serialized.insert(serialized.end(), uBytes, uBytes+sizeof(number));
+
+    for (size_t j = 0; j < pageSize; j++){
+        for (size_t i = 0; i < numColumns; i++){
+            vector<uchar> data_vec = DBT::serialize(keys[j][i],columnFormat[i]);
+            serialized.insert(serialized.end(), data_vec.begin(), data_vec.begin()+sizeDBT);
+        }
+        uBytes=(uchar*)&nodeHashes[j];
+        serialized.insert(serialized.end(), uBytes, uBytes+sizeof(size_t));
+    }
+    return serialized;
+}
+
+/**
+ * @brief Serializes the page and pads it to the block size of the ORAM.
+ *
+ * @param blockSize
+ * @return bytes
+ */
+bytes LeafPage::padToBlockSize(number blockSize){
+    bytes serialized=serialize();
+    if(serialized.size()>blockSize){
+        __throw_invalid_argument("The serialized LeafPage is larger than the block size of the ORAM.");
+    }
+    serialized.resize(blockSize, 0);
+    return serialized;
+}
+
+/**
+ * @brief Returns the valid records of the page as string.
+ *
+ * @param column : column for which the keys are printed
+ * @return string
+ */
+string LeafPage::toString(ulong column){
+    ostringstream oss;
+    oss<<"Page[id:"<<pageID<<", next:"<<next<<", count:"<<count<<", keys:";
+    for (size_t j = 0; j < count and j<pageSize; j++){
+        oss<<" "<<DBT::toString(keys[j][column])<<"-"<<nodeHashes[j];
+    }
+    oss<<"]";
+    return oss.str();
+}
+
+/**
+ * @brief Gets the size of bytes for a page with the given format when serialized.
+ *
+ * @param columnFormat : Column format of the database.
+ * @param pageSize : number of records per page
+ * @return number
+ */
+number getPageBytesWhenSerialized(vector<AType> columnFormat, number pageSize){
+    LeafPage NULL_PAGE=LeafPage(columnFormat, pageSize);
+    return NULL_PAGE.serialize().size();
+}
+
+/**
+ * @brief Ordering used for records in pages. Same as in the AVLTree: first by key, then by nodeHash.
+ *
+ * @return true if (key1,hash1) is smaller than (key2,hash2)
+ */
+bool recordSmaller(db_t key1, size_t hash1, db_t key2, size_t hash2){
+    bool smallerKey= key1<key2;
+    bool sameKey= key1==key2;
+    return smallerKey or (sameKey and hash1<hash2);
+}
+
+/**
+ * @brief Inserts a record into its sorted position in the page. If the page overflows, it is split in two halves and the upper half is moved into a new page with ID newPageID.
+ * All slots are rewritten independent of the position of the new record.
+ *
+ * @param page : page the record belongs into
+ * @param key : keys of the record
+ * @param nodeHash : hash of the record
+ * @param column : column by which the page is sorted
+ * @param newPageID : ID for the new page, only used if a split is required
+ * @return tuple<LeafPage,LeafPage,bool> : the updated page, the new page (a dummy if no split happened) and wether the page was split
+ */
+tuple<LeafPage,LeafPage,bool> insertIntoPage(LeafPage page, vector<db_t> key, size_t nodeHash, ulong column, ulong newPageID){
+    number k=page.pageSize;
+    ulong numColumns=page.numColumns;
+
+    //position of the new record: number of valid records smaller than the new record
+    number pos=0;
+    for (size_t j = 0; j < k; j++){
+        bool valid= j<page.count;
+        bool smaller= valid and recordSmaller(page.keys[j][column],page.nodeHashes[j],key[column],nodeHash);
+        pos+=(number) smaller;
+    }
+
+    //k+1 slots containing all records including the new one
+    vector<vector<db_t>> tmpKeys(k+1, key);
+    vector<size_t> tmpHashes(k+1, nodeHash);
+    for (size_t j = 0; j <= k; j++){
+        bool before= j<pos;
+        bool isNew= j==pos;
+        size_t cur=min(j,(size_t)k-1);
+        size_t prev= j>0? j-1 : 0;
+        for (size_t i = 0; i < numColumns; i++){
+            db_t val=_IF_THEN(before, page.keys[cur][i], page.keys[prev][i]);
+            tmpKeys[j][i]=_IF_THEN(isNew, key[i], val);
+        }
+        size_t h=_IF_THEN(before, page.nodeHashes[cur], page.nodeHashes[prev]);
+        tmpHashes[j]=_IF_THEN(isNew, nodeHash, h);
+    }
+
+    number total=page.count+1;
+    bool split= total>k;
+    number half=(k+1)/2;
+    number leftCount=_IF_THEN(split, half, total);
+
+    LeafPage left(page.pageID, page.columnFormat, k);
+    LeafPage right(newPageID, page.columnFormat, k);
+    vector<db_t> zeroRow=left.keys[0];
+    for (size_t j = 0; j < k; j++){
+        bool validLeft= j<leftCount;
+        size_t r=min((size_t)(half+j),(size_t)k);
+        bool validRight= split and (half+j)<=k;
+        for (size_t i = 0; i < numColumns; i++){
+            left.keys[j][i]=_IF_THEN(validLeft, tmpKeys[j][i], zeroRow[i]);
+            right.keys[j][i]=_IF_THEN(validRight, tmpKeys[r][i], zeroRow[i]);
+        }
+        left.nodeHashes[j]=_IF_THEN(validLeft, tmpHashes[j], (size_t)0);
+        right.nodeHashes[j]=_IF_THEN(validRight, tmpHashes[r], (size_t)0);
+    }
+    left.count=leftCount;
+    right.count=_IF_THEN(split, (total-half), (number)0);
+    right.next=page.next;
+    left.next=_IF_THEN(split, newPageID, page.next);
+    left.empty=page.empty;
+    right.empty=not split;
+
+    return make_tuple(left,right,split);
+}
+
+/**
+ * @brief Removes the record (key,nodeHash) from the page if it is stored in this page. The remaining records are shifted, so the valid records stay at the start of the page.
+ *
+ * @param page : page to remove the record from
+ * @param key : key of the record in the passed column
+ * @param nodeHash : hash of the record
+ * @param column : column by which the page is sorted
+ * @param execute : if false, this is a dummy operation and nothing is removed
+ * @param removedRecord : is set to the keys of the removed record for all columns (unchanged if nothing was removed)
+ * @return true if the record was removed
+ */
+bool removeFromPage(LeafPage *page, db_t key, size_t nodeHash, ulong column, bool execute, vector<db_t> *removedRecord){
+    number k=page->pageSize;
+    bool found=false;
+    vector<db_t> zeroRow;
+    for (size_t i = 0; i < page->numColumns; i++){
+        zeroRow.push_back(DBT::getDBTZero(page->columnFormat[i]));
+    }
+
+    for (size_t j = 0; j < k; j++){
+        bool valid= j<page->count;
+        bool sameKey= page->keys[j][column]==key;
+        bool match= valid and execute and sameKey and (page->nodeHashes[j]==nodeHash);
+        found= found or match;
+        for (size_t i = 0; i < page->numColumns; i++){
+            (*removedRecord)[i]=_IF_THEN(match, page->keys[j][i], (*removedRecord)[i]);
+        }
+
+        bool isLast= j==k-1;
+        size_t nxt=min(j+1,(size_t)k-1);
+        for (size_t i = 0; i < page->numColumns; i++){
+            db_t shifted=_IF_THEN(isLast, zeroRow[i], page->keys[nxt][i]);
+            page->keys[j][i]=_IF_THEN(found, shifted, page->keys[j][i]);
+        }
+        size_t shiftedHash=_IF_THEN(isLast, (size_t)0, page->nodeHashes[nxt]);
+        page->nodeHashes[j]=_IF_THEN(found, shiftedHash, page->nodeHashes[j]);
+    }
+    page->count=page->count-(number)found;
+    return found;
+}
+
+/**
+ * @brief Rebalances an underfull page with its successor. If both pages fit into one page, all records are moved into page and nextPage is emptied.
+ * Otherwise the records are split evenly between both pages.
+ *
+ * @param page : underfull page
+ * @param nextPage : successor of page in the linked list of pages
+ * @param execute : if false, both pages are returned unchanged
+ * @return tuple<LeafPage,LeafPage,bool> : updated page, updated successor and wether both pages were merged (so the successor can be freed)
+ */
+tuple<LeafPage,LeafPage,bool> mergePages(LeafPage page, LeafPage nextPage, bool execute){
+    number k=page.pageSize;
+    ulong numColumns=page.numColumns;
+    number total=page.count+nextPage.count;
+    bool merge= execute and total<=k;
+    bool redistribute= execute and not merge;
+
+    //all records of both pages in order
+    vector<vector<db_t>> tmpKeys(2*k, page.keys[0]);
+    vector<size_t> tmpHashes(2*k, 0);
+    for (size_t j = 0; j < 2*k; j++){
+        bool fromPage= j<page.count;
+        size_t p=min(j,(size_t)k-1);
+        size_t n= j>=page.count? min((size_t)(j-page.count),(size_t)k-1) : 0;
+        for (size_t i = 0; i < numColumns; i++){
+            tmpKeys[j][i]=_IF_THEN(fromPage, page.keys[p][i], nextPage.keys[n][i]);
+        }
+        tmpHashes[j]=_IF_THEN(fromPage, page.nodeHashes[p], nextPage.nodeHashes[n]);
+    }
+
+    number leftCount=page.count;
+    leftCount=_IF_THEN(merge, total, leftCount);
+    leftCount=_IF_THEN(redistribute, (total+1)/2, leftCount);
+
+    LeafPage newPage(page.pageID, page.columnFormat, k);
+    LeafPage newNext(nextPage.pageID, page.columnFormat, k);
+    vector<db_t> zeroRow=newPage.keys[0];
+    for (size_t j = 0; j < k; j++){
+        bool validLeft= j<leftCount;
+        bool validRight= leftCount+j<total;
+        size_t r=min((size_t)(leftCount+j),(size_t)(2*k-1));
+        for (size_t i = 0; i < numColumns; i++){
+            newPage.keys[j][i]=_IF_THEN(validLeft, tmpKeys[j][i], zeroRow[i]);
+            newNext.keys[j][i]=_IF_THEN(validRight, tmpKeys[r][i], zeroRow[i]);
+        }
+        newPage.nodeHashes[j]=_IF_THEN(validLeft, tmpHashes[j], (size_t)0);
+        newNext.nodeHashes[j]=_IF_THEN(validRight, tmpHashes[r], (size_t)0);
+    }
+    newPage.count=leftCount;
+    newNext.count=total-leftCount;
+    newPage.next=_IF_THEN(merge, nextPage.next, page.next);
+    newNext.next=_IF_THEN(merge, NULL_PTR, nextPage.next);
+    newPage.empty=page.empty;
+    newNext.empty=nextPage.empty;
+
+    return make_tuple(newPage,newNext,merge);
+}
+
+}
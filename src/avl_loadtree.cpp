@@ -14,9 +14,12 @@ namespace DOSM{
  * @param valueSize 
  * @param columnFormat 
  * @param oramBlockSize 
+ * @param nodeHashes : if not nullptr, the nodeHash for each data point. Otherwise the nodeID is used as nodeHash.
+ * @param augmented : if true, the nodes are serialized with their subtree aggregates
+ * @param aggregateColumn : column whose values are summed up in the subtree aggregates
  * @return tuple<vector<pair<number, bytes>>, vector<ulong>> 
  */
-tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(vector<vector<db_t>> *inputData, size_t num, size_t valueSize, vector<AType> columnFormat, size_t oramBlockSize){
+tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(vector<vector<db_t>> *inputData, size_t num, size_t valueSize, vector<AType> columnFormat, size_t oramBlockSize, vector<size_t> *nodeHashes, bool augmented, ulong aggregateColumn){
     LOG(INFO, boost::wformat(L"Creating Tree Structure in non-oblivious manner from sorted lists.") );
     vector<AVLTreeNode> allNodes;
     allNodes.reserve(num);
@@ -34,7 +37,8 @@ tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(v
             oss<<DBT::toString(key[j])<<",";
         }
 
-        allNodes.push_back(AVLTreeNode(key,nodeID,value,columnFormat,nodeID));
+        size_t nodeHash=(nodeHashes==nullptr)? nodeID : (*nodeHashes)[i];
+        allNodes.push_back(AVLTreeNode(key,nodeHash,value,columnFormat,nodeID));
     }
 
 	auto cmpNodes=[](AVLTreeNode n1, AVLTreeNode n2 )->bool{
@@ -52,7 +56,7 @@ tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(v
     #pragma omp parallel for num_threads(16)
     for(size_t i=0;i<columnFormat.size();i++){
         LOG(INFO, boost::wformat(L"building Tree from sorted list for Colum %d") %i );
-        auto[rootI, thisNodes]=buildTreeFromSortedList(allNodes,i);
+        auto[rootI, thisNodes]=buildTreeFromSortedList(allNodes,i,aggregateColumn);
         thisRoots[i]=rootI;
         sort(thisNodes.begin(),thisNodes.end(),cmpNodes);
         for(size_t j=0;j<allNodes.size();j++){
@@ -61,6 +65,10 @@ tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(v
             allNodes[j].rHeight[i]=thisNodes[j].rHeight[i];
             allNodes[j].lHeight[i]=thisNodes[j].lHeight[i];
             allNodes[j].next[i]=thisNodes[j].next[i];
+            allNodes[j].lCount[i]=thisNodes[j].lCount[i];
+            allNodes[j].rCount[i]=thisNodes[j].rCount[i];
+            allNodes[j].lSum[i]=thisNodes[j].lSum[i];
+            allNodes[j].rSum[i]=thisNodes[j].rSum[i];
         }
 
 
@@ -71,6 +79,7 @@ tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(v
     vector<pair<number, bytes>> data;
     for(size_t i=0;i<allNodes.size();i++){
         AVLTreeNode n=allNodes[i];
+        n.augmented=augmented;
         bytes nodeBytes=n.padToBlockSize(oramBlockSize);
         data.push_back(make_pair(n.nodeID+1,nodeBytes));
 
@@ -87,9 +96,10 @@ tuple<vector<pair<number, bytes>>, vector<ulong>>  createTreeStructureNonObliv(v
  * Note: Right subtree will be bigger if both subtrees do not have same number of nodes.
  * @param allNodes 
  * @param sortIndex 
+ * @param aggregateColumn : column whose values are summed up in the subtree aggregates
  * @return tuple<ulong,vector<AVLTreeNode>>
  */
-tuple<ulong,vector<AVLTreeNode>> buildTreeFromSortedList(vector<AVLTreeNode>  allNodes, int sortIndex){
+tuple<ulong,vector<AVLTreeNode>> buildTreeFromSortedList(vector<AVLTreeNode>  allNodes, int sortIndex, ulong aggregateColumn){
 	auto cmpNodes=[sortIndex](AVLTreeNode n1, AVLTreeNode n2 )->bool{
 			if(n1.key[sortIndex]<n2.key[sortIndex]){
 				return true;
@@ -110,7 +120,8 @@ tuple<ulong,vector<AVLTreeNode>> buildTreeFromSortedList(vector<AVLTreeNode>  al
 
     ulong root;
     int height;
-    tie(root, height)= updateTreeConstruction(&allNodes,0,(allNodes).size(),sortIndex);
+    double sum;
+    tie(root, height, sum)= updateTreeConstruction(&allNodes,0,(allNodes).size(),sortIndex,aggregateColumn);
     
 
 
@@ -126,26 +137,29 @@ tuple<ulong,vector<AVLTreeNode>> buildTreeFromSortedList(vector<AVLTreeNode>  al
 
 /**
  * @brief Recursive function which based on a sorted vector of AVLTreeNodes adapts the 
- * pointers to Left and Right Children.  
+ * pointers to Left and Right Children. The subtree aggregates are set as well.
  * The function returns if only only one or two nodes are left.
  * Note: The right subtree will always be bigger if the number of nodes is not equal 
  * in both subtrees->
  * 
  * @param nodes 
  * @param index 
- * @return tuple<ulong,vector<AVLTreeNode>> 
+ * @param aggregateColumn : column whose values are summed up in the subtree aggregates
+ * @return tuple<ulong,int,double> : root, height and sum of aggregateColumn of the subtree
  */
-tuple<ulong,int> updateTreeConstruction(vector<AVLTreeNode> *nodes,int start,int sizeSubArray, int index){
+tuple<ulong,int,double> updateTreeConstruction(vector<AVLTreeNode> *nodes,int start,int sizeSubArray, int index, ulong aggregateColumn){
     LOG(TRACE, boost::wformat(L"start %d, sizeSubArray %d , index %d\n") %start %sizeSubArray %index);
 
     if(sizeSubArray==1){
         (*nodes)[start].ptrLeftChild[index]=0;
         (*nodes)[start].ptrRightChild[index]=0;
-        return make_tuple((*nodes)[start].nodeID,1);
+        return make_tuple((*nodes)[start].nodeID,1,(*nodes)[start].subtreeSum(index,aggregateColumn));
     }if(sizeSubArray==2){
         (*nodes)[start].ptrRightChild[index]=(*nodes)[start+1].nodeID;
         (*nodes)[start].rHeight[index]=1;
-        return make_tuple((*nodes)[start].nodeID, (*nodes)[start].height(index));
+        (*nodes)[start].rCount[index]=1;
+        (*nodes)[start].rSum[index]=(*nodes)[start+1].subtreeSum(index,aggregateColumn);
+        return make_tuple((*nodes)[start].nodeID, (*nodes)[start].height(index), (*nodes)[start].subtreeSum(index,aggregateColumn));
     }else{
         int index_mid, size_lo, size_hi;
         if(sizeSubArray%2==0){
@@ -160,16 +174,20 @@ tuple<ulong,int> updateTreeConstruction(vector<AVLTreeNode> *nodes,int start,int
             size_hi=size_lo;
         }
         int start_hi=index_mid+1;
-        auto[lC,  lH]=updateTreeConstruction(nodes, start, size_lo,index);
-        auto[rC, rH]=updateTreeConstruction(nodes, start_hi,size_hi,index );
+        auto[lC, lH, lS]=updateTreeConstruction(nodes, start, size_lo,index,aggregateColumn);
+        auto[rC, rH, rS]=updateTreeConstruction(nodes, start_hi,size_hi,index,aggregateColumn);
 
 
         (*nodes)[index_mid].ptrLeftChild[index]=lC;
         (*nodes)[index_mid].ptrRightChild[index]=rC;
         (*nodes)[index_mid].lHeight[index]=lH;
         (*nodes)[index_mid].rHeight[index]=rH;
+        (*nodes)[index_mid].lCount[index]=size_lo;
+        (*nodes)[index_mid].rCount[index]=size_hi;
+        (*nodes)[index_mid].lSum[index]=lS;
+        (*nodes)[index_mid].rSum[index]=rS;
 
-        return make_tuple((*nodes)[index_mid].nodeID, (*nodes)[index_mid].height(index));
+        return make_tuple((*nodes)[index_mid].nodeID, (*nodes)[index_mid].height(index), (*nodes)[index_mid].subtreeSum(index,aggregateColumn));
         
     }
 }
@@ -13,9 +13,10 @@ namespace DOSM{
  * @param cF 
  * @param capacity 
  * @param USE_ORAM 
+ * @param indexMode : If LEAF_PAGES, records are additionally packed into leaf pages which are used for range queries.
  */
-AVLTree::AVLTree(vector<AType> cF, size_t vSize, number capacity, bool USE_ORAM):AVLTree::AVLTree(
-            cF, vSize, capacity, ORAM_Z=3ull, STASH_FACTOR=4ull, BATCH_SIZE=1ull, USE_ORAM){
+AVLTree::AVLTree(vector<AType> cF, size_t vSize, number capacity, bool USE_ORAM, INDEX_MODE_T indexMode):AVLTree::AVLTree(
+            cF, vSize, capacity, ORAM_Z=3ull, STASH_FACTOR=4ull, BATCH_SIZE=1ull, USE_ORAM, indexMode){
 
     }
 
@@ -34,10 +35,13 @@ AVLTree::AVLTree(vector<AType> cF, size_t vSize, number capacity, bool USE_ORAM)
  * @param inputData : vector containing data tuples. 
  * @param numDatapointsAtStart : number of data points from inputData to be used for constructing the tree
  * @param USE_ORAM : For testing purposes. Wether or not data should be stored in an ORAM. 
+ * @param indexMode : If LEAF_PAGES, records are additionally packed into leaf pages which are used for range queries.
+ * @param inputHashes : if not nullptr, the nodeHash for each data point in inputData (e.g. when records are moved from another tree). Otherwise hashes 1..n are assigned.
  */
-AVLTree::AVLTree(vector<AType> cF, size_t vSize,  number ORAM_LOG_CAPACITY,number ORAM_Z, number STASH_FACTOR, number BATCH_SIZE,vector<vector<db_t>> *inputData, size_t numDatapointsAtStart,  bool USE_ORAM){
+AVLTree::AVLTree(vector<AType> cF, size_t vSize,  number ORAM_LOG_CAPACITY,number ORAM_Z, number STASH_FACTOR, number BATCH_SIZE,vector<vector<db_t>> *inputData, size_t numDatapointsAtStart,  bool USE_ORAM, INDEX_MODE_T indexMode, vector<size_t> *inputHashes){
 
     this->columnFormat=cF;
+    this->indexMode=indexMode;
     this->sizeValue=vSize;
 
     this->numColumns=this->columnFormat.size();
@@ -50,7 +54,13 @@ AVLTree::AVLTree(vector<AType> cF, size_t vSize,  number ORAM_LOG_CAPACITY,numbe
     this->STASH_FACTOR=STASH_FACTOR;
     this->ORAM_LOG_CAPACITY=ORAM_LOG_CAPACITY;
     this->BATCH_SIZE=BATCH_SIZE;
-    this->ORAM_BLOCK_SIZE=getNumBytesWhenSerialized(this->columnFormat,this->sizeValue);    
+    this->augmented=MENHIR::USE_SUBTREE_AGGREGATES;
+    this->aggregateColumn=MENHIR::AGGREGATE_COLUMN;
+    if(this->augmented and this->aggregateColumn>=this->numColumns){
+        LOG(WARNING, L"The aggregate column is not a column of this tree. Subtree aggregates are not maintained.");
+        this->augmented=false;
+    }
+    this->ORAM_BLOCK_SIZE=getNumBytesWhenSerialized(this->columnFormat,this->sizeValue,this->augmented);    
 
     LOG_PARAMETER(ORAM_Z);
     LOG_PARAMETER(STASH_FACTOR);
@@ -84,8 +94,18 @@ AVLTree::AVLTree(vector<AType> cF, size_t vSize,  number ORAM_LOG_CAPACITY,numbe
     //numDatapointsAtStart has to be at least one less than total number of 2^ORAM_LOG_CAPACITY as NULL_NODE has to fit into the ORAM
 
 
+    //createTreeStructureNonObliv consumes inputData, so the records for the leaf pages are copied beforehand
+    vector<vector<db_t>> records;
+    vector<size_t> nodeHashes;
+    if(numDatapointsAtStart>0 and (this->indexMode==LEAF_PAGES or this->indexMode==RANK_LAYOUT)){
+        records=*inputData;
+        for (size_t i = 0; i < records.size(); i++){
+            nodeHashes.push_back((inputHashes==nullptr)? i+1 : (*inputHashes)[i]); //same as the nodeHash assigned in createTreeStructureNonObliv
+        }
+    }
+
     if(numDatapointsAtStart>0){
-        tie(data,thisRoots)=createTreeStructureNonObliv(inputData, numDatapointsAtStart, this->sizeValue,this->columnFormat, this->ORAM_BLOCK_SIZE);
+        tie(data,thisRoots)=createTreeStructureNonObliv(inputData, numDatapointsAtStart, this->sizeValue,this->columnFormat, this->ORAM_BLOCK_SIZE, inputHashes, this->augmented, this->aggregateColumn);
         availableBlockNumbers=queue<ulong>();
         this->ptrRoot=thisRoots;
 
@@ -116,10 +136,21 @@ AVLTree::AVLTree(vector<AType> cF, size_t vSize,  number ORAM_LOG_CAPACITY,numbe
         this->oram->load(data);
     }
     AVLTreeNode NULL_NODE= AVLTreeNode(this->columnFormat,this->sizeValue);
+    NULL_NODE.augmented=this->augmented;
     this->nullNodeBytes= NULL_NODE.serialize();
 
     this->oram->put(NULL_PTR+1, this->nullNodeBytes);
 
+    if(this->indexMode==LEAF_PAGES){
+        initLeafPages(records, nodeHashes);
+    }else if(this->indexMode==RANK_LAYOUT){
+        vector<RankRecord> rankRecords;
+        for (size_t i = 0; i < records.size(); i++){
+            rankRecords.push_back(RankRecord(records[i], nodeHashes[i], this->columnFormat));
+        }
+        buildRankLayout(rankRecords);
+    }
+
     LOG(INFO, boost::wformat(L"Finished loading data into ORAM"));
 
     //freeRAM(lockID);
@@ -136,10 +167,12 @@ AVLTree::AVLTree(vector<AType> cF, size_t vSize,  number ORAM_LOG_CAPACITY,numbe
  * @param ORAM_Z 
  * @param BATCH_SIZE 
  * @param USE_ORAM 
+ * @param indexMode : If LEAF_PAGES, records are additionally packed into leaf pages which are used for range queries.
  */
-AVLTree::AVLTree(vector<AType> cF, size_t vSize, number capacity, number ORAM_Z, number STASH_FACTOR, number BATCH_SIZE, bool USE_ORAM){
+AVLTree::AVLTree(vector<AType> cF, size_t vSize, number capacity, number ORAM_Z, number STASH_FACTOR, number BATCH_SIZE, bool USE_ORAM, INDEX_MODE_T indexMode){
 
     this->columnFormat=cF;
+    this->indexMode=indexMode;
     this->sizeValue=vSize;
 
     this->numColumns=this->columnFormat.size();
@@ -154,8 +187,14 @@ AVLTree::AVLTree(vector<AType> cF, size_t vSize, number capacity, number ORAM_Z,
 
     this->ORAM_LOG_CAPACITY=std::max((number) ceil(log((double)this->maxCapacity/(double)this->ORAM_Z)/log(2.0)),3ull);  
     this->BATCH_SIZE=BATCH_SIZE;
+    this->augmented=MENHIR::USE_SUBTREE_AGGREGATES;
+    this->aggregateColumn=MENHIR::AGGREGATE_COLUMN;
+    if(this->augmented and this->aggregateColumn>=this->numColumns){
+        LOG(WARNING, L"The aggregate column is not a column of this tree. Subtree aggregates are not maintained.");
+        this->augmented=false;
+    }
 
-    this->ORAM_BLOCK_SIZE=getNumBytesWhenSerialized(this->columnFormat,this->sizeValue);    
+    this->ORAM_BLOCK_SIZE=getNumBytesWhenSerialized(this->columnFormat,this->sizeValue,this->augmented);    
     /*if(this->ORAM_BLOCK_SIZE<32 ){
         LOG(WARNING, L"The Nodes stored in the AVL Tree must be at least 2 AES block sizes when serialized, so at least 32 bytes (equals rS=32).");
         ORAM_BLOCK_SIZE=32;
@@ -181,6 +220,7 @@ AVLTree::AVLTree(vector<AType> cF, size_t vSize, number capacity, number ORAM_Z,
 
 
     AVLTreeNode NULL_NODE= AVLTreeNode(this->columnFormat,this->sizeValue);
+    NULL_NODE.augmented=this->augmented;
     this->nullNodeBytes= NULL_NODE.serialize();
 
     //creates inMemory Position, Storage and Stash adapters 
@@ -202,6 +242,12 @@ AVLTree::AVLTree(vector<AType> cF, size_t vSize, number capacity, number ORAM_Z,
     for(size_t i=1;i<this->maxCapacity;i++){
         this->availableBlockNumbers.push(i);
     }
+
+    if(this->indexMode==LEAF_PAGES){
+        initLeafPages(vector<vector<db_t>>(), vector<size_t>());
+    }else if(this->indexMode==RANK_LAYOUT){
+        buildRankLayout(vector<RankRecord>());
+    }
 }
 
 
@@ -216,6 +262,93 @@ number AVLTree::getORAMBLOCKSIZE(){
     return ORAM_BLOCK_SIZE;
 }
 
+number AVLTree::getORAMLogCapacity(){
+    return ORAM_LOG_CAPACITY;
+}
+
+/**
+ * @brief Number of data points that fit into the tree. One node ID is reserved for the NULL_NODE.
+ * 
+ * @return number 
+ */
+number AVLTree::getCapacity(){
+    return this->maxCapacity-1;
+}
+
+/**
+ * @brief Doubles the capacity of the tree by adding a level to its ORAM (see PathORAM::ORAM::grow). 
+ * The nodes are not moved, they reach the new level once they are accessed. The new node IDs become available for inserts.
+ * With LEAF_PAGES, the ORAM of the pages grows as well. With RANK_LAYOUT, the rank layout is rebuilt for the new capacity.
+ * Must not be called while the concurrent access is enabled.
+ * 
+ */
+void AVLTree::growORAM(){
+    this->ORAM_LOG_CAPACITY++;
+    //the stash bound grows with the height of the tree, as for a new ORAM of this size
+    this->oram->grow(this->STASH_FACTOR * this->ORAM_LOG_CAPACITY * this->ORAM_Z);
+    number oldCapacity=this->maxCapacity;
+    this->maxCapacity=2*oldCapacity;
+    for(size_t i=oldCapacity;i<this->maxCapacity;i++){
+        this->availableBlockNumbers.push(i);
+    }
+    LOG(INFO, boost::wformat(L"Grew ORAM to log capacity %d (%d nodes)") %this->ORAM_LOG_CAPACITY %this->maxCapacity);
+
+    if(this->indexMode==LEAF_PAGES){
+        number oldPages=this->maxPages;
+        number minFill=max(this->pageSize/2, 1ull);
+        this->maxPages=this->numColumns*(this->maxCapacity/minFill+2)+1;
+        while(((number) 1 << this->pageOram->getHeight())*this->ORAM_Z<this->maxPages){
+            this->pageOram->grow(this->STASH_FACTOR * (this->pageOram->getHeight()+1) * this->ORAM_Z);
+        }
+        for(size_t i=oldPages;i<this->maxPages;i++){
+            this->availablePageNumbers.push(i);
+        }
+    }else if(this->indexMode==RANK_LAYOUT){
+        rebuildRankLayout();
+    }
+}
+
+/**
+ * @brief Enables or disables the thread-safe front-end for the ORAM of the nodes. While enabled, multiple threads may run read-only operations 
+ * (findIntervalMenhir in the index mode AVL_ONLY) on the tree at the same time. Their ORAM requests are aggregated into batches of at most BATCH_SIZE requests.
+ * Operations that change the tree must still not run concurrently with any other operation.
+ * Must only be called while no other thread accesses the tree, as the front-end is read without synchronization by getNodeORAM().
+ * 
+ * @param enable 
+ */
+void AVLTree::setConcurrentAccess(bool enable){
+    if(enable and not concurrentOram){
+        concurrentOram=make_shared<ConcurrentORAM>(this->oram, this->BATCH_SIZE);
+    }else if(not enable){
+        //the destructor executes all queued requests
+        concurrentOram.reset();
+    }
+}
+
+/**
+ * @brief Average number of node accesses that were aggregated into one ORAM access by the thread-safe front-end, 0 if it is not enabled.
+ * 
+ * @return double 
+ */
+double AVLTree::getMeanBatchSize(){
+    if(not concurrentOram){
+        return 0.0;
+    }
+    return concurrentOram->getMeanBatchSize();
+}
+
+number AVLTree::getNumTombstones(){
+    return this->numNodeTombstones;
+}
+
+bool AVLTree::isAugmented(){
+    return this->augmented;
+}
+
+INDEX_MODE_T AVLTree::getIndexMode(){
+    return indexMode;
+}
+
 vector<ulong>  AVLTree::getRoots(){
     return this->ptrRoot;
 }
@@ -236,22 +369,48 @@ AVLTree::~AVLTree(){
  * @return int 
  */
 int AVLTree::getPad(){
-    int n=this->treeSize;
+    return getMaxHeight(this->treeSize);
+
+    //return (int) ceil(1.44*log(treeSize)+1);
+}
+
+/**
+ * @brief Worst Case tree hight of an AVL tree with treeSize nodes, see getPad(). This is the number of nodes visited by every padded descent.
+ * 
+ * @param treeSize 
+ * @return int 
+ */
+int AVLTree::getMaxHeight(number treeSize){
+    int n=treeSize;
     double phi=(1+sqrt(5))/2;
     double c=1/(log(phi)/log(2));
     double b=c/2*log(5)/log(2)-2;
     double d=1+1/(pow(phi,4)*sqrt(5));
     int result=ceil(c*log(n+d)/log(2)+b);
     //Plus one for root node
-    if(this->treeSize==1){
+    if(treeSize==1){
         result=1;
     }
     return result;
-
-    //return (int) ceil(1.44*log(treeSize)+1);
 }
 
 
+/**
+ * @brief Measures the mean time of a node access by conducting numAccesses dummy reads, e.g. to predict the runtime of queries.
+ * 
+ * @param numAccesses 
+ * @return double : mean time per access in ns
+ */
+double AVLTree::measureAccessTime(number numAccesses){
+    numAccesses=max(numAccesses, 1ull);
+    chrono::steady_clock::time_point before=chrono::steady_clock::now();
+    for (size_t i = 0; i < numAccesses; i++){
+        getNodeORAM(NULL_PTR, true);
+    }
+    double elapsed=chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-before).count();
+    return elapsed/(double) numAccesses;
+}
+
 bool AVLTree::empty() const{
     return treeSize == 0;
 }
@@ -275,18 +434,45 @@ AVLTreeNode AVLTree::getNodeORAM(ulong nodePtr, bool dummy){
     dummy= (not (bool) nodePtr) or dummy;
     const ulong ptr=NULL_PTR*dummy+nodePtr*(not dummy);
     bytes response;
-    oram->get(ptr+1, response);
+    if(concurrentOram){
+        response=concurrentOram->get(ptr+1).get();
+    }else{
+        oram->get(ptr+1, response);
+    }
     if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"Get Node with nodeID %d from ORAM.")%ptr);
 
     if(response.size()==0){
         LOG(ERROR, boost::wformat(L"Node with nodeID %d was not found at %d in ORAM.")%ptr %(ptr+1));
         exit(1);
     }
-    AVLTreeNode node=AVLTreeNode(response, dummy, columnFormat, sizeValue); 
+    AVLTreeNode node=AVLTreeNode(response, dummy, columnFormat, sizeValue, augmented); 
     return node;
     
 }
 
+/**
+ * @brief Oblivious selection of a whole node: returns a copy of first if condition is true and of second otherwise. 
+ * Both nodes are serialized and every byte is selected with _IF_THEN, so the same operations are executed in both cases.
+ * 
+ * @param condition 
+ * @param first 
+ * @param second 
+ * @return AVLTreeNode 
+ */
+AVLTreeNode AVLTree::selectNode(bool condition, AVLTreeNode first, AVLTreeNode second){
+    first.augmented=this->augmented;
+    second.augmented=this->augmented;
+    bytes firstBytes=first.serialize();
+    bytes secondBytes=second.serialize();
+    for(size_t i=0;i<firstBytes.size();i++){
+        uint8_t b= _IF_THEN((uint8_t) condition,(uint8_t) firstBytes[i],(uint8_t) secondBytes[i]);
+        firstBytes[i]=(uchar) b;
+    }
+    bool empty=_IF_THEN(condition, first.empty, second.empty);
+    AVLTreeNode node=AVLTreeNode(firstBytes, empty, columnFormat, sizeValue, augmented);
+    return node;
+}
+
 /**
  * @brief Returns a number that can be used as ID for a new AVLTreeNode.
  * 
@@ -312,6 +498,7 @@ void AVLTree::putNodeORAM( AVLTreeNode node, bool dummy){
     dummy=dummy or node.empty;
 
     const ulong ptr=NULL_PTR*dummy+node.nodeID*(not dummy);
+    node.augmented=this->augmented;
     bytes nodeBytes=node.serialize();
 
     for(size_t i=0;i<nodeBytes.size();i++){
@@ -320,7 +507,11 @@ void AVLTree::putNodeORAM( AVLTreeNode node, bool dummy){
     }
 
     if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"Putting block %d in ORAM")%ptr);
-    oram->put(ptr+1, nodeBytes);
+    if(concurrentOram){
+        concurrentOram->put(ptr+1, nodeBytes).get();
+    }else{
+        oram->put(ptr+1, nodeBytes);
+    }
         
 }
 
@@ -328,12 +519,19 @@ void AVLTree::putNodeORAM( AVLTreeNode node, bool dummy){
  * @brief Overwrites the block at ID nodePtr in the ORAM with zeros.
  * 
  * @param nodePtr 
+ * @param dummy : if true, the ID is not made available again (used if no node was deleted and nodePtr is NULL_PTR)
  */
-void AVLTree::deleteNodeORAM(ulong nodePtr){
+void AVLTree::deleteNodeORAM(ulong nodePtr, bool dummy){
     
     //putting empty node in place of Node  
-    oram->put(nodePtr+1, this->nullNodeBytes);
-    availableBlockNumbers.push(nodePtr);
+    if(concurrentOram){
+        concurrentOram->put(nodePtr+1, this->nullNodeBytes).get();
+    }else{
+        oram->put(nodePtr+1, this->nullNodeBytes);
+    }
+    if(not dummy){
+        availableBlockNumbers.push(nodePtr);
+    }
 
 }
 
@@ -375,6 +573,7 @@ void AVLTree::putTreeInORAM(vector<AVLTreeNode > nodes, vector<ulong> thisRoot){
             __throw_invalid_argument("NumColumns in Node needs to be the same as in the tree.");
         }
    
+        n.augmented=this->augmented;
         bytes nodeBytes=n.padToBlockSize(ORAM_BLOCK_SIZE);
         data.push_back(make_pair(n.nodeID+1,nodeBytes));
         nodeIDs.insert({(ulong)n.nodeID, (ulong)n.nodeID});
@@ -396,7 +595,7 @@ void AVLTree::putTreeInORAM(vector<AVLTreeNode > nodes, vector<ulong> thisRoot){
     //putNodeORAM( NULL_NODE, false);
 
     availableBlockNumbers=queue<ulong>();
-    for(size_t i=1;i<=maxCapacity;i++){
+    for(size_t i=1;i<maxCapacity;i++){
         if(nodeIDs.count((ulong)i)==0){
             availableBlockNumbers.push(i);
         }
@@ -523,9 +722,10 @@ void AVLTree::insert(vector<db_t> key, size_t nodeHash){
  * 
  * @param column 
  * @param newNode 
+ * @param fragment : if not nullptr, nodes are taken from this prefetched part of the tree instead of the ORAM (used by insertBatch)
  * @return tuple<vector<AVLTreeNode>,vector<ulong>, vector<bool>,vector<bool>, bool> 
  */
-tuple<vector<AVLTreeNode>,vector<bool>, bool, ulong,ulong> AVLTree::insertHelper_findParent( int column,AVLTreeNode newNode){
+tuple<vector<AVLTreeNode>,vector<bool>, bool, ulong,ulong> AVLTree::insertHelper_findParent( int column,AVLTreeNode newNode, unordered_map<ulong,AVLTreeNode> *fragment){
     int pad=getPad();
     vector<AVLTreeNode> nodes;
     nodes.reserve(pad);
@@ -544,7 +744,7 @@ tuple<vector<AVLTreeNode>,vector<bool>, bool, ulong,ulong> AVLTree::insertHelper
     if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"column %d - Find location for Insertion") % column);
    
     for(size_t i=0; i<(size_t) pad;i++){
-        curNode=getNodeORAM(ptrCur);
+        curNode=(fragment==nullptr)? getNodeORAM(ptrCur) : getNodeFragment(ptrCur, fragment);
         nodes.push_back(curNode);
         if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"column %d - curNode: %s") %column %MENHIR::toWString(curNode.toString(true,column)));    
 
@@ -577,15 +777,16 @@ tuple<vector<AVLTreeNode>,vector<bool>, bool, ulong,ulong> AVLTree::insertHelper
 
 /**
  * @brief This is a subfunction for inserting a new node. This function takes a the appropriate leaf location of a new node and the relevant path information.
- *         It then updates all parents to reflect new height and size (so how many elements with the same key are in this subtree). It also conducts repalancing procedures. 
+ *         It then updates all parents to reflect new height and size (so how many elements with the same key are in this subtree). 
+ *         It also determines which nodes take part in rebalancing. The nodes are only updated in the path buffer and not written to the ORAM.
  * 
  * @param column 
  * @param newNode 
- * @param nodes 
+ * @param nodes : path buffer holding the nodes from root to leaf, updated in place
  * @param lORr 
  * @param toInsert 
  */
-tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AVLTreeNode newNode, vector<AVLTreeNode> nodes, vector<bool> lORr, bool toInsert){
+tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AVLTreeNode newNode, vector<AVLTreeNode> *nodes, vector<bool> lORr, bool toInsert){
 
     ulong ptr=newNode.nodeID;
     AVLTreeNode curNode(columnFormat, sizeValue);
@@ -602,9 +803,11 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
     ulong balance_child=newNode.nodeID; //in case the new node is part or a rebalancing procedure, however it is not yet in the list of nodes so we set it as default
     ulong balance_childschild=newNode.nodeID;
     bool balanceNodeFound=false;
+    int childHeight=0; //height of the subtree of the previous node on the path, after insertion and rebalancing
+    double newValue=DBT::toDouble(newNode.key[aggregateColumn]);
 
-    for(int i=(int) nodes.size()-1;i>=0;i--){
-        curNode=nodes[i];
+    for(int i=(int) nodes->size()-1;i>=0;i--){
+        curNode=(*nodes)[i];
         ptrCur=curNode.nodeID;
         if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"\ncurNode: %s") %MENHIR::toWString(curNode.toString(true,column)));    
 
@@ -626,12 +829,19 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
         if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"update rightChild:%d")%update);    
         curNode.ptrRightChild[column]=update*ptr+ (not update)*curNode.ptrRightChild[column];
 
+        //all nodes above the new node gain it in the subtree on the side of the path, rotations keep the subtree aggregates consistent
+        bool addLeft=foundParent and isLeft;
+        bool addRight=foundParent and not isLeft;
+        curNode.lCount[column]=curNode.lCount[column]+(number) addLeft;
+        curNode.lSum[column]=curNode.lSum[column]+_IF_THEN(addLeft, newValue, 0.0);
+        curNode.rCount[column]=curNode.rCount[column]+(number) addRight;
+        curNode.rSum[column]=curNode.rSum[column]+_IF_THEN(addRight, newValue, 0.0);
 
-        height=_IF_THEN(foundParent,height+1,height);
+        height=_IF_THEN(isParent,1,childHeight);
 
         //only collect data for balancing if not the last node in array (i.e. potential leaf node if tree was fully used).
         // This if condition is data oblivious
-        if (i<(int) nodes.size()-1){
+        if (i<(int) nodes->size()-1){
 
 
             //we assume here ,that the rebalancing already happend. So the height of the node which was rebalances is originalHeight+1
@@ -644,7 +854,7 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
             if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"update rheight:%d height: %d")%update %height);    
 
 
-            AVLTreeNode child=nodes[i+1];    
+            AVLTreeNode child=(*nodes)[i+1];    
 
             if(CURRENT_LEVEL==TRACE){
                 LOG(TRACE, boost::wformat(L"curNode: %s") %MENHIR::toWString(curNode.toString(true,column)));    
@@ -653,7 +863,7 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
 
 
             //get balance type
-            bool balancingRequired= (curNode.balanceFactor()==2 or curNode.balanceFactor()==-2);// it true if the current node requiers some kind of rotation.
+            bool balancingRequired= (curNode.balanceFactor(column)==2 or curNode.balanceFactor(column)==-2);// it true if the current node requiers some kind of rotation.
             bool update_balaceData= (balancingRequired and not balanceNodeFound); //is true if the current node requires balancing and is the first to do so
             balanceNodeFound= _IF_THEN(update_balaceData, true, balanceNodeFound);
 
@@ -663,7 +873,7 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
                 +2 or +1 for left right rotation
                 0 should never occure for b if an rotation is required
             */
-            int b= child.balanceFactor()+curNode.balanceFactor(); 
+            int b= child.balanceFactor(column)+curNode.balanceFactor(column); 
             balanceType= _IF_THEN(update_balaceData, b, balanceType);
             bool update_n=(update_balaceData and curNode.nodeID !=NULL_PTR); //only update nodes if they are not dummy nodes
             balance_n=_IF_THEN(update_n, curNode.nodeID, balance_n);
@@ -675,9 +885,9 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
                 LOG(TRACE, boost::wformat(L"update_n %d balance_n %d")%update_n %balance_n  );                
                 LOG(TRACE, boost::wformat(L"update_child %d balance_child %d") %update_child %balance_child );   
             }
-            if(i<(int) nodes.size()-2){
+            if(i<(int) nodes->size()-2){
                 // potential tree hight (including the dummies) allows for double rotations
-                AVLTreeNode childschild=nodes[i+2]; 
+                AVLTreeNode childschild=(*nodes)[i+2]; 
                 bool update_childchild= (update_balaceData and childschild.nodeID != NULL_PTR);
                 balance_childschild=_IF_THEN(update_childchild, childschild.nodeID, balance_childschild);
 
@@ -694,7 +904,10 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
             update=(int) ((not isLeft)and foundParent and update_balaceData);
             curNode.rHeight[column]=update*height_n+(not update)*curNode.rHeight[column]; 
             if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"update rheight:%d")%update);*/  
-            height=_IF_THEN(update_balaceData,(height-1),height);
+            //the subtree of the node keeps its height if the other side is higher. Rebalancing reduces the height by one.
+            int subtreeHeight=_IF_THEN((curNode.lHeight[column]>curNode.rHeight[column]), curNode.lHeight[column], curNode.rHeight[column]);
+            subtreeHeight=_IF_THEN(update_balaceData,subtreeHeight,(subtreeHeight+1));
+            childHeight=_IF_THEN(foundParent,subtreeHeight,childHeight);
 
 
             //if the parent of a balanceNode is found the pointer to one of its children needs to be updated as it changes during rotation.
@@ -718,8 +931,7 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
 
         if(CURRENT_LEVEL<=TRACE)
             if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"column %d - curNode(after update %d): %s") %column %update %MENHIR::toWString(curNode.toString(true,column)));    
-        putNodeORAM(curNode); //writing nodes back to ORAM
-        nodes[i]=curNode;
+        (*nodes)[i]=curNode;
 
     }
     return make_tuple(balance_n,balance_child,balance_childschild, balanceType );
@@ -729,52 +941,74 @@ tuple<ulong,ulong,ulong, int> AVLTree::insertHelper_updateParents(int column, AV
 
 /**
  * @brief This function updates the pointer to the next node of the new node and the node that needs to point at the new node.
+ * The prior node is always on the path to the new node, so it is taken from the path buffer instead of the ORAM.
  * 
- * @param nodeID 
+ * @param newNode 
  * @param column 
- * @param nodes 
- * @param lORr 
+ * @param nodes : path buffer holding the nodes from root to leaf, updated in place
+ * @param prePtr : ID of the node that needs to point at the new node (NULL_PTR if the new node is the smallest node)
+ * @param nextIDIfFirst : ID of the successor of the new node if it is the smallest node
  */
-void AVLTree::insertHelper_updateNext(ulong nodeID, int column, ulong prePtr, ulong nextIDIfFirst){
+void AVLTree::insertHelper_updateNext(AVLTreeNode *newNode, int column, vector<AVLTreeNode> *nodes, ulong prePtr, ulong nextIDIfFirst){
 
 
     if(CURRENT_LEVEL==DEBUG) LOG(DEBUG, L"Updating the pointers to the next node for the new node and its prior.");    
 
-
-    AVLTreeNode newNode=getNodeORAM(nodeID);
-
     // case1: new node is smallest possible node.
     bool isFirst=(prePtr == NULL_PTR);
     if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"isFirst %d, nextIDIfFirst:%d") %isFirst %nextIDIfFirst);    
-    newNode.next[column]=_IF_THEN(isFirst,nextIDIfFirst, newNode.next[column]);
-    if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"newNode (update %d): %s") %isFirst %MENHIR::toWString(newNode.toString(true,column)));    
+    newNode->next[column]=_IF_THEN(isFirst,nextIDIfFirst, newNode->next[column]);
   
     //all other cases
-    AVLTreeNode prior=getNodeORAM(prePtr); 
-    ulong nextID=prior.next[column];
-    prior.next[column]=nodeID;
-    putNodeORAM(prior,isFirst); //if isFirst is true, then the prior node is a dummy
+    ulong nextID=NULL_PTR;
+    for (size_t i = 0; i < nodes->size(); i++){
+        bool isPrior= (not isFirst) and ((*nodes)[i].nodeID==prePtr);
+        nextID=_IF_THEN(isPrior, (*nodes)[i].next[column], nextID);
+        (*nodes)[i].next[column]=_IF_THEN(isPrior, newNode->nodeID, (*nodes)[i].next[column]);
+    }
 
-    newNode.next[column]=_IF_THEN((not isFirst),nextID, newNode.next[column]);
-    putNodeORAM(newNode);
-    if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"newNode (update %d): %s") %(not isFirst) %MENHIR::toWString(newNode.toString(true,column)));    
+    newNode->next[column]=_IF_THEN((not isFirst),nextID, newNode->next[column]);
+    if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"newNode (update %d): %s") %(not isFirst) %MENHIR::toWString(newNode->toString(true,column)));    
 
 }
 
 
 /**
- * @brief 
+ * @brief Rebalances the tree after an insertion. All nodes taking part in a rotation are either on the path to the new node or the new node itself.
+ * They are therefore located in the path buffer (or newNode) and updated in place.
  * 
+ * @param column
+ * @param nodes : path buffer holding the nodes from root to leaf
+ * @param newNode
  * @param balance_n 
  * @param balance_child 
  * @param balance_childschild 
  * @param balanceType 
  */
-void AVLTree::insertHelper_rebalance(uint column, ulong balance_n, ulong balance_child, ulong balance_childschild, int balanceType){
-    //rebalancing
-    AVLTreeNode  n= getNodeORAM(balance_n);
-    AVLTreeNode child=getNodeORAM(balance_child);
-    AVLTreeNode childChild=getNodeORAM(balance_childschild);
+void AVLTree::insertHelper_rebalance(uint column, vector<AVLTreeNode> *nodes, AVLTreeNode *newNode, ulong balance_n, ulong balance_child, ulong balance_childschild, int balanceType){
+    //candidates: path buffer, new node and a dummy for the case that no node requires rebalancing
+    AVLTreeNode dummyNode(columnFormat, sizeValue);
+    vector<AVLTreeNode*> candidates;
+    candidates.reserve(nodes->size()+2);
+    for (size_t i = 0; i < nodes->size(); i++){
+        candidates.push_back(&(*nodes)[i]);
+    }
+    candidates.push_back(newNode);
+    candidates.push_back(&dummyNode);
+
+    size_t idxN=candidates.size()-1;
+    size_t idxChild=candidates.size()-1;
+    size_t idxChildChild=candidates.size()-1;
+    for (size_t i = 0; i < candidates.size()-1; i++){
+        ulong id=candidates[i]->nodeID;
+        bool notDummy= id!=NULL_PTR;
+        idxN=_IF_THEN((notDummy and id==balance_n), i, idxN);
+        idxChild=_IF_THEN((notDummy and id==balance_child), i, idxChild);
+        idxChildChild=_IF_THEN((notDummy and id==balance_childschild), i, idxChildChild);
+    }
+    AVLTreeNode &n=*candidates[idxN];
+    AVLTreeNode &child=*candidates[idxChild];
+    AVLTreeNode &childChild=*candidates[idxChildChild];
     
     if(CURRENT_LEVEL==DEBUG) LOG(DEBUG, boost::wformat(L"balanceType %d on \nNode %s,\n     Child %s,}\n    childChild %s") 
             %balanceType
@@ -819,10 +1053,6 @@ void AVLTree::insertHelper_rebalance(uint column, ulong balance_n, ulong balance
             %MENHIR::toWString(childChild.toString(true,column))
             );
     }
-    putNodeORAM(n);
-    putNodeORAM(child);
-    putNodeORAM(childChild, (not doubleRotation));
-
     //update root if rebalancing node n was the root itself
     bool balanceNodeWasRoot=(n.nodeID==ptrRoot[column]);
 
@@ -842,6 +1072,12 @@ void AVLTree::insertHelper_rebalance(uint column, ulong balance_n, ulong balance
  * @param nodeID 
  */
 void AVLTree::insertHelper(vector<db_t> key, size_t nodeHash, bytes value, ulong nodeID){
+
+    if(indexMode==LEAF_PAGES){
+        insertLeafPages(key, nodeHash);
+    }else if(indexMode==RANK_LAYOUT){
+        insertRankLayout(key, nodeHash);
+    }
     
     if(treeSize==0){
         AVLTreeNode newNode=AVLTreeNode(key, nodeHash, value,columnFormat,nodeID );
@@ -855,15 +1091,197 @@ void AVLTree::insertHelper(vector<db_t> key, size_t nodeHash, bytes value, ulong
 
     AVLTreeNode newNode=AVLTreeNode(key, nodeHash,value, columnFormat,nodeID );
     treeSize=treeSize+1;
-    putNodeORAM(newNode); 
     if(CURRENT_LEVEL==TRACE) LOG(TRACE, L"\nNewNode: "+MENHIR::toWString(newNode.toStringFull(true)));    
     for (size_t j = 0; j < numColumns; j++){
-        auto[nodes,lORr,toInsert, prePtr,nextIDIfFirst]=insertHelper_findParent(j, newNode);
-        auto[n,child,childchild,balancetype]=insertHelper_updateParents(j,newNode, nodes,lORr,toInsert); //
-        insertHelper_updateNext(nodeID, j, prePtr,nextIDIfFirst); //1 ORAM READ, 1 ORAM Write 
-        insertHelper_rebalance(j,n,child,childchild,balancetype);
+        insertHelper_column(j, &newNode, nullptr);
+    }
+    //the new node is not reachable in the ORAM before it is written, so it is only written once for all columns
+    putNodeORAM(newNode);
+}
+
+/**
+ * @brief Inserts newNode into the tree of one column. The path is read once into the path buffer (pad reads), all updates happen in the enclave.
+ * Afterwards the path is written back (pad writes). newNode itself is only updated in memory.
+ * 
+ * @param column 
+ * @param newNode 
+ * @param fragment : if not nullptr, nodes are read from and written to this prefetched part of the tree instead of the ORAM (used by insertBatch)
+ */
+void AVLTree::insertHelper_column(ulong column, AVLTreeNode *newNode, unordered_map<ulong,AVLTreeNode> *fragment){
+    auto[nodes,lORr,toInsert, prePtr,nextIDIfFirst]=insertHelper_findParent(column, *newNode, fragment);
+    auto[n,child,childchild,balancetype]=insertHelper_updateParents(column,*newNode, &nodes,lORr,toInsert);
+    insertHelper_updateNext(newNode, column, &nodes, prePtr,nextIDIfFirst);
+    insertHelper_rebalance(column, &nodes, newNode, n,child,childchild,balancetype);
+
+    for (size_t i = 0; i < nodes.size(); i++){
+        if(fragment==nullptr){
+            putNodeORAM(nodes[i]);
+        }else if(nodes[i].nodeID!=NULL_PTR){
+            fragment->insert_or_assign(nodes[i].nodeID, nodes[i]);
+        }
+    }
+}
+
+/**
+ * @brief Inserts a batch of records. Instead of descending the tree once per record, the union of all search paths is fetched level by level into an enclave-side fragment.
+ * The records are then inserted one after another in memory (sorted by the current column) and the fragment is written back at the end.
+ * The number of ORAM reads per column is sum_l min(2^l, batchsize) over all levels l<pad, so it only depends on the batch size and the tree size. 
+ * 
+ * @param keys : records to insert
+ * @return vector<size_t> : hashes for the inserted records in the order of keys
+ */
+vector<size_t> AVLTree::insertBatch(vector<vector<db_t>> keys){
+    vector<size_t> hashes;
+    for (size_t i = 0; i < keys.size(); i++){
+        if(keys[i].size()!=(size_t)(numColumns)){
+            throw std::invalid_argument("The number of Keys passed is not equal to the number of columns.");
+        }
+    }
+    if(treeSize+keys.size()>maxCapacity){
+        LOG(ERROR,L"No more new Elements can be inserted.");
+        return hashes;
+    }
+    if(keys.size()==0){
+        return hashes;
+    }
+
+    size_t start=0;
+    if(treeSize==0){
+        //the first node becomes the root, there is no path to prefetch
+        hashes.push_back(insert(keys[0]));
+        start=1;
+    }
+
+    bytes value= vector<uchar> (sizeValue, 0);
+    vector<RankRecord> batch;
+    unordered_map<size_t,ulong> nodeIDs; //nodeHash -> nodeID
+    for (size_t i = start; i < keys.size(); i++){
+        ulong nodeID=getNewORAMID();
+        size_t nodeHash=getNodeHash(keys[i], value, nodeID);
+        hashes.push_back(nodeHash);
+        batch.push_back(RankRecord(keys[i], nodeHash, columnFormat));
+        nodeIDs[nodeHash]=nodeID;
+    }
+    if(batch.size()==0){
+        return hashes;
+    }
+    LOG(DEBUG, boost::wformat(L"Insert batch of %d records") %batch.size());
+
+    //the paths are prefetched for the size of the tree after the batch
+    size_t sizeBefore=treeSize;
+    treeSize=sizeBefore+batch.size();
+    int pad=getPad();
+    unordered_map<ulong,AVLTreeNode> fragment;
+    number reads=0;
+
+    for (size_t c = 0; c < numColumns; c++){
+        obliviousSortRecords(&batch, c);
+        reads+=insertBatch_prefetch(c, batch, &fragment, pad);
+
+        //as for single insertions, the padding of each insertion depends on the size of the tree in this column
+        treeSize=sizeBefore;
+        for (size_t i = 0; i < batch.size(); i++){
+            ulong nodeID=nodeIDs[batch[i].nodeHash];
+            if(c==0){
+                if(indexMode==LEAF_PAGES){
+                    insertLeafPages(batch[i].keys, batch[i].nodeHash);
+                }else if(indexMode==RANK_LAYOUT){
+                    insertRankLayout(batch[i].keys, batch[i].nodeHash);
+                }
+                fragment.insert_or_assign(nodeID, AVLTreeNode(batch[i].keys, batch[i].nodeHash, value, columnFormat, nodeID));
+            }
+            treeSize=treeSize+1;
+            AVLTreeNode newNode=fragment.at(nodeID);
+            insertHelper_column(c, &newNode, &fragment);
+            fragment.insert_or_assign(nodeID, newNode);
+        }
+    }
+
+    //writing back the fragment, padded to the number of reads plus the new nodes
+    number writes=0;
+    for (auto &entry : fragment){
+        putNodeORAM(entry.second);
+        writes++;
+    }
+    AVLTreeNode dummyNode(columnFormat, sizeValue);
+    for (; writes < reads+batch.size(); writes++){
+        putNodeORAM(dummyNode, true);
+    }
+
+    if(CURRENT_LEVEL<=TRACE){
+        for (size_t i = 0; i < numColumns; i++){
+            this->print(TRACE, ptrRoot[i],true,i);
+        }
+    }
+    return hashes;
+}
+
+/**
+ * @brief Fetches the union of the search paths of all records in the batch for one column into the fragment. 
+ * The tree is traversed level by level. On level l at most min(2^l, batchsize) distinct nodes can be on the search paths, 
+ * so exactly this many ORAM reads are executed per level. Nodes that are already part of the fragment (or do not exist) are replaced by dummy reads.
+ * 
+ * @param column 
+ * @param batch : records of the batch
+ * @param fragment : prefetched nodes by nodeID
+ * @param pad : number of levels to traverse
+ * @return number : number of ORAM reads
+ */
+number AVLTree::insertBatch_prefetch(ulong column, vector<RankRecord> batch, unordered_map<ulong,AVLTreeNode> *fragment, int pad){
+    vector<ulong> ptrs(batch.size(), ptrRoot[column]);
+    number reads=0;
+
+    for (int l = 0; l < pad; l++){
+        number slots= (l<63)? min((number) 1<<l, (number) batch.size()) : (number) batch.size();
+        set<ulong> distinct(ptrs.begin(), ptrs.end());
+        distinct.erase(NULL_PTR);
+
+        number used=0;
+        for (ulong ptr : distinct){
+            bool known= fragment->count(ptr)>0;
+            AVLTreeNode node=getNodeORAM(ptr, known);
+            if(not known){
+                fragment->insert_or_assign(ptr, node);
+            }
+            used++;
+        }
+        for (; used < slots; used++){
+            getNodeORAM(NULL_PTR, true);
+        }
+        reads+=max(slots, (number) distinct.size());
+
+        for (size_t i = 0; i < batch.size(); i++){
+            if(ptrs[i]==NULL_PTR){
+                continue;
+            }
+            AVLTreeNode &node=fragment->at(ptrs[i]);
+            db_t key=batch[i].keys[column];
+            bool takeLeft=(key<node.key[column] or (key==node.key[column] and batch[i].nodeHash<node.nodeHash));
+            ptrs[i]=_IF_THEN(takeLeft, node.ptrLeftChild[column], node.ptrRightChild[column]);
+        }
+    }
+    return reads;
+}
 
+/**
+ * @brief Returns a node from the prefetched fragment. 
+ * All nodes touched by an insertion are on a search path of the batch: a rotation only moves nodes that are on the path of the record that caused it, 
+ * so the path of a later record in the rotated tree only contains nodes of its own prefetched path, of earlier paths or new nodes. 
+ * A missing node would require an additional ORAM read that depends on the data, so it is treated as an error.
+ * 
+ * @param nodePtr 
+ * @param fragment 
+ * @return AVLTreeNode 
+ */
+AVLTreeNode AVLTree::getNodeFragment(ulong nodePtr, unordered_map<ulong,AVLTreeNode> *fragment){
+    if(nodePtr==NULL_PTR){
+        return AVLTreeNode(columnFormat, sizeValue);
     }
+    auto it=fragment->find(nodePtr);
+    if(it==fragment->end()){
+        __throw_logic_error("Node was not prefetched for the batch insert.");
+    }
+    return it->second;
 }
 
 /**
@@ -897,7 +1315,7 @@ tuple<AVLTreeNode ,ulong,uint> AVLTree::balance(AVLTreeNode node, ulong nodePtr,
     int r_balanceFactor= R.balanceFactor(column);
     //cout<<"Balance factors of Node n("<<node.key<<" ,"<<node.nodeHash<<"): "<<n_balanceFactor <<" l: "<<l_balanceFactor<<" r:"<<r_balanceFactor<<endl;
 
-    if(n_balanceFactor>= 2 and l_balanceFactor>=1){
+    if(n_balanceFactor>= 2 and l_balanceFactor>=0){
         if(CURRENT_LEVEL==TRACE) LOG(TRACE, L"Right Rotate");
         AVLTreeNode LR=getNodeORAM(NULL_PTR, true);
         //right rotate
@@ -921,7 +1339,9 @@ tuple<AVLTreeNode ,ulong,uint> AVLTree::balance(AVLTreeNode node, ulong nodePtr,
 
         //change node : leftsubtree
         node.ptrLeftChild[column]=lr_ptr;
-        node.lHeight[column]=LR.height();
+        node.lHeight[column]=LR.height(column);
+        node.lCount[column]=LR.subtreeCount(column);
+        node.lSum[column]=LR.subtreeSum(column, aggregateColumn);
 
         //right rotate around node
         rightRotate(&node,nodePtr,&LR,column);
@@ -933,7 +1353,7 @@ tuple<AVLTreeNode ,ulong,uint> AVLTree::balance(AVLTreeNode node, ulong nodePtr,
         if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"end balance ---- ptr:%d  height: %d--------") % nodePtr  % node.height(column));
         return make_tuple(LR, lr_ptr,LR.height(column));
         
-    }else if(n_balanceFactor<=-2 and r_balanceFactor<=-1){
+    }else if(n_balanceFactor<=-2 and r_balanceFactor<=0){
         if(CURRENT_LEVEL==TRACE) LOG(TRACE,L"Left Rotate");
 
         //dummy reads
@@ -960,7 +1380,9 @@ tuple<AVLTreeNode ,ulong,uint> AVLTree::balance(AVLTreeNode node, ulong nodePtr,
 
         //change node : leftsubtree
         node.ptrRightChild[column]=rl_ptr;
-        node.rHeight[column]=RL.height();
+        node.rHeight[column]=RL.height(column);
+        node.rCount[column]=RL.subtreeCount(column);
+        node.rSum[column]=RL.subtreeSum(column, aggregateColumn);
 
         //right rotate around node
         leftRotate(&node,nodePtr,&RL,column);
@@ -983,6 +1405,8 @@ tuple<AVLTreeNode ,ulong,uint> AVLTree::balance(AVLTreeNode node, ulong nodePtr,
         //change node : leftsubtree
         L.ptrRightChild[column]=rl_ptr;
         L.rHeight[column]=RL.height(column);
+        L.rCount[column]=RL.subtreeCount(column);
+        L.rSum[column]=RL.subtreeSum(column, aggregateColumn);
 
         //right rotate around node
         leftRotate(&L,l_ptr,&RL,column);
@@ -1015,12 +1439,20 @@ void AVLTree::singleRotate(AVLTreeNode *node, AVLTreeNode *child, ulong column,
     child->ptrLeftChild[column]=_IF_THEN(leftRotate, node->nodeID, child->ptrLeftChild[column]);
     node->rHeight[column]=_IF_THEN(leftRotate, child->lHeight[column],node->rHeight[column]);
     child->lHeight[column]=_IF_THEN(leftRotate, node->height(column),child->lHeight[column] );
+    node->rCount[column]=_IF_THEN(leftRotate, child->lCount[column], node->rCount[column]);
+    node->rSum[column]=_IF_THEN(leftRotate, child->lSum[column], node->rSum[column]);
+    child->lCount[column]=_IF_THEN(leftRotate, node->subtreeCount(column), child->lCount[column]);
+    child->lSum[column]=_IF_THEN(leftRotate, node->subtreeSum(column, aggregateColumn), child->lSum[column]);
     
     bool rightRotate=(not left) and rotate;
     node->ptrLeftChild[column]=_IF_THEN(rightRotate, child->ptrRightChild[column], node->ptrLeftChild[column]);
     child->ptrRightChild[column]=_IF_THEN( rightRotate, node->nodeID, child->ptrRightChild[column]);
     node->lHeight[column]=_IF_THEN(rightRotate,child->rHeight[column],node->lHeight[column]) ;
     child->rHeight[column]=_IF_THEN(rightRotate, node->height(column), child->rHeight[column]);
+    node->lCount[column]=_IF_THEN(rightRotate, child->rCount[column], node->lCount[column]);
+    node->lSum[column]=_IF_THEN(rightRotate, child->rSum[column], node->lSum[column]);
+    child->rCount[column]=_IF_THEN(rightRotate, node->subtreeCount(column), child->rCount[column]);
+    child->rSum[column]=_IF_THEN(rightRotate, node->subtreeSum(column, aggregateColumn), child->rSum[column]);
 
 }
 
@@ -1031,6 +1463,10 @@ void AVLTree::rightRotate(AVLTreeNode *node,ulong nodePtr, AVLTreeNode *L, ulong
     L->ptrRightChild[column]=nodePtr;
     node->lHeight[column]=L->rHeight[column];
     L->rHeight[column]=node->height(column);
+    node->lCount[column]=L->rCount[column];
+    node->lSum[column]=L->rSum[column];
+    L->rCount[column]=node->subtreeCount(column);
+    L->rSum[column]=node->subtreeSum(column, aggregateColumn);
 }
 
 
@@ -1040,6 +1476,10 @@ void AVLTree::leftRotate(AVLTreeNode *node,ulong nodePtr, AVLTreeNode *R, ulong
     R->ptrLeftChild[column]=nodePtr;
     node->rHeight[column]=R->lHeight[column];
     R->lHeight[column]=node->height(column);
+    node->rCount[column]=R->lCount[column];
+    node->rSum[column]=R->lSum[column];
+    R->lCount[column]=node->subtreeCount(column);
+    R->lSum[column]=node->subtreeSum(column, aggregateColumn);
         
 }
  
@@ -1056,16 +1496,20 @@ void AVLTree::leftRotate(AVLTreeNode *node,ulong nodePtr, AVLTreeNode *R, ulong
  * @param key :key for node that is to be deleted.
  * @param nodeHash : hash for node to be deleted.
  * @param column : Column in which key is stored.
+ * @param removedKeys : if not nullptr, contains the keys of the deleted node afterwards (the keys of the NULL node if no node matched)
+ * @return true : a node was deleted
+ * @return false : no node matched, only dummy operations were executed
  */
-void AVLTree::deleteEntry(db_t key, size_t nodeHash, ulong column){
+bool AVLTree::deleteEntry(db_t key, size_t nodeHash, ulong column, vector<db_t> *removedKeys){
     LOG( DEBUG,boost::wformat( L"DOSM delete: [ %d ]- %d") % DBT::toWString(key) % nodeHash);
-    deleteHelper(key, nodeHash,column);
+    bool found=deleteHelper(key, nodeHash,column,removedKeys);
     
     if(CURRENT_LEVEL<=TRACE){
         for (size_t i = 0; i < numColumns; i++){
             this->print(TRACE,ptrRoot[i],true,i);
         }
     }
+    return found;
 }
 
 /**
@@ -1074,27 +1518,82 @@ void AVLTree::deleteEntry(db_t key, size_t nodeHash, ulong column){
  * @param key 
  * @param nodeHash 
  * @param column 
+ * @param removedKeys : if not nullptr, contains the keys of the deleted node afterwards
+ * @return true : a node was deleted
  */
-void AVLTree::deleteHelper(db_t key, size_t nodeHash, ulong column){
+bool AVLTree::deleteHelper(db_t key, size_t nodeHash, ulong column, vector<db_t> *removedKeys){
 
-    //find the correct node based on the passed column and update this column
+    //find the correct node based on the passed column
     auto[deletePtr,nodes,ptrsNodes,lORr]=deleteHelper_findNode(key,nodeHash, column);
     AVLTreeNode delNode=getNodeORAM(deletePtr);
-    auto[repPtr,repHeight,repKey]=deleteHelper_findReplacement(deletePtr,delNode, column);
-    deleteHelper_updateNodes(deletePtr,repPtr, repHeight,  repKey, nodes,ptrsNodes, lORr, column);
+    numNodeTombstones=numNodeTombstones-(number)delNode.tombstone;
+    if(indexMode==LEAF_PAGES){
+        deleteLeafPages(key, nodeHash, column);
+    }else if(indexMode==RANK_LAYOUT){
+        deleteRankLayout(key, nodeHash, column);
+    }
 
-    //update all remaining columns
+    //the node is removed from the tree of every column, each with its own padded descent
     for (size_t i = 0; i < numColumns; i++){
-        if(i==column){
-            continue;
-        }
-        auto[repPtr,repHeight,repKey]=deleteHelper_findReplacement(deletePtr,delNode,i);
-        auto[deletePtr,nodes,ptrsNodes,lORr]=deleteHelper_findNode(delNode.key[i],delNode.nodeHash, column);
-        deleteHelper_updateNodes(deletePtr,repPtr, repHeight,  repKey, nodes,ptrsNodes, lORr,  i);
+        deleteHelper_removeNode(deletePtr, delNode, i);
+    }
+    //range scans and exportRecords() follow the next pointers, so they must skip the deleted node
+    for (size_t i = 0; i < numColumns; i++){
+        deleteHelper_updateNext(delNode, i);
+    }
+    //the interface deletes from every OSM, so in all but one tree no node matches and only dummy operations are executed
+    bool found=(deletePtr!=NULL_PTR);
+    deleteNodeORAM(deletePtr, not found); //makes the nodeID available again
+    treeSize=treeSize-(number)found;
+    if(removedKeys!=nullptr){
+        *removedKeys=delNode.key;
+    }
+    return found;
+}
+
+
+/**
+ * @brief Marks an entry as deleted (tombstone) instead of removing it from the tree. This needs one padded lookup and one write, 
+ * the tree structure is not changed. Scans and lookups skip marked nodes, they are only removed when the tree is rebuilt.
+ * If no node matches, a dummy write is executed.
+ * 
+ * @param key : key for node that is to be marked.
+ * @param nodeHash : hash for node to be marked.
+ * @param column : Column in which key is stored.
+ * @param removedKeys : if not nullptr, contains the keys of the marked node afterwards (the keys of the NULL node if no node matched)
+ * @return true : a node was marked
+ * @return false : no node matched, only a dummy write was executed
+ */
+bool AVLTree::markDeleted(db_t key, size_t nodeHash, ulong column, vector<db_t> *removedKeys){
+    LOG( DEBUG,boost::wformat( L"DOSM mark deleted: [ %d ]- %d") % DBT::toWString(key) % nodeHash);
+    int pad=getPad();
+    ulong markPtr=NULL_PTR;
+    ulong ptrCur=ptrRoot[column];
+    for(int i=0; i<pad;i++){
+        AVLTreeNode curNode=getNodeORAM(ptrCur);
+        bool toMark= (key==curNode.key[column]) and (nodeHash==curNode.nodeHash) and (not curNode.tombstone) and (ptrCur!=NULL_PTR);
+        markPtr=_IF_THEN(toMark, ptrCur, markPtr);
+
+        bool takeLeft= key<curNode.key[column] or (key==curNode.key[column] and nodeHash<curNode.nodeHash);
+        ptrCur=_IF_THEN(takeLeft, curNode.ptrLeftChild[column], curNode.ptrRightChild[column]);
     }
-    deleteNodeORAM(deletePtr); //makes the nodeID available again
-    treeSize=treeSize-1;
 
+    bool found=(markPtr!=NULL_PTR);
+    AVLTreeNode markNode=getNodeORAM(markPtr);
+    markNode.tombstone=true;
+    putNodeORAM(markNode, not found);
+    numNodeTombstones=numNodeTombstones+(number)found;
+
+    //the leaf pages and the rank layout are maintained as for regular deletes (the rank layout only marks records as well)
+    if(indexMode==LEAF_PAGES){
+        deleteLeafPages(key, nodeHash, column);
+    }else if(indexMode==RANK_LAYOUT){
+        deleteRankLayout(key, nodeHash, column);
+    }
+    if(removedKeys!=nullptr){
+        *removedKeys=markNode.key;
+    }
+    return found;
 }
 
 
@@ -1152,203 +1651,118 @@ AVLTree::deleteHelper_findNode(db_t key, size_t nodeHash, ulong column){
 }
 
 /**
- * @brief Subroutine for deleting AVLTreeNode from AVLTree. Searches for replacement of node that is to be deleted.
- * This function is called to cover the case where the node has only one subtree.
- * @param deletePtr : pointer of node to be deleted
- * @param delNode : Node to be deleted
+ * @brief Subroutine for deleting AVLTreeNode from AVLTree. Removes the node from the tree of one column and rebalances the tree.
+ * A single padded descent records the path to the node and, below it, the path to its in-order successor (the leftmost node of its right subtree).
+ * If the node has two children, the successor takes its place, otherwise its only child (or NULL_PTR) does.
+ * Afterwards, the path is rebalanced bottom-up with one call to balance() per level, levels that are not changed only execute dummy writes.
+ * 
+ * @param deletePtr : ID of the node to be deleted, NULL_PTR if no node matches (only dummy operations are executed)
+ * @param delNode : the node to be deleted
  * @param column : column for which the (multi-)AVLTree is currently updated
- * @return tuple<ulong,int,db_t> : returns tuple consisting of ID, height and key of the replacement node.
  */
-tuple<ulong,int,db_t>
-AVLTree::deleteHelper_findReplacement(ulong deletePtr,AVLTreeNode delNode, ulong column){
-    //cout<<"\nFIND Replacement"<<endl;
+void AVLTree::deleteHelper_removeNode(ulong deletePtr, AVLTreeNode delNode, ulong column){
     int pad=getPad();
-    ulong repPtr;
-    int height;
-    db_t repKey;
-    AVLTreeNode repNode(columnFormat, sizeValue);
-    bool rCexists= (delNode.ptrRightChild[column]!=NULL_PTR);
-    bool lCexists= (delNode.ptrLeftChild[column]!=NULL_PTR);
-    bool twoC=(rCexists and lCexists);
-    bool noC =(not rCexists)and (not lCexists);
-    
-    bool dummyExc= not(rCexists and lCexists);
-    repPtr=findReplacement_twoSubtrees(pad,deletePtr,delNode,column,dummyExc );
-
-    ulong temp_repPtr=NULL_PTR;
-    temp_repPtr=        _IF_THEN((lCexists and not rCexists),delNode.ptrLeftChild[column],temp_repPtr);
-    temp_repPtr=        _IF_THEN((rCexists and not lCexists),delNode.ptrRightChild[column], temp_repPtr);
-    temp_repPtr=        _IF_THEN(twoC,repPtr, temp_repPtr);
-    repPtr=temp_repPtr;
-    AVLTreeNode N= getNodeORAM(repPtr);
-    height=_IF_THEN(noC,0,N.height(column)); 
-    repKey=_IF_THEN(noC,delNode.key[column], N.key[column]); 
-    //cout<<"deleteHelper_findReplacement: "<<repPtr<<" "<<"height "<<height<< " size "<<size<<" repKey "<<DBT::toString(repKey)<<endl;
-    //cout<< "Node N :"<<N.toStringFull(true)<<endl;
-    return make_tuple(repPtr,height, repKey);
+    auto[foundPtr,nodes,ptrsNodes,lORr]=deleteHelper_findNode(delNode.key[column],delNode.nodeHash, column);
+    bool nodeExists=(deletePtr!=NULL_PTR);
+
+    bool lCexists=(delNode.ptrLeftChild[column]!=NULL_PTR);
+    bool rCexists=(delNode.ptrRightChild[column]!=NULL_PTR);
+    bool twoC=(lCexists and rCexists);
+
+    //position of the node and of its successor (the last real node of the path) in the path
+    int delIndex=-1;
+    int repIndex=-1;
+    for(int i=0;i<pad;i++){
+        delIndex=_IF_THEN((ptrsNodes[i]==deletePtr and nodeExists), i, delIndex);
+        repIndex=_IF_THEN((ptrsNodes[i]!=NULL_PTR), i, repIndex);
+    }
+    repIndex=_IF_THEN(twoC, repIndex, -1);
+
+    //root, height and aggregates of the subtree that replaces the subtree of the current level
+    ulong subPtr=NULL_PTR;
+    uint subHeight=0;
+    number subCount=0;
+    double subSum=0.0;
+    bool active=false;
+    for(int i=pad-1;i>=0;i--){
+        AVLTreeNode curNode=nodes[i];
+        ulong ptrCur=ptrsNodes[i];
+        bool isRep=(i==repIndex);
+        bool isDel=(i==delIndex);
+
+        //the successor is moved up, its right subtree takes its place
+        subPtr=_IF_THEN(isRep, curNode.ptrRightChild[column], subPtr);
+        subHeight=_IF_THEN(isRep, curNode.rHeight[column], subHeight);
+        subCount=_IF_THEN(isRep, curNode.rCount[column], subCount);
+        subSum=_IF_THEN(isRep, curNode.rSum[column], subSum);
+
+        //the node to be deleted is replaced by its successor or by its only child
+        AVLTreeNode repNode=nodes[max(repIndex,0)];
+        bool replaceByChild=isDel and not twoC;
+        ulong childPtr=_IF_THEN(lCexists, delNode.ptrLeftChild[column], delNode.ptrRightChild[column]);
+        uint childHeight=_IF_THEN(lCexists, delNode.lHeight[column], delNode.rHeight[column]);
+        subPtr=_IF_THEN(replaceByChild, childPtr, subPtr);
+        subHeight=_IF_THEN(replaceByChild, childHeight, subHeight);
+        number childCount=_IF_THEN(lCexists, delNode.lCount[column], delNode.rCount[column]);
+        double childSum=_IF_THEN(lCexists, delNode.lSum[column], delNode.rSum[column]);
+        subCount=_IF_THEN(replaceByChild, childCount, subCount);
+        subSum=_IF_THEN(replaceByChild, childSum, subSum);
+        bool replaceByRep=isDel and twoC;
+        curNode=selectNode(replaceByRep, repNode, curNode);
+        ptrCur=_IF_THEN(replaceByRep, repNode.nodeID, ptrCur);
+        curNode.ptrLeftChild[column]=_IF_THEN(replaceByRep, delNode.ptrLeftChild[column], curNode.ptrLeftChild[column]);
+        curNode.lHeight[column]=_IF_THEN(replaceByRep, delNode.lHeight[column], curNode.lHeight[column]);
+        curNode.lCount[column]=_IF_THEN(replaceByRep, delNode.lCount[column], curNode.lCount[column]);
+        curNode.lSum[column]=_IF_THEN(replaceByRep, delNode.lSum[column], curNode.lSum[column]);
+        bool isLeft=lORr[i] and not replaceByRep;
+
+        //the levels above the changed subtree link to its new root
+        bool link=(active and not isRep and not replaceByChild) or replaceByRep;
+        curNode.ptrLeftChild[column]=_IF_THEN((link and isLeft), subPtr, curNode.ptrLeftChild[column]);
+        curNode.lHeight[column]=_IF_THEN((link and isLeft), subHeight, curNode.lHeight[column]);
+        curNode.ptrRightChild[column]=_IF_THEN((link and not isLeft), subPtr, curNode.ptrRightChild[column]);
+        curNode.rHeight[column]=_IF_THEN((link and not isLeft), subHeight, curNode.rHeight[column]);
+        curNode.lCount[column]=_IF_THEN((link and isLeft), subCount, curNode.lCount[column]);
+        curNode.lSum[column]=_IF_THEN((link and isLeft), subSum, curNode.lSum[column]);
+        curNode.rCount[column]=_IF_THEN((link and not isLeft), subCount, curNode.rCount[column]);
+        curNode.rSum[column]=_IF_THEN((link and not isLeft), subSum, curNode.rSum[column]);
+
+        //rotations do not change the aggregates of the whole subtree
+        subCount=_IF_THEN(link, curNode.subtreeCount(column), subCount);
+        subSum=_IF_THEN(link, curNode.subtreeSum(column, aggregateColumn), subSum);
+
+        curNode.empty=not link;
+        auto[ignore,ptrTemp,heightTemp]=balance(curNode,ptrCur,column); //calls putNodeORAM
+        subPtr=_IF_THEN(link, ptrTemp, subPtr);
+        subHeight=_IF_THEN(link, heightTemp, subHeight);
+
+        active=active or isRep or isDel;
+    }
+    ptrRoot[column]=_IF_THEN(nodeExists, subPtr, ptrRoot[column]);
 }
 
 /**
- * @brief Subroutine for deleting AVLTreeNode from AVLTree. Searches for replacement of node that is to be deleted.
- * This function is called to cover the case where the node has two subtrees.
+ * @brief Subroutine for deleting AVLTreeNode from AVLTree. Sets the next pointer of the predecessor of the deleted node to the successor of the deleted node. 
+ * Is called after the node was removed from the tree of the column. The predecessor is found with a padded descent; 
+ * if the deleted node was the first node of the column, a dummy write is executed.
  * 
- * @param pad : worst case hight of current AVL tree, used for padding number of  accessed
- * @param deletePtr : pointer of node to be deleted
- * @param delNode : Node to be deleted
- * @param column : column for which the (multi-)AVLTree is currently updated
- * @param dummyExc : wether execution this function  is just a dummy operation or not. 
- * @return ulong : returns pointer of replacement node
+ * @param delNode : the deleted node as read before the deletion
+ * @param column : column for which the next pointers are updated
  */
-ulong AVLTree::findReplacement_twoSubtrees(int pad, ulong deletePtr,AVLTreeNode delNode, ulong column, bool dummyExc){
-        bool dummy=false;
-        vector<AVLTreeNode > nodes;
-            vector<ulong> ptrsNodes;
-            ulong ptrParent=deletePtr;
-            ulong repPtr= delNode.ptrRightChild[column];
-            db_t repKey=delNode.key[column];
-
-            AVLTreeNode curNode(columnFormat,sizeValue);
-            ulong ptrCur=repPtr;
-
-            //cout<<"going from del Node to most leftChild of Right Tree"<<endl;
-            for(int i=0; i<pad;i++){
-
-                curNode=getNodeORAM(ptrCur);
-                nodes.push_back(curNode);
-                ptrsNodes.push_back(ptrCur);
-
-                repPtr=_IF_THEN(((bool) curNode.ptrLeftChild[column]),curNode.ptrLeftChild[column],repPtr);//(not(bool) curNode.ptrLeftChild)*repPtr+curNode.ptrLeftChild; 
-                repKey=_IF_THEN(((bool)ptrCur),curNode.key[column],repKey);
-
-                //cout<<"i:"<<i<<" cur:" <<ptrCur<<" repPtr: "<<repPtr<<endl;
-
-                ulong temp=ptrCur;
-                ptrCur=curNode.ptrLeftChild[column];
-                ptrParent=_IF_THEN(((bool)ptrCur),temp,ptrParent);//ptrCur?temp:ptrParent;
-
-            }
-
-            //cout<<"repKey: "<<repKey<<endl;
-
-            bool foundRep=false;
-            int newHeight=0;
-
-            //cout<<"going backwards from most left child of right subtree to delNode"<<endl;
-            for(int i=pad-1;i>=0;i--){
-                curNode=nodes[i];
-                ptrCur=ptrsNodes[i];
-
-                bool isRep=not (bool)(ptrCur-repPtr);
-                foundRep= isRep or foundRep;
-
-                //update direkt Parent of Replacement: we alter this pointer twice
-                bool isParent=not ((bool)(curNode.ptrLeftChild[column]-repPtr));
-                curNode.ptrLeftChild[column]=_IF_THEN(isParent,NULL_PTR,curNode.ptrLeftChild[column]);//isParent? NULL_PTR:curNode.ptrLeftChild;
-                
-                //update size of all other nodes above replacement
-                bool notRep= not isRep;
-
-                curNode.lHeight[column]=_IF_THEN((foundRep and notRep), newHeight, curNode.lHeight[column]);//(found and notRep )? newHeight: curNode.lHeight;
-                newHeight=_IF_THEN((foundRep and notRep), curNode.height(column), newHeight);//(found and notRep )? curNode.height(): newHeight;
-
-                dummy=_IF_THEN((ptrCur==NULL_PTR), true,dummyExc);        
-                putNodeORAM(curNode,dummy);                
-
-            }
-
-            AVLTreeNode repNode=getNodeORAM(repPtr);
-            AVLTreeNode repParentNode=getNodeORAM(ptrParent);
-            AVLTreeNode repRChildNode=getNodeORAM(repNode.ptrRightChild[column]); //might be a Dummy
-            bool notDummy= (bool) repNode.ptrRightChild[column];
-
-            //cout<<"repNode.ptrRightChild "<<repNode.ptrRightChild<<endl;
-            //cout<<"repParentNode "<<ptrParent<<endl;
-
-            repParentNode.ptrLeftChild[column]=repNode.ptrRightChild[column];
-            repParentNode.lHeight[column]=_IF_THEN(notDummy,repRChildNode.height(column),0); 
-
-
-            dummy=_IF_THEN((ptrParent==NULL_PTR), true,dummyExc);        
-            putNodeORAM(repParentNode,dummy);
-
-            //update Replacement Node
-            bool sameNode=((bool) (delNode.ptrRightChild[column] ==repPtr));
-            repNode.ptrRightChild[column]=_IF_THEN(sameNode,NULL_PTR,delNode.ptrRightChild[column]);
-            repNode.ptrLeftChild[column]= delNode.ptrLeftChild[column];
-            repNode.lHeight[column]=delNode.lHeight[column];
-            repNode.rHeight[column]=newHeight;             
-
-
-            dummy=_IF_THEN((repPtr==NULL_PTR), true,dummyExc);        
-            putNodeORAM(repNode,dummy);
-            
-            return  repPtr;
-
-}
-
-/**
- * @brief Subroutine for deleting AVLTreeNode from AVLTree. Updates all nodes so the node to be deleted can be removed without leaving pointers to no where.
- * TODO: so balancing uses new functions.
- *
- * @param deletePtr : ID of node  to be deleted 
- * @param repPtr  : ID of replacement node
- * @param repHeight : Hight of replacement node
- * @param repKey : Key of replacement node for the corresponding column
- * @param nodes : nodes in the path from root to leaf (via the node to be deleted)
- * @param ptrsNodes : pointers of the nodes in nodes
- * @param lORr : wether path from root to leaf took a left or a right turn 
- * @param column : colum for which the (multi-)AVLTree is currently updated
- */
-void AVLTree::deleteHelper_updateNodes(ulong deletePtr, ulong repPtr, int repHeight,  db_t repKey, 
-        vector<AVLTreeNode > nodes, vector<ulong> ptrsNodes,vector<bool> lORr,  ulong column){
-    //cout<<"updating pointers"<<endl;
-
-    int update;
-    bool found=false; //we first need to find the node in our list
-    bool deleteThis=false;
+void AVLTree::deleteHelper_updateNext(AVLTreeNode delNode, ulong column){
     int pad=getPad();
-    bool nodeExists=(deletePtr!=0);
-
-    AVLTreeNode curNode(columnFormat, sizeValue);
-    ulong ptrCur=NULL_PTR;
-    for(int i=pad;i>0;i--){
-        //cout<<"found "<<found<<endl;
-        curNode=nodes[i-1];
-        ptrCur=ptrsNodes[i-1];
-        bool isLeft=lORr[i-1];
-
-        update= (int) (found and isLeft and nodeExists);
-        //cout<<"update left Child:"<<update<<endl;
-        curNode.ptrLeftChild[column]=_IF_THEN(update,repPtr,curNode.ptrLeftChild[column]);
-        update= (int) (found and (not isLeft)and nodeExists);
-        //cout<<"update right Child:"<<update<<endl;
-        curNode.ptrRightChild[column]=_IF_THEN(update,repPtr,curNode.ptrRightChild[column]);
-        
-        update =(int) (found and isLeft and nodeExists);
-        curNode.lHeight[column]=_IF_THEN(update,repHeight,curNode.lHeight[column]);
-        update =(int) (found and (not isLeft) and nodeExists);
-        curNode.rHeight[column]= _IF_THEN(update,repHeight,curNode.rHeight[column]);
-        
-
-        bool isReplacement= (curNode.nodeID==repPtr);
-        bool dummy=(!(bool)found) or isReplacement;
-        curNode.empty=dummy;
-        if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"updated CurNode %s (dummy %d)")%MENHIR::toWString(curNode.toStringFull(true)) %dummy);
-    
-        //TODO: Replace this call
-        auto[ignore,ptr_temp,height_temp]=balance(curNode,ptrCur,column); //calls putNodeORAM
-        
-        update=(int)found and nodeExists;
-        repPtr=_IF_THEN(update,ptr_temp,repPtr);
-        repHeight=_IF_THEN(update,height_temp,repHeight);
-
-        deleteThis=not ((bool)(deletePtr-ptrCur));
-        found=found or deleteThis;
+    ulong prePtr=NULL_PTR;
+    ulong ptrCur=ptrRoot[column];
+    for(int i=0; i<pad;i++){
+        AVLTreeNode curNode=getNodeORAM(ptrCur);
+        bool smaller= curNode.key[column]<delNode.key[column] or (curNode.key[column]==delNode.key[column] and curNode.nodeHash<delNode.nodeHash);
+        bool isPrior= smaller and (ptrCur!=NULL_PTR);
+        prePtr=_IF_THEN(isPrior, ptrCur, prePtr);
+        ptrCur=_IF_THEN(smaller, curNode.ptrRightChild[column], curNode.ptrLeftChild[column]);
     }
-        
-    //cout<<"deleteThis "<<deleteThis<<endl;
-    ptrRoot[column]=_IF_THEN(deleteThis,repPtr,ptrCur);
-    //cout<<"ptrRoot["<<column<<"]"<<ptrRoot[column]<<endl;
+    AVLTreeNode preNode=getNodeORAM(prePtr);
+    preNode.next[column]=delNode.next[column];
+    putNodeORAM(preNode, prePtr==NULL_PTR);
 }
 
 #pragma endregion
@@ -1410,7 +1824,7 @@ tuple<vector<db_t>,bool> AVLTree::findNodeHelper(db_t key, size_t nodeHash, ulon
 
         bool sameKey= (bool)(key==curNode.key[column]);
         bool sameHash= (bool)(nodeHash==curNode.nodeHash);
-        bool update=(sameKey and sameHash);
+        bool update=(sameKey and sameHash and not curNode.tombstone);
 
         for (size_t i = 0; i < numColumns; i++){
             thisData[i]=_IF_THEN(update, curNode.key[i], thisData[i]);
@@ -1444,7 +1858,10 @@ tuple<vector<db_t>,bool> AVLTree::findNodeHelper(db_t key, size_t nodeHash, ulon
 DBT::dbResponse AVLTree::findIntervalMenhir(db_t startKey, db_t endKey, ulong column, number estimate){
 
 
-    DBT::dbResponse results=findIntervalHelperMenhir(startKey, endKey, column, estimate);
+    DBT::dbResponse results;
+    scanInterval(startKey, endKey, column, estimate, [&results](const vector<db_t> &record, bool dummy){
+        results.push_back(make_tuple(record, dummy));
+    });
 
     if(CURRENT_LEVEL<=DEBUG){
         ostringstream oss;
@@ -1467,6 +1884,26 @@ DBT::dbResponse AVLTree::findIntervalMenhir(db_t startKey, db_t endKey, ulong co
 
 }
 
+/**
+ * @brief Same access pattern as findIntervalMenhir(), but instead of collecting the records, visit is called for each record as soon as it was read from the ORAM.
+ * The records are passed in the same order as they are returned by findIntervalMenhir(), so aggregates can be computed without storing the result.
+ * 
+ * @param startKey 
+ * @param endKey 
+ * @param column 
+ * @param estimate : number of data points to retrieve for hiding the volume pattern. This is effectively the number of dummies returned.
+ * @param visit : called with each record and wether it is a dummy
+ * @return number : number of visited records
+ */
+number AVLTree::scanInterval(db_t startKey, db_t endKey, ulong column, number estimate, DBT::recordVisitor visit){
+    if(indexMode==LEAF_PAGES){
+        return findIntervalHelperLeafPages(startKey, endKey, column, estimate, visit);
+    }else if(indexMode==RANK_LAYOUT){
+        return findIntervalHelperRankLayout(startKey, endKey, column, estimate, visit);
+    }
+    return findIntervalHelperMenhir(startKey, endKey, column, estimate, visit);
+}
+
 
 /**
  * @brief Subroutine for finding all entries for which the key in the passed column falls into [startKey,endKey].
@@ -1475,16 +1912,21 @@ DBT::dbResponse AVLTree::findIntervalMenhir(db_t startKey, db_t endKey, ulong co
  * @param endKey 
  * @param column 
  * @param estimate : number of data points to retrieve for hiding the volume pattern. This is effectively the number of dummies returned.
- * @return DBT::dbResponse: Vector of tuples consisting of database entries and bool values indicating wether the entry is a dummy or not.
+ * @param visit : called with each record and a bool value indicating wether the entry is a dummy or not
+ * @return number : number of visited records
  */
-DBT::dbResponse  AVLTree::findIntervalHelperMenhir(db_t startKey, db_t endKey, ulong column, number estimate){
+number AVLTree::findIntervalHelperMenhir(db_t startKey, db_t endKey, ulong column, number estimate, DBT::recordVisitor visit){
     int pad=getPad();
-    DBT::dbResponse results;
+    number numResults=0;
 
     AVLTreeNode thisRoot(columnFormat, sizeValue);
     
     if(CURRENT_LEVEL==DEBUG) LOG(DEBUG, boost::wformat(L"estimate %d ")% estimate);
     ulong count=estimate;
+    //marked nodes are returned as dummies. Every scan reads numNodeTombstones additional nodes and marked nodes in the interval use up this budget,
+    //so the number of ORAM reads does not depend on how many of the marked nodes lie in the interval.
+    ulong tombstoneCount=numNodeTombstones;
+    bool intervalEnded=false;
     bool firstIteration=true;
     ulong nextID=NULL_PTR;
     bool allDummies=false;
@@ -1494,17 +1936,18 @@ DBT::dbResponse  AVLTree::findIntervalHelperMenhir(db_t startKey, db_t endKey, u
     }
 
 
-    while(count>0 or firstIteration ){
-        if(MENHIR::RETRIEVE_EXACTLY.size()!=0 and results.size()==estimate){
+    while(count>0 or tombstoneCount>0 or firstIteration ){
+        if(MENHIR::RETRIEVE_EXACTLY.size()!=0 and numResults==estimate){
             break;
         }
 
 
         bool isDummy=true;
+        bool isTombstone=false;
         vector<db_t> thisData;
         AVLTreeNode curNode(columnFormat, sizeValue);
 
-        if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"------------iteration %d - count noisy nodes to add %d ---------- ")% results.size() %count);
+        if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"------------iteration %d - count noisy nodes to add %d ---------- ")% numResults %count);
 
         //There are two different cases as way the first node is found during the first iteration differs from the other cases
         if(firstIteration==true){
@@ -1530,6 +1973,7 @@ DBT::dbResponse  AVLTree::findIntervalHelperMenhir(db_t startKey, db_t endKey, u
                 for(size_t j=0;j<numColumns;j++){
                     thisData[j]=_IF_THEN(isFirst,curNode.key[j],thisData[j]);
                 }
+                isTombstone=_IF_THEN(isFirst,curNode.tombstone,isTombstone);
                 if(CURRENT_LEVEL==TRACE) LOG(TRACE,boost::wformat(L"curNode (inInterval %d, isFirst %d) :  %s") %inInterval %isFirst %MENHIR::toWString(curNode.toStringFull(true)));
             }
 
@@ -1538,48 +1982,714 @@ DBT::dbResponse  AVLTree::findIntervalHelperMenhir(db_t startKey, db_t endKey, u
             if(CURRENT_LEVEL==TRACE) LOG(TRACE,boost::wformat(L"curNode: %s") %MENHIR::toWString(curNode.toStringFull(true)));
             nextID=curNode.next[column];
             thisData=curNode.key;
+            isTombstone=curNode.tombstone;
         }
         
         bool inInterval= (thisData[column]>=startKey) and  (thisData[column]<=endKey);
-        bool noDummiesYet=((ulong)count==estimate);
-        isDummy=_IF_THEN((inInterval and noDummiesYet),false, isDummy);
+        isDummy=_IF_THEN((inInterval and not intervalEnded),false, isDummy);
         isDummy=_IF_THEN((allDummies),true, isDummy);
+        intervalEnded=(intervalEnded or isDummy);
+        //nodes marked as deleted are returned as dummies but do not end the interval
+        isTombstone=(isTombstone and not isDummy);
 
 
 
-        results.push_back(make_tuple(thisData, isDummy));
+        visit(thisData, (isDummy or isTombstone));
+        numResults++;
 
         if(CURRENT_LEVEL==TRACE){ 
-            ostringstream oss;
-            for (size_t ii = 0; ii < results.size(); ii++){
-                vector<db_t> record;
-                bool dummy;
-                tie(record,dummy)=results[ii];
-                db_t val=record[column];
-                oss<<"[";
-                oss<<DBT::toString(val);
-                oss<<"]; ";
-                        
+                LOG(TRACE,boost::wformat(L"Node added:  %s (dummy %d)") % DBT::toWString(thisData[column]) %isDummy);
+                LOG(TRACE,boost::wformat(L"nextID %d") %nextID);
+                LOG(TRACE, boost::wformat(L"Results.size(): %d") %numResults);
+        }
+
+        //dummies count down the estimate, marked nodes and dummies after the estimate count down the tombstone budget
+        bool useEstimate=(isDummy and count>0);
+        bool useTombstones=(isTombstone or (isDummy and count==0)) and tombstoneCount>0;
+        count=_IF_THEN(useEstimate,(count-1), count);
+        tombstoneCount=_IF_THEN(useTombstones,(tombstoneCount-1),tombstoneCount);
+
+    }
+    return numResults;
+
+}
+
+/**
+ * @brief Number of records and sum of the aggregated column over all records whose key in the passed column lies in [startKey, endKey]. 
+ * Requires an augmented tree. The result is computed from the subtree aggregates with two padded descents, 
+ * so the number of ORAM accesses only depends on the size of the tree and not on the number of records in the interval.
+ * 
+ * @param startKey : Start of the interval
+ * @param endKey : end of the interval
+ * @param column : Column to be queried
+ * @return tuple<number,double> : number of records and sum of the aggregated column
+ */
+tuple<number,double> AVLTree::aggregateInterval(db_t startKey, db_t endKey, ulong column){
+    if(not augmented){
+        __throw_invalid_argument("Subtree aggregates are only stored if the tree is augmented (see USE_SUBTREE_AGGREGATES).");
+    }
+    auto[countUpper, sumUpper]=aggregateBelow(endKey, true, column);
+    auto[countLower, sumLower]=aggregateBelow(startKey, false, column);
+    bool nonEmpty=(startKey<=endKey);
+    number count=_IF_THEN(nonEmpty, (countUpper-countLower), 0ull);
+    double sum=_IF_THEN(nonEmpty, (sumUpper-sumLower), 0.0);
+    return make_tuple(count, sum);
+}
+
+/**
+ * @brief Number of records and sum of the aggregated column over all records with a key smaller than bound (or equal to bound if inclusive) in the passed column.
+ * Requires an augmented tree. Executes one padded descent: each time the descent continues in the right subtree, the current node and its left subtree are counted.
+ * 
+ * @param bound 
+ * @param inclusive 
+ * @param column 
+ * @return tuple<number,double> 
+ */
+tuple<number,double> AVLTree::aggregateBelow(db_t bound, bool inclusive, ulong column){
+    if(not augmented){
+        __throw_invalid_argument("Subtree aggregates are only stored if the tree is augmented (see USE_SUBTREE_AGGREGATES).");
+    }
+    int pad=getPad();
+    number count=0;
+    double sum=0.0;
+    ulong ptrCur=ptrRoot[column];
+    for(int i=0; i<pad;i++){
+        AVLTreeNode curNode=getNodeORAM(ptrCur);
+        bool below= curNode.key[column]<bound or (inclusive and curNode.key[column]==bound);
+        bool add= below and (ptrCur!=NULL_PTR);
+        count=count+_IF_THEN(add, (curNode.lCount[column]+1), 0ull);
+        sum=sum+_IF_THEN(add, (curNode.lSum[column]+DBT::toDouble(curNode.key[aggregateColumn])), 0.0);
+        ptrCur=_IF_THEN(below, curNode.ptrRightChild[column], curNode.ptrLeftChild[column]);
+    }
+    return make_tuple(count, sum);
+}
+
+/**
+ * @brief Returns all records of the tree (keys and nodeHash) sorted by column 0, e.g. for moving them into another tree. Nodes marked as deleted are returned with valid=false.
+ * The smallest node is found with a padded descent, afterwards the next pointers are followed. The number of ORAM accesses only depends on the size of the tree.
+ * 
+ * @return vector<RankRecord> 
+ */
+vector<RankRecord> AVLTree::exportRecords(){
+    vector<RankRecord> records;
+    if(treeSize==0){
+        return records;
+    }
+    records.reserve(treeSize);
+
+    int pad=getPad();
+    ulong ptr=ptrRoot[0];
+    ulong first=NULL_PTR;
+    for (int i = 0; i < pad; i++){
+        AVLTreeNode curNode=getNodeORAM(ptr);
+        first=_IF_THEN((ptr!=NULL_PTR), ptr, first);
+        ptr=curNode.ptrLeftChild[0];
+    }
+
+    ptr=first;
+    for (size_t i = 0; i < treeSize; i++){
+        AVLTreeNode curNode=getNodeORAM(ptr);
+        records.push_back(RankRecord(curNode.key, curNode.nodeHash, columnFormat));
+        records.back().valid=not curNode.tombstone;
+        ptr=curNode.next[0];
+    }
+    return records;
+}
+
+
+#pragma endregion
+
+
+#pragma region LEAF_PAGE_FUNCTIONS
+
+/**
+ * @brief Creates the ORAM for the leaf pages and packs the passed records into full pages. For each column, the pages form a linked list sorted by (key, nodeHash).
+ * The ORAM for the pages is sized so that every column can hold maxCapacity records in pages that are only half full.
+ * 
+ * @param records : records that are already stored in the tree (may be empty)
+ * @param nodeHashes : nodeHash for each record in records
+ */
+void AVLTree::initLeafPages(vector<vector<db_t>> records, vector<size_t> nodeHashes){
+    this->pageSize=max(MENHIR::LEAF_PAGE_SIZE, 2ull);
+    number minFill=max(this->pageSize/2, 1ull);
+    this->maxPages=this->numColumns*(this->maxCapacity/minFill+2)+1;
+    this->PAGE_BLOCK_SIZE=getPageBytesWhenSerialized(this->columnFormat, this->pageSize);
+
+    number pageLogCapacity=std::max((number) ceil(log((double)this->maxPages/(double)this->ORAM_Z)/log(2.0)),3ull);
+    size_t oramParameter= (1 << pageLogCapacity) * this->ORAM_Z+this->ORAM_Z;
+    size_t stashSize=this->STASH_FACTOR * pageLogCapacity * this->ORAM_Z;
+
+    LOG_PARAMETER(this->pageSize);
+    LOG_PARAMETER(this->maxPages);
+    LOG_PARAMETER(PAGE_BLOCK_SIZE);
+    LOG(INFO, boost::wformat(L"Creating ORAM for leaf pages (log capacity %d)") %pageLogCapacity);
+
+    this->pageOram = make_shared<PathORAM::ORAM>(
+            pageLogCapacity,
+            this->PAGE_BLOCK_SIZE,
+            this->ORAM_Z,
+            make_shared<InMemoryStorageAdapter>(oramParameter, this->PAGE_BLOCK_SIZE, bytes(), this->ORAM_Z),
+			make_shared<InMemoryPositionMapAdapter>(oramParameter),
+			make_shared<InMemoryStashAdapter>(stashSize),
+			true,
+			this->BATCH_SIZE);
+
+    LeafPage NULL_PAGE=LeafPage(this->columnFormat, this->pageSize);
+    this->nullPageBytes=NULL_PAGE.serialize();
+
+    //Page ID 0 is reserved
+    this->availablePageNumbers=queue<ulong>();
+    for(size_t i=1;i<this->maxPages;i++){
+        this->availablePageNumbers.push(i);
+    }
+
+    this->fenceKeys=vector<vector<pair<db_t,size_t>>>(numColumns);
+    this->fencePages=vector<vector<ulong>>(numColumns);
+    vector<pair<number, bytes>> data;
+
+    for (size_t c = 0; c < numColumns; c++){
+        vector<size_t> order(records.size());
+        for (size_t i = 0; i < order.size(); i++){
+            order[i]=i;
+        }
+        sort(order.begin(), order.end(), [&](size_t a, size_t b)->bool{
+            return recordSmaller(records[a][c], nodeHashes[a], records[b][c], nodeHashes[b]);
+        });
+
+        //there is always at least one page per column, so inserts always find a page
+        size_t numPages=max((size_t) ceil((double) records.size()/(double) this->pageSize), (size_t) 1);
+        vector<ulong> pageIDs;
+        for (size_t p = 0; p < numPages; p++){
+            pageIDs.push_back(getNewPageID());
+        }
+
+        for (size_t p = 0; p < numPages; p++){
+            LeafPage page(pageIDs[p], this->columnFormat, this->pageSize);
+            page.next= (p+1<numPages)? pageIDs[p+1] : NULL_PTR;
+            for (size_t j = 0; j < this->pageSize and p*this->pageSize+j<records.size(); j++){
+                size_t r=order[p*this->pageSize+j];
+                page.keys[j]=records[r];
+                page.nodeHashes[j]=nodeHashes[r];
+                page.count++;
             }
-            LOG(TRACE, MENHIR::toWString(oss.str()));
+            fenceKeys[c].push_back(make_pair(page.keys[0][c], page.nodeHashes[0]));
+            fencePages[c].push_back(pageIDs[p]);
+            data.push_back(make_pair(pageIDs[p]+1, page.serialize()));
         }
+    }
 
-        if(CURRENT_LEVEL==TRACE){ 
-                LOG(TRACE,boost::wformat(L"Node added:  %s (dummy %d)") % DBT::toWString(thisData[column]) %isDummy);
-                LOG(TRACE,boost::wformat(L"nextID %d") %nextID);
-                LOG(TRACE, boost::wformat(L"Results.size(): %d") %results.size());
+    LOG(INFO, boost::wformat(L"Loading %d leaf pages into ORAM") %data.size());
+    this->pageOram->load(data);
+    this->pageOram->put(NULL_PTR+1, this->nullPageBytes);
+}
+
+
+/**
+ * @brief Returns a number that can be used as ID for a new LeafPage.
+ * 
+ * @return ulong 
+ */
+ulong AVLTree::getNewPageID(){
+    if(availablePageNumbers.size()==0){
+        LOG(CRITICAL, L"No new numbers can be given to new leaf pages. This might be because the ORAM for leaf pages is full.");
+    }
+    ulong pageID=availablePageNumbers.front();
+    availablePageNumbers.pop();
+    return pageID;
+}
+
+/**
+ * @brief Get a LeafPage from the page ORAM based on its ID. If dummy is true, then the page with ID 0 is retrieved as dummy operation.
+ * 
+ * @param pageID 
+ * @param dummy 
+ * @return LeafPage 
+ */
+LeafPage AVLTree::getPageORAM(ulong pageID, bool dummy){
+    dummy= (not (bool) pageID) or dummy;
+    const ulong ptr=NULL_PTR*dummy+pageID*(not dummy);
+    bytes response;
+    pageOram->get(ptr+1, response);
+    if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"Get Page with pageID %d from ORAM.")%ptr);
+
+    if(response.size()==0){
+        LOG(ERROR, boost::wformat(L"Page with pageID %d was not found at %d in ORAM.")%ptr %(ptr+1));
+        exit(1);
+    }
+    return LeafPage(response, dummy, columnFormat, pageSize);
+}
+
+/**
+ * @brief Writes a LeafPage into the block with the corresponding ID. If dummy is true, an empty page is written to the block with ID 0.
+ * 
+ * @param page 
+ * @param dummy 
+ */
+void AVLTree::putPageORAM(LeafPage page, bool dummy){
+    dummy=dummy or page.empty;
+
+    const ulong ptr=NULL_PTR*dummy+page.pageID*(not dummy);
+    bytes pageBytes=page.serialize();
+
+    for(size_t i=0;i<pageBytes.size();i++){
+        uint8_t b= _IF_THEN((uint8_t) dummy,(uint8_t) nullPageBytes[i],(uint8_t) pageBytes[i]);
+        pageBytes [i]=(uchar) b;
+    }
+
+    if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"Putting page %d in ORAM")%ptr);
+    pageOram->put(ptr+1, pageBytes);
+}
+
+/**
+ * @brief Returns the position of the page in fencePages[column] that covers the record (key, nodeHash). 
+ * All fences are compared, so the access pattern does not depend on the position of the page.
+ * 
+ * @param key 
+ * @param nodeHash 
+ * @param column 
+ * @return ulong 
+ */
+ulong AVLTree::findPageIndex(db_t key, size_t nodeHash, ulong column){
+    ulong idx=0;
+    for (size_t i = 1; i < fenceKeys[column].size(); i++){
+        bool afterFence= not recordSmaller(key, nodeHash, fenceKeys[column][i].first, fenceKeys[column][i].second);
+        idx+=(ulong) afterFence;
+    }
+    return idx;
+}
+
+/**
+ * @brief Inserts a record into the leaf pages of all columns. Per column, one page is read and two pages are written. 
+ * The second write is a dummy unless the page had to be split.
+ * 
+ * @param key 
+ * @param nodeHash 
+ */
+void AVLTree::insertLeafPages(vector<db_t> key, size_t nodeHash){
+    for (size_t c = 0; c < numColumns; c++){
+        ulong idx=findPageIndex(key[c], nodeHash, c);
+        LeafPage page=getPageORAM(fencePages[c][idx]);
+
+        ulong newPageID=getNewPageID();
+        auto[left, right, split]=insertIntoPage(page, key, nodeHash, c, newPageID);
+        putPageORAM(left);
+        putPageORAM(right, not split);
+
+        if(split){
+            fenceKeys[c].insert(fenceKeys[c].begin()+idx+1, make_pair(right.keys[0][c], right.nodeHashes[0]));
+            fencePages[c].insert(fencePages[c].begin()+idx+1, newPageID);
+        }else{
+            availablePageNumbers.push(newPageID);
         }
+        if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"column %d - inserted into %s") %c %MENHIR::toWString(left.toString(c)));
+    }
+}
 
-        //counting down if isDummy
-        int newCount=count-1;
-    
-        count=_IF_THEN(isDummy,newCount, count);
+/**
+ * @brief Deletes a record from the leaf pages of all columns. Per column, the page holding the record and its successor are read and written.
+ * If the page holding the record becomes less than half full, it is merged with its successor or records are moved from the successor.
+ * The record is first removed from the pages of the passed column. The keys of the removed record are then used to locate it in all other columns.
+ * 
+ * @param key : key of the record in the passed column
+ * @param nodeHash 
+ * @param column : column in which key is stored
+ */
+void AVLTree::deleteLeafPages(db_t key, size_t nodeHash, ulong column){
+    vector<db_t> record=MENHIR::getEmptyRow(columnFormat);
+    record[column]=key;
+    bool execute=true;
+
+    for (size_t k = 0; k < numColumns; k++){
+        //the passed column is processed first
+        size_t c= (k==0)? column : ((k<=column)? k-1 : k);
+
+        ulong idx=findPageIndex(record[c], nodeHash, c);
+        LeafPage page=getPageORAM(fencePages[c][idx]);
+        bool hasNext= page.next!=NULL_PTR;
+        LeafPage nextPage=getPageORAM(page.next);
+
+        bool removed=removeFromPage(&page, record[c], nodeHash, c, execute, &record);
+        execute=removed;
+        bool underfull= page.count<pageSize/2;
+        bool rebalance= removed and underfull and hasNext;
+        auto[newPage, newNext, merged]=mergePages(page, nextPage, rebalance);
+
+        putPageORAM(newPage, not removed);
+        putPageORAM(newNext, not rebalance);
+
+        if(merged){
+            fenceKeys[c].erase(fenceKeys[c].begin()+idx+1);
+            fencePages[c].erase(fencePages[c].begin()+idx+1);
+            availablePageNumbers.push(nextPage.pageID);
+        }else if(rebalance){
+            fenceKeys[c][idx+1]=make_pair(newNext.keys[0][c], newNext.nodeHashes[0]);
+        }
+        if(CURRENT_LEVEL==TRACE) LOG(TRACE, boost::wformat(L"column %d - removed %d from %s") %c %removed %MENHIR::toWString(newPage.toString(c)));
+    }
+}
+
+/**
+ * @brief Finds all entries for which the key in the passed column falls into [startKey,endKey] by following the linked list of leaf pages.
+ * The results are identical to findIntervalHelperMenhir: All records in the interval are returned first, followed by estimate dummies.
+ * As each page holds at least pageSize/2 records (except the last one), the number of page accesses is padded to ceil(results/(pageSize/2))+3.
+ * 
+ * @param startKey 
+ * @param endKey 
+ * @param column 
+ * @param estimate : number of data points to retrieve for hiding the volume pattern. This is effectively the number of dummies returned.
+ * @param visit : called with each record and a bool value indicating wether the entry is a dummy or not
+ * @return number : number of visited records
+ */
+number AVLTree::findIntervalHelperLeafPages(db_t startKey, db_t endKey, ulong column, number estimate, DBT::recordVisitor visit){
+    number numResults=0;
+    ulong count=estimate;
+    bool allDummies= MENHIR::RETRIEVE_EXACTLY.size()!=0;
+    vector<db_t> emptyRow=MENHIR::getEmptyRow(columnFormat);
+
+    if(CURRENT_LEVEL==DEBUG) LOG(DEBUG, boost::wformat(L"estimate %d ")% estimate);
 
+    ulong idx=findPageIndex(startKey, 0, column);
+    ulong pageID=fencePages[column][idx];
+    number reads=0;
+    bool active=true;
+
+    while(active){
+        LeafPage page=getPageORAM(pageID);
+        reads++;
+        bool isNullPage= page.empty;
+
+        for (size_t j = 0; j < pageSize; j++){
+            active= (count>0 or numResults==0);
+            active= active and not (allDummies and numResults==estimate);
+
+            bool valid= isNullPage or j<page.count;
+            bool beforeStart= (not isNullPage) and (page.keys[j][column]<startKey);
+            if(not (valid and active and not beforeStart)){
+                continue;
+            }
+
+            vector<db_t> thisData=page.keys[j];
+            for (size_t i = 0; i < numColumns; i++){
+                thisData[i]=_IF_THEN(isNullPage, emptyRow[i], thisData[i]);
+            }
+            bool inInterval= (not isNullPage) and (thisData[column]>=startKey) and (thisData[column]<=endKey);
+            bool noDummiesYet=((ulong)count==estimate);
+            bool isDummy= not (inInterval and noDummiesYet);
+            isDummy=_IF_THEN(allDummies, true, isDummy);
+
+            visit(thisData, isDummy);
+            numResults++;
+            if(CURRENT_LEVEL==TRACE) LOG(TRACE,boost::wformat(L"Record added:  %s (dummy %d)") % DBT::toWString(thisData[column]) %isDummy);
+
+            bool decrease= isDummy and count>0;
+            count=_IF_THEN(decrease, (count-1), count);
+        }
+        active= (count>0 or numResults==0);
+        active= active and not (allDummies and numResults==estimate);
+        pageID=page.next;
     }
-    return results;
 
+    //padding the number of page accesses so it only depends on the number of returned records
+    number minFill=max(pageSize/2, 1ull);
+    number maxReads=(number) ceil((double) numResults/(double) minFill)+3;
+    for (; reads < maxReads; reads++){
+        getPageORAM(NULL_PTR, true);
+    }
+    return numResults;
+}
+
+#pragma endregion
+
+
+#pragma region RANK_LAYOUT_FUNCTIONS
+
+/**
+ * @brief Creates a new ORAM for the rank layout and stores the passed records sorted by rank for every column.
+ * The records are sorted with an oblivious sort. As ORAM::load only works on a fresh ORAM, the ORAM is recreated on every (re)build.
+ * 
+ * @param records : all valid records of the tree that are not deleted
+ */
+void AVLTree::buildRankLayout(vector<RankRecord> records){
+    this->rankCapacity=this->maxCapacity;
+    this->RANK_BLOCK_SIZE=getRankRecordBytesWhenSerialized(this->columnFormat);
+    number numBlocks=this->numColumns*this->rankCapacity+2; //+2 as block 1 holds the null record
+
+    number rankLogCapacity=std::max((number) ceil(log((double)numBlocks/(double)this->ORAM_Z)/log(2.0)),3ull);
+    size_t oramParameter= (1 << rankLogCapacity) * this->ORAM_Z+this->ORAM_Z;
+    size_t stashSize=this->STASH_FACTOR * rankLogCapacity * this->ORAM_Z;
+    if(CURRENT_LEVEL<=DEBUG) LOG(DEBUG, boost::wformat(L"Building rank layout with %d records (log capacity %d)") %records.size() %rankLogCapacity);
+
+    this->rankOram = make_shared<PathORAM::ORAM>(
+            rankLogCapacity,
+            this->RANK_BLOCK_SIZE,
+            this->ORAM_Z,
+            make_shared<InMemoryStorageAdapter>(oramParameter, this->RANK_BLOCK_SIZE, bytes(), this->ORAM_Z),
+			make_shared<InMemoryPositionMapAdapter>(oramParameter),
+			make_shared<InMemoryStashAdapter>(stashSize),
+			true,
+			this->BATCH_SIZE);
+
+    RankRecord NULL_RECORD=RankRecord(this->columnFormat);
+    this->nullRankBytes=NULL_RECORD.serialize();
+
+    vector<pair<number, bytes>> data;
+    for (size_t c = 0; c < numColumns; c++){
+        vector<RankRecord> sorted=records;
+        obliviousSortRecords(&sorted, c);
+        for (size_t r = 0; r < sorted.size(); r++){
+            data.push_back(make_pair(getRankBlockID(c, r), sorted[r].serialize()));
+        }
+    }
+    if(data.size()>0){
+        this->rankOram->load(data);
+    }
+    this->rankOram->put(NULL_PTR+1, this->nullRankBytes);
+
+    this->rankSize=records.size();
+    this->rankBuffer.clear();
+    this->numRankTombstones=0;
+}
+
+/**
+ * @brief Collects all records which are not deleted from the layout and the buffer and builds a new layout from them.
+ * 
+ */
+void AVLTree::rebuildRankLayout(){
+    vector<RankRecord> records;
+    number batch=max(this->BATCH_SIZE, 1ull);
+    for (number r = 0; r < rankSize; r+=batch){
+        vector<RankRecord> fetched=getRankRecordsORAM(0, r, batch);
+        for (size_t b = 0; b < fetched.size() and r+b<rankSize; b++){
+            if(fetched[b].valid) records.push_back(fetched[b]);
+        }
+    }
+    for (size_t i = 0; i < rankBuffer.size(); i++){
+        if(rankBuffer[i].valid) records.push_back(rankBuffer[i]);
+    }
+    LOG(DEBUG, boost::wformat(L"Rebuilding rank layout (%d records)") %records.size());
+    buildRankLayout(records);
+}
+
+/**
+ * @brief Returns the ID of the ORAM block holding the record with the passed rank in the passed column.
+ * 
+ * @param column 
+ * @param rank 
+ * @return number 
+ */
+number AVLTree::getRankBlockID(ulong column, number rank){
+    return column*rankCapacity+rank+2;
+}
+
+/**
+ * @brief Get the record with the passed rank in the passed column from the ORAM. Ranks outside the layout or dummy accesses read the null record.
+ * 
+ * @param column 
+ * @param rank 
+ * @param dummy 
+ * @return RankRecord 
+ */
+RankRecord AVLTree::getRankRecordORAM(ulong column, number rank, bool dummy){
+    dummy= dummy or rank>=rankSize;
+    const number blockID=_IF_THEN(dummy, (NULL_PTR+1), getRankBlockID(column, rank));
+    bytes response;
+    rankOram->get(blockID, response);
+    return RankRecord(response, columnFormat);
+}
+
+/**
+ * @brief Fetches the records with ranks firstRank,...,firstRank+num-1 of the passed column with one ORAM::multiple call.
+ * As the block IDs follow from the ranks, all IDs are known before the first record is decrypted.
+ * Ranks outside the layout are replaced by reads of the null record.
+ * 
+ * @param column 
+ * @param firstRank 
+ * @param num : number of records to fetch, at most BATCH_SIZE
+ * @return vector<RankRecord> 
+ */
+vector<RankRecord> AVLTree::getRankRecordsORAM(ulong column, number firstRank, number num){
+    vector<pair<number, bytes>> requests;
+    requests.reserve(num);
+    for (number b = 0; b < num; b++){
+        bool outside= firstRank+b>=rankSize;
+        number blockID=_IF_THEN(outside, (NULL_PTR+1), getRankBlockID(column, firstRank+b));
+        requests.push_back(make_pair(blockID, bytes()));
+    }
+    vector<bytes> response;
+    rankOram->multiple(requests, response);
+
+    vector<RankRecord> records;
+    records.reserve(num);
+    for (number b = 0; b < num; b++){
+        records.push_back(RankRecord(response[b], columnFormat));
+    }
+    return records;
+}
+
+/**
+ * @brief Padded binary search for the smallest rank in the passed column whose record is not smaller than (key, nodeHash).
+ * The number of ORAM accesses only depends on the size of the layout.
+ * 
+ * @param key 
+ * @param nodeHash 
+ * @param column 
+ * @return number : rank of the first record >= (key,nodeHash), rankSize if there is none
+ */
+number AVLTree::findRank(db_t key, size_t nodeHash, ulong column){
+    number lo=0;
+    number hi=rankSize;
+    number steps=(number) ceil(log2((double) rankSize+1.0));
+    RankRecord probe(this->columnFormat);
+    probe.keys[column]=key;
+    probe.nodeHash=nodeHash;
+
+    for (number s = 0; s < steps; s++){
+        bool active= lo<hi;
+        number mid=(lo+hi)/2;
+        RankRecord rec=getRankRecordORAM(column, mid, not active);
+        bool smaller=rankRecordSmaller(rec, probe, column);
+        lo=_IF_THEN((active and smaller), (mid+1), lo);
+        hi=_IF_THEN((active and not smaller), mid, hi);
+    }
+    return lo;
+}
+
+/**
+ * @brief Adds a new record to the buffer of the rank layout. If enough updates happened since the last rebuild, the layout is rebuilt.
+ * 
+ * @param key 
+ * @param nodeHash 
+ */
+void AVLTree::insertRankLayout(vector<db_t> key, size_t nodeHash){
+    rankBuffer.push_back(RankRecord(key, nodeHash, columnFormat));
+    if(rankBuffer.size()+numRankTombstones>=MENHIR::RANK_REBUILD_THRESHOLD){
+        rebuildRankLayout();
+    }
+}
+
+/**
+ * @brief Marks a record as deleted in the rank layout of all columns and in the buffer. 
+ * Per column, one padded binary search and one write are executed. The passed column is processed first, as the keys of the other columns are only known after the record was found.
+ * 
+ * @param key : key of the record in the passed column
+ * @param nodeHash 
+ * @param column : column in which key is stored
+ */
+void AVLTree::deleteRankLayout(db_t key, size_t nodeHash, ulong column){
+    vector<db_t> record=MENHIR::getEmptyRow(columnFormat);
+    record[column]=key;
+
+    //records in the buffer are not part of the layout yet
+    for (size_t i = 0; i < rankBuffer.size(); i++){
+        bool match= rankBuffer[i].valid and (rankBuffer[i].keys[column]==key) and (rankBuffer[i].nodeHash==nodeHash);
+        rankBuffer[i].valid=_IF_THEN(match, false, rankBuffer[i].valid);
+    }
+
+    for (size_t k = 0; k < numColumns; k++){
+        //the passed column is processed first
+        size_t c= (k==0)? column : ((k<=column)? k-1 : k);
+
+        number rank=findRank(record[c], nodeHash, c);
+        RankRecord rec=getRankRecordORAM(c, rank);
+        bool match= rank<rankSize and rec.valid and (rec.keys[c]==record[c]) and (rec.nodeHash==nodeHash);
+        for (size_t i = 0; i < numColumns; i++){
+            record[i]=_IF_THEN(match, rec.keys[i], record[i]);
+        }
+        rec.valid=false;
+
+        bytes recordBytes=rec.serialize();
+        for(size_t i=0;i<recordBytes.size();i++){
+            uint8_t b= _IF_THEN((uint8_t) match,(uint8_t) recordBytes[i],(uint8_t) nullRankBytes[i]);
+            recordBytes[i]=(uchar) b;
+        }
+        number blockID=_IF_THEN(match, getRankBlockID(c, rank), (NULL_PTR+1));
+        rankOram->put(blockID, recordBytes);
+    }
+
+    numRankTombstones++;
+    if(rankBuffer.size()+numRankTombstones>=MENHIR::RANK_REBUILD_THRESHOLD){
+        rebuildRankLayout();
+    }
 }
 
+/**
+ * @brief Finds all entries for which the key in the passed column falls into [startKey,endKey] using the rank layout.
+ * The first rank is found by a padded binary search. Afterwards BATCH_SIZE consecutive records are fetched with every ORAM::multiple call.
+ * Records inserted since the last rebuild are taken from the buffer and visited first, so the set of results matches findIntervalHelperMenhir but they are not in key order.
+ * The number of batches is padded to ceil((results+deletes since rebuild)/BATCH_SIZE)+1.
+ * 
+ * @param startKey 
+ * @param endKey 
+ * @param column 
+ * @param estimate : number of data points to retrieve for hiding the volume pattern. This is effectively the number of dummies returned.
+ * @param visit : called with each record and a bool value indicating wether the entry is a dummy or not
+ * @return number : number of visited records
+ */
+number AVLTree::findIntervalHelperRankLayout(db_t startKey, db_t endKey, ulong column, number estimate, DBT::recordVisitor visit){
+    number numResults=0;
+    ulong count=estimate;
+    bool allDummies= MENHIR::RETRIEVE_EXACTLY.size()!=0;
+    vector<db_t> emptyRow=MENHIR::getEmptyRow(columnFormat);
+    number batch=max(this->BATCH_SIZE, 1ull);
+
+    if(CURRENT_LEVEL==DEBUG) LOG(DEBUG, boost::wformat(L"estimate %d ")% estimate);
+
+    if(not allDummies){
+        for (size_t i = 0; i < rankBuffer.size(); i++){
+            bool inInterval= rankBuffer[i].valid and (rankBuffer[i].keys[column]>=startKey) and (rankBuffer[i].keys[column]<=endKey);
+            if(inInterval){
+                visit(rankBuffer[i].keys, false);
+                numResults++;
+            }
+        }
+    }
+
+    number rank=findRank(startKey, 0, column);
+    number batches=0;
+    bool active=true;
+
+    while(active){
+        vector<RankRecord> fetched=getRankRecordsORAM(column, rank, batch);
+        batches++;
+
+        for (size_t b = 0; b < batch; b++){
+            active= (count>0 or numResults==0);
+            active= active and not (allDummies and numResults==estimate);
+
+            bool outside= rank+b>=rankSize;
+            bool deleted= (not outside) and (not fetched[b].valid);
+            if(not active or deleted){
+                continue;
+            }
+
+            vector<db_t> thisData=fetched[b].keys;
+            for (size_t i = 0; i < numColumns; i++){
+                thisData[i]=_IF_THEN(outside, emptyRow[i], thisData[i]);
+            }
+            bool inInterval= (not outside) and (thisData[column]>=startKey) and (thisData[column]<=endKey);
+            bool noDummiesYet=((ulong)count==estimate);
+            bool isDummy= not (inInterval and noDummiesYet);
+            isDummy=_IF_THEN(allDummies, true, isDummy);
+
+            visit(thisData, isDummy);
+            numResults++;
+            if(CURRENT_LEVEL==TRACE) LOG(TRACE,boost::wformat(L"Record added:  %s (dummy %d)") % DBT::toWString(thisData[column]) %isDummy);
+
+            bool decrease= isDummy and count>0;
+            count=_IF_THEN(decrease, (count-1), count);
+        }
+        active= (count>0 or numResults==0);
+        active= active and not (allDummies and numResults==estimate);
+        rank+=batch;
+    }
+
+    //padding the number of batches so it only depends on the number of returned records and the number of deletes since the last rebuild
+    number maxBatches=(number) ceil((double) (numResults+numRankTombstones)/(double) batch)+1;
+    for (; batches < maxBatches; batches++){
+        getRankRecordsORAM(column, rankSize, batch);
+    }
+    return numResults;
+}
 
 #pragma endregion
 
@@ -0,0 +1,184 @@
+#include "avl_ranklayout.hpp"
+
+/**
+ * @brief This file contains the records of the rank addressed layout used by the AVLTree if the index mode RANK_LAYOUT is set
+ * as well as the oblivious sort used for rebuilding the layout.
+ *
+ */
+
+namespace DOSM{
+
+
+/**
+ * @brief Construct a new RankRecord::RankRecord object without any columns.
+ *
+ */
+RankRecord::RankRecord(){
+    nodeHash=0;
+    valid=false;
+    numColumns=0;
+}
+
+/**
+ * @brief Construct a new empty RankRecord::RankRecord object. This is used for dummy accesses and for ranks that are not used.
+ *
+ * @param columnFormat : Column format of the database. Relevant for parsing data.
+ */
+RankRecord::RankRecord(vector<AType> columnFormat){
+    this->columnFormat=columnFormat;
+    this->numColumns=columnFormat.size();
+    for (size_t i = 0; i < numColumns; i++){
+        keys.push_back(DBT::getDBTZero(columnFormat[i]));
+    }
+    nodeHash=0;
+    valid=false;
+}
+
+/**
+ * @brief Construct a new valid RankRecord::RankRecord object.
+ *
+ * @param keys : keys of the record for all columns
+ * @param nodeHash : hash of the record, identical to the nodeHash of the AVLTreeNode
+ * @param columnFormat : Column format of the database.
+ */
+RankRecord::RankRecord(vector<db_t> keys, size_t nodeHash, vector<AType> columnFormat){
+    this->columnFormat=columnFormat;
+    this->numColumns=columnFormat.size();
+    this->keys=keys;
+    this->nodeHash=nodeHash;
+    valid=true;
+}
+
+/**
+ * @brief Construct a new RankRecord::RankRecord object from a serialized record.
+ *
+ * @param serializedRecord : array of unsigned chars created by serializing a RankRecord
+ * @param columnFormat : Column format of the database.
+ */
+RankRecord::RankRecord(bytes serializedRecord, vector<AType> columnFormat):RankRecord::RankRecord(columnFormat){
+    size_t s=0;
+    size_t sizeDBT=DBT::getMaxSizeDBT();
+    for (size_t i = 0; i < numColumns; i++){
+        bytes k(serializedRecord.begin()+s, serializedRecord.begin()+s+sizeDBT);
+        keys[i]=DBT::deserialize(k,columnFormat[i]);
+        s+=sizeDBT;
+    }
+    memcpy(&nodeHash, &serializedRecord[s], sizeof(size_t));
+    s+=sizeof(size_t);
+    valid=(bool) serializedRecord[s];
+}
+
+/**
+ * @brief Serializes the current RankRecord. All records have the same size when serialized.
+ *
+ * @return bytes
+ */
+bytes RankRecord::serialize(){
+    bytes serialized;
+    size_t sizeDBT=DBT::getMaxSizeDBT();
+    for (size_t i = 0; i < numColumns; i++){
+        vector<uchar> data_vec = DBT::serialize(keys[i],columnFormat[i]);
+        serialized.insert(serialized.end(), data_vec.begin(), data_vec.begin()+sizeDBT);
+    }
+    uchar* uBytes=(uchar*)&nodeHash;
+    serialized.insert(serialized.end(), uBytes, uBytes+sizeof(size_t));
+    serialized.push_back((uchar) valid);
+    return serialized;
+}
+
+/**
+ * @brief Returns the key in the passed column and the hash of the record as string.
+ *
+ * @param column
+ * @return string
+ */
+string RankRecord::toString(ulong column){
+    ostringstream oss;
+    oss<<"Record["<<DBT::toString(keys[column])<<"-"<<nodeHash;
+    if(not valid) oss<<" (deleted)";
+    oss<<"]";
+    return oss.str();
+}
+
+/**
+ * @brief Gets the size of bytes for a record with the given format when serialized.
+ *
+ * @param columnFormat
+ * @return number
+ */
+number getRankRecordBytesWhenSerialized(vector<AType> columnFormat){
+    RankRecord NULL_RECORD=RankRecord(columnFormat);
+    return NULL_RECORD.serialize().size();
+}
+
+/**
+ * @brief Ordering of the records in the layout of one column: first by key, then by nodeHash.
+ *
+ * @return true if a is smaller than b
+ */
+bool rankRecordSmaller(RankRecord a, RankRecord b, ulong column){
+    bool smallerKey= a.keys[column]<b.keys[column];
+    bool sameKey= a.keys[column]==b.keys[column];
+    return smallerKey or (sameKey and a.nodeHash<b.nodeHash);
+}
+
+/**
+ * @brief Sorts the records by the passed column using a bitonic sorting network.
+ * The sequence of compare-and-swap operations only depends on the number of records, all swaps are executed with _IF_THEN.
+ * The records are padded to the next power of two. Padding records are larger than any real record and removed afterwards.
+ *
+ * @param records
+ * @param column
+ */
+void obliviousSortRecords(vector<RankRecord> *records, ulong column){
+    size_t n=records->size();
+    if(n<2){
+        return;
+    }
+    size_t padded=1;
+    while(padded<n){
+        padded=padded<<1;
+    }
+    vector<RankRecord> &r=*records;
+    r.resize(padded, RankRecord(r[0].columnFormat));
+    vector<bool> isPadding(padded, false);
+    for (size_t i = n; i < padded; i++){
+        isPadding[i]=true;
+    }
+    ulong numColumns=r[0].numColumns;
+
+    for (size_t k = 2; k <= padded; k=k<<1){
+        for (size_t j = k>>1; j > 0; j=j>>1){
+            for (size_t i = 0; i < padded; i++){
+                size_t l=i^j;
+                if(l<=i){
+                    continue;
+                }
+                bool ascending= (i&k)==0;
+                bool iLarger= (isPadding[i] and not isPadding[l]) or
+                              ((not isPadding[i]) and (not isPadding[l]) and rankRecordSmaller(r[l], r[i], column));
+                bool lLarger= (isPadding[l] and not isPadding[i]) or
+                              ((not isPadding[i]) and (not isPadding[l]) and rankRecordSmaller(r[i], r[l], column));
+                bool swapRecords= (ascending and iLarger) or ((not ascending) and lLarger);
+
+                for (size_t c = 0; c < numColumns; c++){
+                    db_t tmp=_IF_THEN(swapRecords, r[l].keys[c], r[i].keys[c]);
+                    r[l].keys[c]=_IF_THEN(swapRecords, r[i].keys[c], r[l].keys[c]);
+                    r[i].keys[c]=tmp;
+                }
+                size_t tmpHash=_IF_THEN(swapRecords, r[l].nodeHash, r[i].nodeHash);
+                r[l].nodeHash=_IF_THEN(swapRecords, r[i].nodeHash, r[l].nodeHash);
+                r[i].nodeHash=tmpHash;
+                bool tmpValid=_IF_THEN(swapRecords, r[l].valid, r[i].valid);
+                r[l].valid=_IF_THEN(swapRecords, r[i].valid, r[l].valid);
+                r[i].valid=tmpValid;
+                bool tmpPadding=_IF_THEN(swapRecords, isPadding[l], isPadding[i]);
+                isPadding[l]=_IF_THEN(swapRecords, isPadding[i], isPadding[l]);
+                isPadding[i]=tmpPadding;
+            }
+        }
+    }
+    r.resize(n);
+}
+
+}
@@ -34,6 +34,7 @@ AVLTreeNode::AVLTreeNode(vector<AType> columnFormat, size_t sizeValue){
     this->columnFormat= columnFormat;
     numColumns=columnFormat.size();
     empty=true;
+    tombstone=false;
 
     key=vector<db_t>();
     for (size_t i = 0; i < numColumns; i++){
@@ -50,6 +51,7 @@ AVLTreeNode::AVLTreeNode(vector<AType> columnFormat, size_t sizeValue){
     next=vector<ulong>(numColumns,NULL_PTR);
     lHeight=vector<int>(numColumns,0);
     rHeight=vector<int>(numColumns,0);
+    resetAggregates();
 
 }
 
@@ -64,6 +66,7 @@ AVLTreeNode::AVLTreeNode(vector<AType> columnFormat, size_t sizeValue){
 AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, vector<AType> columnFormat, ulong nodeID){
     this->nodeID=nodeID;
     empty=false;
+    tombstone=false;
     this->columnFormat=columnFormat;
     numColumns=columnFormat.size();
 
@@ -75,6 +78,7 @@ AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, vector<AType> columnForma
     next=vector<ulong>(numColumns,NULL_PTR);
     lHeight=vector<int>(numColumns,0);
     rHeight=vector<int>(numColumns,0);
+    resetAggregates();
     
 }
 
@@ -91,6 +95,7 @@ AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, vector<AType> columnForma
 AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, bytes v, vector<AType> columnFormat, ulong nodeID){
     this->nodeID=nodeID;
     empty=false;
+    tombstone=false;
     this->columnFormat=columnFormat;
     numColumns=columnFormat.size();
 
@@ -102,6 +107,7 @@ AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, bytes v, vector<AType> co
     next=vector<ulong>(numColumns,NULL_PTR);
     lHeight=vector<int>(numColumns,0);
     rHeight=vector<int>(numColumns,0);
+    resetAggregates();
     
 }
 
@@ -126,6 +132,7 @@ AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, bytes v, vector<ulong> lC
     this->columnFormat=columnFormat;
     numColumns=columnFormat.size();
     empty=false;
+    tombstone=false;
    
     key=k;
     nodeHash=nHash;
@@ -135,6 +142,7 @@ AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, bytes v, vector<ulong> lC
     next=nN;
     lHeight=lH;
     rHeight=rH;
+    resetAggregates();
 }
 
 /**
@@ -158,6 +166,7 @@ AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, vector<ulong> lC, vector<
     this->columnFormat=columnFormat;
     numColumns=columnFormat.size();
     empty=false;
+    tombstone=false;
    
     key=k;
     nodeHash=nHash;
@@ -167,6 +176,7 @@ AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, vector<ulong> lC, vector<
     next=nN;
     lHeight=lH;
     rHeight=rH;
+    resetAggregates();
 }
 
 /**
@@ -177,8 +187,9 @@ AVLTreeNode::AVLTreeNode(vector<db_t> k, size_t nHash, vector<ulong> lC, vector<
  * @param dummy : Bool value indicating wether this is a dummy operation
  * @param columnFormat : Column format of the database. Relevant for parsing data.
  * @param sizeValue : The size of the value to be stored in the node (so the value associated with the keys).
+ * @param augmented : wether the serialized node contains subtree aggregates
  */
-AVLTreeNode::AVLTreeNode(bytes serializedNode, bool dummy, vector<AType> columnFormat, size_t sizeValue){
+AVLTreeNode::AVLTreeNode(bytes serializedNode, bool dummy, vector<AType> columnFormat, size_t sizeValue, bool augmented){
     this->nodeID=nodeID;
     this->columnFormat=columnFormat;
     numColumns=columnFormat.size();
@@ -274,6 +285,36 @@ AVLTreeNode::AVLTreeNode(bytes serializedNode, bool dummy, vector<AType> columnF
     ulong * vid=(ulong*) (&id[0]);
     nodeID=*vid;
 
+    s=s+len;
+    tombstone=(bool) serializedNode[s];
+
+    resetAggregates();
+    this->augmented=augmented;
+    if(augmented){
+        s=s+1;
+        vector<vector<number>*> counts={&lCount, &rCount};
+        for (size_t c = 0; c < counts.size(); c++){
+            memcpy(counts[c]->data(), &serializedNode[s], sizeof(number)*numColumns);
+            s=s+sizeof(number)*numColumns;
+        }
+        vector<vector<double>*> sums={&lSum, &rSum};
+        for (size_t c = 0; c < sums.size(); c++){
+            memcpy(sums[c]->data(), &serializedNode[s], sizeof(double)*numColumns);
+            s=s+sizeof(double)*numColumns;
+        }
+    }
+}
+
+/**
+ * @brief Sets all subtree aggregates to zero. The node is not augmented afterwards.
+ * 
+ */
+void AVLTreeNode::resetAggregates(){
+    augmented=false;
+    lCount=vector<number>(numColumns,0);
+    rCount=vector<number>(numColumns,0);
+    lSum=vector<double>(numColumns,0.0);
+    rSum=vector<double>(numColumns,0.0);
 }
 
 /**
@@ -354,6 +395,18 @@ bytes AVLTreeNode::serialize(){
     for (size_t i = 0; i < sizeof(ulong); i++){
         serialized.push_back(uBytes_ID[i]);
     }
+    serialized.push_back((uchar) tombstone);
+
+    if(augmented){
+        const uchar *counts[]={(uchar*) lCount.data(), (uchar*) rCount.data()};
+        for(const uchar *c : counts){
+            serialized.insert(serialized.end(), c, c+sizeof(number)*numColumns);
+        }
+        const uchar *sums[]={(uchar*) lSum.data(), (uchar*) rSum.data()};
+        for(const uchar *c : sums){
+            serialized.insert(serialized.end(), c, c+sizeof(double)*numColumns);
+        }
+    }
 
 
     serialized.shrink_to_fit();
@@ -365,10 +418,12 @@ bytes AVLTreeNode::serialize(){
  * 
  * @param columnFormat : Column format of the database. Relevant for parsing data.
  * @param sizeValue :
+ * @param augmented : wether the subtree aggregates are serialized
  * @return number : number of bytes of the serialized AVLTreeNode with the passed parameters
  */
-number getNumBytesWhenSerialized(vector<AType> columnFormat, size_t sizeValue){
+number getNumBytesWhenSerialized(vector<AType> columnFormat, size_t sizeValue, bool augmented){
     AVLTreeNode NULL_NODE=AVLTreeNode(columnFormat, sizeValue);
+    NULL_NODE.augmented=augmented;
     bytes serialized=NULL_NODE.serialize();
     return serialized.size();
 }
@@ -393,6 +448,27 @@ int AVLTreeNode::balanceFactor(ulong column){
     return (int)lHeight[column]-(int)rHeight[column];
 }
 
+/**
+ * @brief Number of nodes in the subtree of this node for a column, including the node itself.
+ * 
+ * @param column 
+ * @return number 
+ */
+number AVLTreeNode::subtreeCount(ulong column){
+    return lCount[column]+rCount[column]+1;
+}
+
+/**
+ * @brief Sum of the aggregated column over the subtree of this node for a column, including the node itself.
+ * 
+ * @param column 
+ * @param aggregateColumn : column whose values are summed up
+ * @return double 
+ */
+double AVLTreeNode::subtreeSum(ulong column, ulong aggregateColumn){
+    return lSum[column]+rSum[column]+DBT::toDouble(key[aggregateColumn]);
+}
+
 /**
  * @brief An ORAM can only contain data of a fixed Blocksize. 
  * First the node is serialized. For nodes which are smaller than that block size after serialization, padding is added.
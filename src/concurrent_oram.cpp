@@ -0,0 +1,124 @@
+#include "concurrent_oram.hpp"
+
+/**
+ * @brief This file contains a thread-safe front-end for a PathORAM::ORAM which aggregates the requests of multiple threads into ORAM::multiple calls.
+ * This allows several read-only operations (e.g. range scans of different queries) to share one ORAM.
+ *
+ */
+
+namespace DOSM{
+
+/**
+ * @brief Construct a new ConcurrentORAM::ConcurrentORAM object and starts the dispatcher thread.
+ *
+ * @param oram : the ORAM to be accessed. As long as the front-end exists, the ORAM must not be accessed directly.
+ * @param batchSize : maximum number of requests per ORAM::multiple call. Must not exceed the batch size the ORAM was created with.
+ */
+ConcurrentORAM::ConcurrentORAM(shared_ptr<PathORAM::ORAM> oram, number batchSize){
+    this->oram=oram;
+    this->batchSize=max(batchSize, 1ull);
+    this->dispatcher=thread(&ConcurrentORAM::run, this);
+}
+
+/**
+ * @brief Destroy the ConcurrentORAM::ConcurrentORAM object. Requests that are already queued are executed before the dispatcher stops.
+ *
+ */
+ConcurrentORAM::~ConcurrentORAM(){
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->stop=true;
+    }
+    this->wakeUp.notify_all();
+    this->dispatcher.join();
+}
+
+/**
+ * @brief Requests the block with the passed ID.
+ *
+ * @param block : ID of the block
+ * @return future<bytes> : contains the content of the block once the request was executed
+ */
+future<bytes> ConcurrentORAM::get(number block){
+    return enqueue(block, bytes());
+}
+
+/**
+ * @brief Writes data into the block with the passed ID.
+ *
+ * @param block : ID of the block
+ * @param data : content of the block, must not be empty
+ * @return future<bytes> : ready once the request was executed, contains data
+ */
+future<bytes> ConcurrentORAM::put(number block, bytes data){
+    return enqueue(block, data);
+}
+
+/**
+ * @brief Average number of requests that were executed with one ORAM::multiple call.
+ *
+ * @return double
+ */
+double ConcurrentORAM::getMeanBatchSize(){
+    lock_guard<mutex> guard(this->lock);
+    if(this->numBatches==0){
+        return 0.0;
+    }
+    return (double) this->numRequests/(double) this->numBatches;
+}
+
+future<bytes> ConcurrentORAM::enqueue(number block, bytes data){
+    unique_ptr<Request> request=make_unique<Request>();
+    request->block=block;
+    request->data=data;
+    future<bytes> response=request->response.get_future();
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->requests.push_back(move(request));
+    }
+    this->wakeUp.notify_one();
+    return response;
+}
+
+/**
+ * @brief Main loop of the dispatcher. Takes up to batchSize requests from the queue, executes them with one ORAM::multiple call and resolves their futures.
+ * If the ORAM throws, the exception is passed to all requests of the batch.
+ *
+ */
+void ConcurrentORAM::run(){
+    while(true){
+        vector<unique_ptr<Request>> batch;
+        {
+            unique_lock<mutex> guard(this->lock);
+            this->wakeUp.wait(guard, [&](){ return this->stop or not this->requests.empty(); });
+            if(this->requests.empty()){
+                return;
+            }
+            while(not this->requests.empty() and batch.size()<this->batchSize){
+                batch.push_back(move(this->requests.front()));
+                this->requests.pop_front();
+            }
+            this->numBatches++;
+            this->numRequests+=batch.size();
+        }
+
+        vector<block> oramRequests;
+        oramRequests.reserve(batch.size());
+        for(size_t i=0;i<batch.size();i++){
+            oramRequests.push_back(make_pair(batch[i]->block, batch[i]->data));
+        }
+        try{
+            vector<bytes> response;
+            this->oram->multiple(oramRequests, response);
+            for(size_t i=0;i<batch.size();i++){
+                batch[i]->response.set_value(response[i]);
+            }
+        }catch(...){
+            for(size_t i=0;i<batch.size();i++){
+                batch[i]->response.set_exception(current_exception());
+            }
+        }
+    }
+}
+
+}
@@ -4,6 +4,8 @@
 
 #include <stdexcept>
 #include <cfloat>
+#include <cmath>
+#include <numeric>
 
 using namespace std;
 using namespace DBT;
@@ -16,6 +18,9 @@ using namespace MENHIR;
 
 
 
+//maximum number of values that are summed up (unbounded differential privacy, following Casacuberta et al., Remark 6.27)
+const double SUM_N_MAX=670000000;
+
 wstring error_budget= L"Privacy Budget (QUERY_RESPONSE_EPSILON %9.2f was not sufficent to execute this operation (selected epsilon %9.2f) . Please select a smaller epsilon for this query.";
 
 /**
@@ -111,8 +116,8 @@ vector<double> clipping(vector<double> data, double lower, double upper){
 
 /**
  * @brief Returns the number of elements in data sanitized with differential privacy. Used for or COUNT(*) QUERIES.
- * Clipping is not always necessary here.
- * 
+ * Clipping does not change the number of elements, so the data is not copied or clipped here.
+ *
  * @param data : Data for computing the aggregate. Some dummy values are also in this vector.
  * @param ignoring : Which values to ignore from data during computation. This is for volume patter sanitation.
  * @param epsilon : privacy budget to be used during this operation
@@ -121,17 +126,16 @@ vector<double> clipping(vector<double> data, double lower, double upper){
  * @param clip : wether or not data needs to be clipped before processing
  * @return tuple<double,Error> : tuple containing the aggregate and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
  */
-tuple<double,Error>  dp_count(vector<db_t> data, vector<bool> ignoring, double epsilon, db_t lower, db_t upper, bool clip){
+tuple<double,Error>  dp_count(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon, db_t lower, db_t upper, bool clip){
     if(! checkBudget(epsilon)){
         Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
         print_err(err);
-		return make_tuple(NULL,err); 
+		return make_tuple(NULL,err);
     }
     AVAILABLE_BUDGET-=epsilon;
-    
-    if(clip) data=clipping(data, lower, upper);
+
     double count_sensitivity=1;
-    int numIgnoring = std::accumulate(ignoring.begin(), ignoring.end(), 0);    
+    int numIgnoring = std::accumulate(ignoring.begin(), ignoring.end(), 0);
     double value=(double) data.size() - numIgnoring;
     double result= laplace_mech(value,count_sensitivity, epsilon);
     return make_tuple(result, Error());
@@ -141,8 +145,8 @@ tuple<double,Error>  dp_count(vector<db_t> data, vector<bool> ignoring, double e
 /**
  * @brief Returns the number of elements in data sanitized with differential privacy. Used for COUNT(*) QUERIES.
  * This functions accepts a vector of doubles instead a vector of db_t
- * Clipping is not always necessary here.
- * 
+ * Clipping does not change the number of elements, so the data is not copied or clipped here.
+ *
  * @param data : Data for computing the aggregate. Some dummy values are also in this vector.
  * @param ignoring : Which values to ignore from data during computation. This is for volume patter sanitation.
  * @param epsilon : privacy budget to be used during this operation
@@ -151,17 +155,16 @@ tuple<double,Error>  dp_count(vector<db_t> data, vector<bool> ignoring, double e
  * @param clip : wether or not data needs to be clipped before processing
  * @return tuple<double,Error> : tuple containing the aggregate and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
  */
-tuple<double,Error>  dp_count(vector<double> data, vector<bool> ignoring, double epsilon, double lower, double upper, bool clip){
+tuple<double,Error>  dp_count(const vector<double> &data, const vector<bool> &ignoring, double epsilon, double lower, double upper, bool clip){
     if(! checkBudget(epsilon)){
         Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
         print_err(err);
-		return make_tuple(NULL,err); 
+		return make_tuple(NULL,err);
     }
     AVAILABLE_BUDGET-=epsilon;
-    
-    if(clip) data=clipping(data, lower, upper);
+
     double count_sensitivity=1;
-    int numIgnoring = std::accumulate(ignoring.begin(), ignoring.end(), 0);    
+    int numIgnoring = std::accumulate(ignoring.begin(), ignoring.end(), 0);
     double value=(double) data.size() - numIgnoring;
     double result= laplace_mech(value,count_sensitivity, epsilon);
     return make_tuple(result, Error());
@@ -171,60 +174,148 @@ tuple<double,Error>  dp_count(vector<double> data, vector<bool> ignoring, double
 
 
 /**
- * @brief Following algorithms for summation of float from Casacuberta et al.[2022]: "compensated summations".
- * Sensitivity is O(n/2^k)*max(|Lower|, Upper) where k is the number of bit in a double.
+ * @brief Sensitivity of a sum of at most SUM_N_MAX doubles in [lower, upper] computed with compensated summation, following Casacuberta et al.[2022].
  * 
- * @param vec : Data for computing the aggregate. Some dummy values are also in this vector.
- * @param ignoring : Which values to ignore from vec during computation. This is for volume patter sanitation.
- * @return double : Differentially private sum.
+ * @param lower : lower cutoff point for clipping
+ * @param upper : upper cutoff point for clipping
+ * @return double 
  */
-double kahan_sum(vector<double> vec, vector<bool> ignoring){
-    double sum=0.0;
-    double c=0.0;
-    for(size_t i=0;i<vec.size();i++){
-        double y= vec[i]-c;
-        double t=sum+y;
-        c=(t-sum) -y;
-        bool dummy=ignoring[i];
-        sum=dummy*0+(not dummy)*t;
+double kahan_sensitivity(double lower, double upper){
+    double twok= (double) pow(2,DBL_MANT_DIG); //since double uses a Matissa with 53 bit
+    if((upper<=0 and lower<=0) or (upper>=0 and lower>=0) ){
+        return (1+(SUM_N_MAX/twok))*max(abs(lower),upper);
     }
-    return sum;
+    return (1+SUM_N_MAX/twok)*max(abs(lower),max(upper, upper-lower));
+}
 
+/**
+ * @brief Copies the values of a column into a contiguous array of doubles, so that fused_sums() can process them without branching on the type of each db_t.
+ * INT values are represented exactly as long as they fit into the mantissa of a double.
+ *
+ * @param data
+ * @return vector<double>
+ */
+vector<double> toDoubleArray(const vector<db_t> &data){
+    vector<double> values(data.size());
+    for(size_t i=0;i<data.size();i++){
+        values[i]=toDouble(data[i]);
+    }
+    return values;
 }
 
+/**
+ * @brief Copies the bits of ignoring into one byte per value, so that fused_sums() can load them as numbers instead of unpacking vector<bool> for each element.
+ *
+ * @param ignoring
+ * @return vector<uchar>
+ */
+vector<uchar> toMaskArray(const vector<bool> &ignoring){
+    vector<uchar> mask(ignoring.size());
+    for(size_t i=0;i<ignoring.size();i++){
+        mask[i]=ignoring[i];
+    }
+    return mask;
+}
 
+#define FUSED_SUMS_LANES 8
 
 /**
- * @brief Following algorithms for summation of float from Casacuberta et al.[2022].
- * Takes log(n) steps, apparently the numpy default.
- *  Sensitivity is O(n*log(n)/2^k)*max(|Lower|,Upper), where k is the number of bit in a double.
- * 
- * @param vec : Data for computing the aggregate. Some dummy values are also in this vector. 
- * @param ignoring : Which values to ignore from vec during computation. This is for volume patter sanitation. 
- * @return double : Differentially private sum.
+ * @brief Computes all sums needed by the DP aggregates in one branch-free pass over the data.
+ * Every value is clipped to [lower, upper] and multiplied with 0 or 1 depending on ignoring, so all values are processed in the same way.
+ * The values are split into FUSED_SUMS_LANES interleaved lanes with their own accumulators, which lets the compiler vectorize the inner loop (omp simd).
+ * Sums are compensated (Kahan) per lane and the lanes are combined with compensated summation as well, so kahan_sensitivity() still applies.
+ * Clipping can be disabled by passing -infinity and +infinity as limits.
+ *
+ * @param values : contiguous values, e.g. from toDoubleArray()
+ * @param ignoring : 1 for every value that is to be ignored, 0 otherwise, e.g. from toMaskArray()
+ * @param n : number of values
+ * @param lower : lower cutoff point for clipping
+ * @param upper : upper cutoff point for clipping
+ * @param center : point from which sumAbsDeviation is measured, e.g. the mean
+ * @return FusedSums
  */
-double pairwise_sum(vector<double> vec, vector<bool> ignoring){
-    size_t n=  vec.size();
-    if(vec.size()<2ull){
-        bool dummy= ignoring[0];
-        return 0*dummy+vec[0]*(not dummy);
-    }else{
-        size_t m= floor(n/2ull);
-        vector<double> split_lo(vec.begin(), vec.begin() + m);
-        vector<double> split_hi(vec.begin() + m, vec.end());
-        vector<bool> splitIgnoring_lo(ignoring.begin(), ignoring.begin() + m);
-        vector<bool> splitIgnoring_hi(ignoring.begin() + m, ignoring.end());
+FusedSums fused_sums(const double *values, const uchar *ignoring, size_t n, double lower, double upper, double center){
+    double count[FUSED_SUMS_LANES]={0.0};
+    double sum[FUSED_SUMS_LANES]={0.0};
+    double sumC[FUSED_SUMS_LANES]={0.0};
+    double absDev[FUSED_SUMS_LANES]={0.0};
+    double absDevC[FUSED_SUMS_LANES]={0.0};
+
+    for(size_t i=0;i<n;i+=FUSED_SUMS_LANES){
+        //the last block may be incomplete, its missing values are handled as ignored values in lane order
+        size_t width=min((size_t) FUSED_SUMS_LANES, n-i);
+        #pragma omp simd
+        for(size_t l=0;l<FUSED_SUMS_LANES;l++){
+            bool inRange=l<width;
+            size_t index=i+l*inRange;
+            double used=inRange*(1.0-ignoring[index]);
+            double value=min(max(values[index],lower),upper);
+            double deviation=value-center;
+
+            double y=used*value-sumC[l];
+            double t=sum[l]+y;
+            sumC[l]=(t-sum[l])-y;
+            sum[l]=t;
+
+            y=used*abs(deviation)-absDevC[l];
+            t=absDev[l]+y;
+            absDevC[l]=(t-absDev[l])-y;
+            absDev[l]=t;
+
+            count[l]+=used;
+        }
+    }
 
-        double sum=pairwise_sum(split_lo,splitIgnoring_lo)+pairwise_sum(split_hi,splitIgnoring_hi);
-        return sum;
+    FusedSums result;
+    double resultSumC=0.0;
+    double resultAbsDevC=0.0;
+    for(size_t l=0;l<FUSED_SUMS_LANES;l++){
+        double y=(sum[l]-sumC[l])-resultSumC;
+        double t=result.sum+y;
+        resultSumC=(t-result.sum)-y;
+        result.sum=t;
+
+        y=(absDev[l]-absDevC[l])-resultAbsDevC;
+        t=result.sumAbsDeviation+y;
+        resultAbsDevC=(t-result.sumAbsDeviation)-y;
+        result.sumAbsDeviation=t;
+
+        result.count+=count[l];
     }
+    return result;
+}
+
+/**
+ * @brief We are using unbounded Differential Privacy for sums of floats. If there are more than SUM_N_MAX values, they are randomly permuted and truncated
+ * following Casacuberta et al. , Remark 6.27. Otherwise the values are kept as they are, since summation with fused_sums() does not depend on their order.
+ *
+ * @param values
+ * @param ignoring : permuted and truncated in the same way as values
+ */
+void truncateForSum(vector<double> &values, vector<uchar> &ignoring){
+    if(values.size()<=SUM_N_MAX){
+        return;
+    }
+    std::vector<size_t> indexes(values.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::shuffle(indexes.begin(), indexes.end(), GENERATOR);
+    indexes.resize(SUM_N_MAX);
+
+    vector<double> shuffledValues(indexes.size());
+    vector<uchar> shuffledIgnoring(indexes.size());
+    for(size_t i=0;i<indexes.size();i++){
+        shuffledValues[i]=values[indexes[i]];
+        shuffledIgnoring[i]=ignoring[indexes[i]];
+    }
+    values=shuffledValues;
+    ignoring=shuffledIgnoring;
 }
 
 /**
  * @brief Returns the differentially private sum for data.
  * We are using Kahan summation according to Casacuberta et al.[2022] for better sensitivity bounds.
- * We are using unbounded Differential Privacy here. Therefore data is randomly permuted and truncated before summation.
- * 
+ * We are using unbounded Differential Privacy here. Therefore data is randomly permuted and truncated before summation if it contains more than SUM_N_MAX values.
+ *
  * @param data : Data for computing the aggregate. Some dummy values are also in this vector.
  * @param ignoring : Which values to ignore from data during computation. This is for volume patter sanitation.
  * @param epsilon : privacy budget to be used during this operation
@@ -233,11 +324,11 @@ double pairwise_sum(vector<double> vec, vector<bool> ignoring){
  * @param clip : wether or not data needs to be clipped before processing
  * @return tuple<double,Error> : tuple containing the aggregate and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
  */
-tuple<double,Error>  dp_sum_double(vector<double> data, vector<bool> ignoring, double epsilon, double lower, double upper, bool clip){
+tuple<double,Error>  dp_sum_double(const vector<double> &data, const vector<bool> &ignoring, double epsilon, double lower, double upper, bool clip){
     if(! checkBudget(epsilon)){
         Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
         print_err(err);
-		return make_tuple(NULL,err); 
+		return make_tuple(NULL,err);
     }
 
     if(abs(lower)>upper){
@@ -245,46 +336,22 @@ tuple<double,Error>  dp_sum_double(vector<double> data, vector<bool> ignoring, d
         "Limits need to be the following to ensure privacy: abs(lower)<=upper but was not. "\
         " No privacy budget was consumed by this action.");
         print_err(err);
-		return make_tuple(NULL,err); 
-    }   
+		return make_tuple(NULL,err);
+    }
 
 
     AVAILABLE_BUDGET-=epsilon;
 
-    std::vector<int> indexes;
-    indexes.reserve(data.size());
-    for (size_t i = 0; i < data.size(); ++i)
-        indexes.push_back(i);
-    std::shuffle(indexes.begin(), indexes.end(), GENERATOR);
+    vector<double> values=data;
+    vector<uchar> mask=toMaskArray(ignoring);
+    truncateForSum(values, mask);
 
-    vector<double> shuffledData;
-    vector<bool> shuffledIgnoring;
-    for(size_t i=0;i<indexes.size();i++){
-        int oldIndex=indexes[i];
-        shuffledData.push_back(data[oldIndex]);
-        shuffledIgnoring.push_back(ignoring[oldIndex]);
-    }
-    data=shuffledData;
-    ignoring=shuffledIgnoring;
+    double clipLower=clip ? lower : -INFINITY;
+    double clipUpper=clip ? upper : INFINITY;
+    FusedSums sums=fused_sums(values.data(), mask.data(), values.size(), clipLower, clipUpper);
 
-    //truncating vector to ensure unbounded differential privacy
-    // following Casacuberta et al. , Remark 6.27
-    double n_max=670000000;
-    data.resize(n_max);
-
-    if(clip) data=clipping(data, lower, upper);
-
-    double twok= (double) pow(2,DBL_MANT_DIG); //since double uses a Matissa with 53 bit
-    
-    double kahan_sensivity;
-    if((upper<=0 and lower<=0) or (upper>=0 and lower>=0) ){
-        kahan_sensivity= (1+(n_max/twok))*max(abs(lower),upper);
-    }else{
-        kahan_sensivity=(1+n_max/twok)*max(abs(lower),max(upper, upper-lower));
-    }
-
-    double sum= kahan_sum(data,ignoring);
-    double result= laplace_mech(sum,kahan_sensivity, epsilon);
+    double kahan_sensivity=kahan_sensitivity(lower, upper);
+    double result= laplace_mech(sums.sum,kahan_sensivity, epsilon);
     return make_tuple(result, Error());
 }
 
@@ -293,7 +360,7 @@ tuple<double,Error>  dp_sum_double(vector<double> data, vector<bool> ignoring, d
 /**
  * @brief Returns the differentially private sum for data.
  *  This mechanism  has modular sensitivity according to Casacuberta et al.[2022]
- * 
+ *
  * @param data : Data for computing the aggregate. Some dummy values are also in this vector.
  * @param ignoring : Which values to ignore from data during computation. This is for volume patter sanitation.
  * @param epsilon : privacy budget to be used during this operation
@@ -302,25 +369,23 @@ tuple<double,Error>  dp_sum_double(vector<double> data, vector<bool> ignoring, d
  * @param clip : wether or not data needs to be clipped before processing
  * @return tuple<double,Error> : tuple containing the aggregate and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
  */
-tuple<double,Error>  dp_sum_int(vector<db_t> data, vector<bool> ignoring, double epsilon, db_t lower, db_t upper, bool clip){
+tuple<double,Error>  dp_sum_int(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon, db_t lower, db_t upper, bool clip){
     if(! checkBudget(epsilon)){
         Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
         print_err(err);
-		return make_tuple(NULL,err); 
+		return make_tuple(NULL,err);
     }
-    
+
     AVAILABLE_BUDGET-=epsilon;
 
-    if(clip) data=clipping(data, lower, upper);
+    vector<double> values=toDoubleArray(data);
+    vector<uchar> mask=toMaskArray(ignoring);
+    double clipLower=clip ? toDouble(lower) : -INFINITY;
+    double clipUpper=clip ? toDouble(upper) : INFINITY;
+    FusedSums sums=fused_sums(values.data(), mask.data(), values.size(), clipLower, clipUpper);
 
     int sensitivity= upper.val.i; //uppper is the sensitivity because we are using unbounded differential privacy
-    int sum=0;
-    for (size_t i=0;i<data.size();i++){
-        int val=data[i].val.i;
-        bool dummy=ignoring[i];
-        sum+=0*(dummy)+val*(not dummy);
-    }
-    int result= laplace_mech(sum,sensitivity, epsilon);
+    int result= laplace_mech((int) llround(sums.sum),sensitivity, epsilon);
     return make_tuple(result, Error());
 }
 
@@ -329,7 +394,7 @@ tuple<double,Error>  dp_sum_int(vector<db_t> data, vector<bool> ignoring, double
  * @brief Returns the differentially private sum for data. Uses the improved noisy bounded sum algorithms by Casacuberta.
  * Floating point arithmetic and integer arithmetic are two different cases so two different algorithms are used.
  * Clipping is necessary unless the data has been clipped in a prior step.
- * 
+ *
  * @param data : Data for computing the aggregate. Some dummy values are also in this vector.
  * @param ignoring : Which values to ignore from data during computation. This is for volume patter sanitation.
  * @param epsilon : privacy budget to be used during this operation
@@ -338,12 +403,12 @@ tuple<double,Error>  dp_sum_int(vector<db_t> data, vector<bool> ignoring, double
  * @param clip : wether or not data needs to be clipped before processing
  * @return tuple<double,Error> : tuple containing the aggregate and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
  */
-tuple<double,Error>  dp_sum(vector<db_t> data, vector<bool> ignoring, double epsilon,  db_t lower, db_t upper, bool clip){
+tuple<double,Error>  dp_sum(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon,  db_t lower, db_t upper, bool clip){
     if(data.size()==0){
         return make_tuple(0.0,Error());
     }
     if(detectType(data[0])==AType::FLOAT){
-        vector<double> data_d=vecToDouble(data);
+        vector<double> data_d=toDoubleArray(data);
         double lower_d=toDouble(lower);
         double upper_d=toDouble(upper);
         return dp_sum_double(data_d, ignoring, epsilon,lower_d,upper_d,true );
@@ -357,77 +422,74 @@ tuple<double,Error>  dp_sum(vector<db_t> data, vector<bool> ignoring, double eps
 
 /**
  * @brief Returns a differentially private mean for data. Splits the the calculation of mean into two laplace algorithms.
- * Privacy cost is epsilon_sum + epsilon_count.
- * 
+ * Privacy cost is epsilon_sum + epsilon_count. Sum and count are computed in the same pass with fused_sums().
+ *
  * @param data : Data for computing the aggregate. Some dummy values are also in this vector.
  * @param ignoring : Which values to ignore from data during computation. This is for volume patter sanitation.
  * @param epsilon : privacy budget to be used during this operation
  * @param lower : lower cutoff point for clipping
  * @param upper : upper cutoff point for clipping
- * @param clip : wether or not data needs to be clipped before processing 
+ * @param clip : wether or not data needs to be clipped before processing
  * @return tuple<double,Error> : tuple containing the aggregate and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
  */
-tuple<double,Error> dp_mean(vector<db_t> data, vector<bool> ignoring, double epsilon, db_t lower, db_t upper, bool clip){
+tuple<double,Error> dp_mean(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon, db_t lower, db_t upper, bool clip){
     if(! checkBudget(epsilon)){
         Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
         print_err(err);
-		return make_tuple(NULL,err); 
-    }
-  
-    if(clip){
- 
-        data=clipping(data, lower, upper);
+		return make_tuple(NULL,err);
     }
 
-    int sum,count;
-    double mean;
-    Error err =Error();
-    tie(sum, err) = dp_sum(data,ignoring, epsilon/2, lower, upper,false);
-    if(err.is_err()) return make_tuple(NULL,err);
-    tie(count, err) = dp_count(data, ignoring,epsilon/2,lower, upper,false);
-    if(err.is_err()) return make_tuple(NULL,err);
-    mean=sum/count;
+    AType type=detectType(data.size()==0 ? lower : data[0]);
+    vector<double> values=toDoubleArray(data);
+    vector<uchar> mask=toMaskArray(ignoring);
+    if(type==AType::FLOAT) truncateForSum(values, mask);
+
+    double clipLower=clip ? toDouble(lower) : -INFINITY;
+    double clipUpper=clip ? toDouble(upper) : INFINITY;
+    FusedSums sums=fused_sums(values.data(), mask.data(), values.size(), clipLower, clipUpper);
 
-    return make_tuple(mean, err);
+    return dp_mean_aggregate((number) sums.count, sums.sum, type, epsilon, lower, upper);
 }
 
 
 /**
  * @brief Returns the differentially private variance of data. Privacy cost is epsilon_mean+epsilon_sum + epsilon_count.
- * 
- * @param data : Data for computing the aggregate. Some dummy values are also in this vector. 
- * @param ignoring : Which values to ignore from data during computation. This is for volume patter sanitation. 
- * @param epsilon : privacy budget to be used during this operation 
+ * The deviations are measured from the noisy mean, so two passes with fused_sums() are needed: one for the mean and one for the deviations.
+ *
+ * @param data : Data for computing the aggregate. Some dummy values are also in this vector.
+ * @param ignoring : Which values to ignore from data during computation. This is for volume patter sanitation.
+ * @param epsilon : privacy budget to be used during this operation
  * @param ddof : "Delta Degrees of Freedom”
- * @param lower : lower cutoff point for clipping 
- * @param upper : upper cutoff point for clipping 
- * @param clip : wether or not data needs to be clipped before processing 
+ * @param lower : lower cutoff point for clipping
+ * @param upper : upper cutoff point for clipping
+ * @param clip : wether or not data needs to be clipped before processing
  * @return tuple<double,Error> : tuple containing the variance and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
  */
-tuple<double,Error> dp_var(vector<db_t> data, vector<bool> ignoring, double epsilon, int ddof, db_t lower, db_t upper, bool clip){
+tuple<double,Error> dp_var(const vector<db_t> &data, const vector<bool> &ignoring, double epsilon, int ddof, db_t lower, db_t upper, bool clip){
     if(! checkBudget(epsilon)){
         Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
         print_err(err);
-		return make_tuple(NULL,err); 
-    }
-    if(clip){ 
-        data=clipping(data, lower, upper);
+		return make_tuple(NULL,err);
     }
 
+    AType type=detectType(data.size()==0 ? lower : data[0]);
+    vector<double> values=toDoubleArray(data);
+    vector<uchar> mask=toMaskArray(ignoring);
+    truncateForSum(values, mask);
+
+    double clipLower=clip ? toDouble(lower) : -INFINITY;
+    double clipUpper=clip ? toDouble(upper) : INFINITY;
+
     double mean_x,sum,count,var;
-    vector<double> diffs_d;
     Error err;
-    tie(mean_x, err)=dp_mean(data,ignoring, epsilon/2, lower, upper, false);
+    FusedSums sums=fused_sums(values.data(), mask.data(), values.size(), clipLower, clipUpper);
+    tie(mean_x, err)=dp_mean_aggregate((number) sums.count, sums.sum, type, epsilon/2, lower, upper);
     if(err.is_err()) return make_tuple(NULL,err);
-    for(db_t a: data){
-        double da=toDouble(a);
-        diffs_d.push_back(std::abs(da-mean_x));
-    }
-    double lower_d= toDouble(lower);
-    double upper_d = toDouble(upper);
-    tie(sum,err)=dp_sum_double(diffs_d, ignoring, epsilon/4.0, lower_d, upper_d, false);
+
+    sums=fused_sums(values.data(), mask.data(), values.size(), clipLower, clipUpper, mean_x);
+    tie(sum,err)=dp_sum_aggregate(sums.sumAbsDeviation, AType::FLOAT, epsilon/4.0, lower, upper);
     if(err.is_err()) return make_tuple(NULL,err);
-    tie(count,err)=dp_count(diffs_d, ignoring, epsilon/4.0,  lower_d, upper_d, false);
+    tie(count,err)=dp_count_aggregate((number) sums.count, epsilon/4.0);
     if(err.is_err()) return make_tuple(NULL,err);
 
     var= sum/(count-ddof);
@@ -579,3 +641,197 @@ tuple<db_t,Error> report_noisy_min_finite_int( vector<db_t> data, vector<bool> i
     return make_tuple(result,Error());
 
 }
+
+
+
+/**
+ * @brief Returns the differentially private count for a count that was computed without retrieving records (e.g. from subtree aggregates, see USE_SUBTREE_AGGREGATES).
+ * Uses the same sensitivity as dp_count().
+ * 
+ * @param count : exact number of records
+ * @param epsilon : privacy budget to be used during this operation
+ * @return tuple<double,Error> : tuple containing the aggregate and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
+ */
+tuple<double,Error> dp_count_aggregate(number count, double epsilon){
+    if(! checkBudget(epsilon)){
+        Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
+        print_err(err);
+		return make_tuple(NULL,err); 
+    }
+    AVAILABLE_BUDGET-=epsilon;
+
+    double count_sensitivity=1;
+    double result= laplace_mech((double) count,count_sensitivity, epsilon);
+    return make_tuple(result, Error());
+}
+
+/**
+ * @brief Returns the differentially private sum for a sum that was computed without retrieving records (e.g. from subtree aggregates, see USE_SUBTREE_AGGREGATES).
+ * Uses the same sensitivity as dp_sum(), the values are expected to lie in [lower, upper].
+ * 
+ * @param sum : exact sum
+ * @param type : type of the summed column
+ * @param epsilon : privacy budget to be used during this operation
+ * @param lower : smallest value of the column
+ * @param upper : largest value of the column
+ * @return tuple<double,Error> : tuple containing the aggregate and an Error object. If not enough privacy budget was available the aggregate will be Null and the Error object will contain information.
+ */
+tuple<double,Error> dp_sum_aggregate(double sum, AType type, double epsilon, db_t lower, db_t upper){
+    if(! checkBudget(epsilon)){
+        Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
+        print_err(err);
+		return make_tuple(NULL,err); 
+    }
+
+    if(type==AType::INT){
+        AVAILABLE_BUDGET-=epsilon;
+        int sensitivity= upper.val.i; //uppper is the sensitivity because we are using unbounded differential privacy
+        int result= laplace_mech((int) llround(sum),sensitivity, epsilon);
+        return make_tuple(result, Error());
+    }
+
+    double lower_d=toDouble(lower);
+    double upper_d=toDouble(upper);
+    if(abs(lower_d)>upper_d){
+        Error err=Error(L"Error in Summation algorithm!"\
+        "Limits need to be the following to ensure privacy: abs(lower)<=upper but was not. "\
+        " No privacy budget was consumed by this action.");
+        print_err(err);
+		return make_tuple(NULL,err); 
+    }
+    AVAILABLE_BUDGET-=epsilon;
+    double result= laplace_mech(sum,kahan_sensitivity(lower_d, upper_d), epsilon);
+    return make_tuple(result, Error());
+}
+
+/**
+ * @brief Returns the differentially private mean for a count and a sum that were computed without retrieving records. 
+ * As dp_mean(), half of the budget is used for the sum and half for the count.
+ * 
+ * @param count : exact number of records
+ * @param sum : exact sum
+ * @param type : type of the summed column
+ * @param epsilon : privacy budget to be used during this operation
+ * @param lower : smallest value of the column
+ * @param upper : largest value of the column
+ * @return tuple<double,Error> 
+ */
+tuple<double,Error> dp_mean_aggregate(number count, double sum, AType type, double epsilon, db_t lower, db_t upper){
+    if(! checkBudget(epsilon)){
+        Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
+        print_err(err);
+		return make_tuple(NULL,err); 
+    }
+
+    double noisySum, noisyCount;
+    Error err =Error();
+    tie(noisySum, err) = dp_sum_aggregate(sum, type, epsilon/2, lower, upper);
+    if(err.is_err()) return make_tuple(NULL,err);
+    tie(noisyCount, err) = dp_count_aggregate(count, epsilon/2);
+    if(err.is_err()) return make_tuple(NULL,err);
+
+    return make_tuple(noisySum/noisyCount, err);
+}
+
+/**
+ * @brief Construct a new StreamingAggregate::StreamingAggregate object without any values.
+ * 
+ * @param type : type of the column
+ * @param lower : lower cutoff point for clipping
+ * @param upper : upper cutoff point for clipping
+ */
+StreamingAggregate::StreamingAggregate(AType type, db_t lower, db_t upper){
+    this->type=type;
+    this->lower=lower;
+    this->upper=upper;
+}
+
+/**
+ * @brief Adds one value. As in fused_sums(), ignored values are processed in the same way as all other values.
+ * 
+ * @param value 
+ * @param ignore : wether the value is a dummy or lies outside the queried range
+ */
+void StreamingAggregate::add(db_t value, bool ignore){
+    if(value<lower) value=lower;
+    else if(value>upper) value=upper;
+
+    count+=not ignore;
+    if(type==AType::INT){
+        intSum+=_IF_THEN(ignore, 0ll, ((long long) value.val.i));
+    }else{
+        double y=toDouble(value)-compensation;
+        double t=sum+y;
+        double c=(t-sum)-y;
+        sum=_IF_THEN(ignore, sum, t);
+        compensation=_IF_THEN(ignore, compensation, c);
+    }
+}
+
+/**
+ * @brief Adds the values of another aggregate of the same column, e.g. from another OSM.
+ * 
+ * @param other 
+ */
+void StreamingAggregate::merge(const StreamingAggregate &other){
+    count+=other.count;
+    intSum+=other.intSum;
+    double y=(other.sum-other.compensation)-compensation;
+    double t=sum+y;
+    compensation=(t-sum)-y;
+    sum=t;
+}
+
+/**
+ * @brief Sum of all values that were not ignored.
+ * 
+ * @return double 
+ */
+double StreamingAggregate::getSum() const{
+    if(type==AType::INT){
+        return (double) intSum;
+    }
+    return sum;
+}
+
+/**
+ * @brief Returns a differentially private quantile by a noisy binary search over the domain [lower, upper] with step size resolution.
+ * Each step perturbs (number of values <= mid) - p * (number of values) for the current candidate mid. Adding or removing one record changes this difference by at most max(p,1-p)<=1.
+ * The number of steps only depends on the domain and not on the data, so the budget is split evenly between them.
+ * 
+ * @param rankDifference : returns (number of values <= mid) - p * (number of values) for a candidate mid
+ * @param lower : smallest possible value of the quantile
+ * @param upper : largest possible value of the quantile
+ * @param resolution : distance between two neighbouring values of the domain
+ * @param epsilon : privacy budget to be used during this operation
+ * @return tuple<double,Error> : tuple containing the quantile and an Error object. If not enough privacy budget was available the quantile will be Null and the Error object will contain information.
+ */
+tuple<double,Error> dp_quantile(function<double(double)> rankDifference, double lower, double upper, double resolution, double epsilon){
+    if(! checkBudget(epsilon)){
+        Error err=Error(boost::wformat(error_budget)%QUERY_RESPONSE_EPSILON % epsilon);
+        print_err(err);
+		return make_tuple(NULL,err); 
+    }
+    if(upper<lower or resolution<=0){
+        Error err=Error(L"Error in Quantile algorithm!"\
+        "The domain of the quantile is empty. "\
+        " No privacy budget was consumed by this action.");
+        print_err(err);
+		return make_tuple(NULL,err); 
+    }
+    AVAILABLE_BUDGET-=epsilon;
+
+    number numCandidates=(number) floor((upper-lower)/resolution)+1;
+    number numSteps=(number) ceil(log2((double) numCandidates));
+    double stepEpsilon=epsilon/max(numSteps, 1ull);
+    double lo=lower;
+    double hi=lower+(numCandidates-1)*resolution;
+    for(number i=0;i<numSteps;i++){
+        double mid=lo+floor((hi-lo)/resolution/2)*resolution;
+        double noisyDifference=laplace_mech(rankDifference(mid), 1.0, stepEpsilon);
+        bool atMostMid=noisyDifference>=0;
+        hi=_IF_THEN(atMostMid, mid, hi);
+        lo=_IF_THEN(atMostMid, lo, (min(mid+resolution, hi)));
+    }
+    return make_tuple(lo, Error());
+}
@@ -31,12 +31,14 @@ namespace MENHIR{
 
 			LOG(INFO, L"Constructing synthetic data set and queries...");
 			generateArtificial();
+			addQueryOutputs();
 			storeInputs(QUERIES, INPUT_DATA);
 			//ORAM_CAPACITY =INPUT_DATA.size();
 			//LOG_PARAMETER(ORAM_CAPACITY);
 		}else if(DATASOURCE==FROM_REAL){
 			LOG(INFO, L"Reading data from data set and constructing synthetic queries...");
 			generateFromReal();
+			addQueryOutputs();
 			storeInputs(QUERIES, INPUT_DATA);
 			//ORAM_CAPACITY =INPUT_DATA.size();
 			//LOG_PARAMETER(ORAM_CAPACITY);
@@ -65,6 +67,24 @@ namespace MENHIR{
 
 
 
+	/**
+	 * @brief Adds one output for each function in ADDITIONAL_QUERY_FUNCTIONS to the generated queries. 
+	 * The outputs aggregate the same column as the query and the epsilon of each query is split evenly between its outputs, so the total budget stays the same.
+	 * 
+	 */
+	void addQueryOutputs(){
+		if(ADDITIONAL_QUERY_FUNCTIONS.empty()){
+			return;
+		}
+		for(size_t i=0;i<QUERIES.size();i++){
+			Query &query=QUERIES[i];
+			query.epsilon=query.epsilon/(1+ADDITIONAL_QUERY_FUNCTIONS.size());
+			for(auto agg : ADDITIONAL_QUERY_FUNCTIONS){
+				query.outputs.push_back(QueryOutput{query.attributeIndex, agg, query.epsilon, query.extra});
+			}
+		}
+	}
+
 	/**
 	 * @brief Create a new data set from a real wold dataset. 
 	 * If the passed dataset is larger than the number of required data points, only every nth row is added to the data set.
@@ -89,6 +89,7 @@ namespace MENHIR{
     
     number NUM_QUERIES = 10uLL; //for generating data
     AggregateFunc QUERY_FUNCTION=AggregateFunc::SUM; //for generating data
+    vector<AggregateFunc> ADDITIONAL_QUERY_FUNCTIONS; //for generating data, computed over the same records as QUERY_FUNCTION
     uint QUERY_INDEX=0; //for generating data
     uint WHERE_INDEX=NUM_ATTRIBUTES>1?1:0; //for generating data
     bool POINT_QUERIES = false; //for generating data
@@ -124,6 +125,35 @@ namespace MENHIR{
     bool USE_ORAM= true;
     number BATCH_SIZE= 1uLL;
 
+    INDEX_MODE_T INDEX_MODE=AVL_ONLY; //LEAF_PAGES additionally packs consecutive records of each column into pages for range scans
+    number LEAF_PAGE_SIZE=16uLL; //number of records per leaf page (only used if INDEX_MODE==LEAF_PAGES)
+    number RANK_REBUILD_THRESHOLD=64uLL; //number of inserts and deletes after which the rank layout is rebuilt (only used if INDEX_MODE==RANK_LAYOUT)
+
+    bool USE_LSM=false; //new records are inserted into a small write buffer OSM which is merged into larger OSMs in the background
+    number LSM_BUFFER_SIZE=1024uLL; //number of records in the write buffer before it is merged (only used if USE_LSM)
+    number LSM_SIZE_RATIO=4uLL; //an OSM is merged with the newer records if it holds at most LSM_SIZE_RATIO times as many records (only used if USE_LSM)
+    bool USE_TOMBSTONES=false; //deletes only mark nodes as deleted, OSMs are rebuilt in the background once enough nodes are marked
+    double TOMBSTONE_RATIO=0.25; //share of marked nodes after which an OSM is rebuilt (only used if USE_TOMBSTONES)
+    number WORKER_POOL_SIZE=0uLL; //number of worker threads used to access the OSMs in parallel, 0 means one per hardware thread
+    bool PIN_WORKERS=false; //if true, each worker thread is pinned to one core
+    number QUERIES_IN_FLIGHT=1uLL; //number of queries that are executed on the OSMs at the same time (pipelined across the workers)
+    number NUM_REPLICAS=1uLL; //number of copies of each OSM that answer queries in the querying phase, 1 means only the OSM itself
+    number ORAM_CONCURRENCY=1uLL; //number of workers that query one copy of an OSM at the same time, their ORAM requests are batched
+    bool AUTO_SHARDING=false; //the number of OSMs and their capacity are chosen from the number of workers, RAM_BUDGET and NUM_DATAPOINTS
+    number RAM_BUDGET=0uLL; //memory in MB available for the ORAMs of all OSMs (only used if AUTO_SHARDING), 0 means unlimited
+    number PREDICTED_QUERY_TIME=0uLL; //time in ns the OSMs are predicted to need per query for the layout chosen by AUTO_SHARDING
+    bool USE_SPARE_OSM=false; //the next empty OSM is created in the background before the last OSM is full
+    double SPARE_OSM_THRESHOLD=0.75; //share of the capacity of the last OSM after which the next OSM is created (only used if USE_SPARE_OSM)
+    number GROW_LOG_CAPACITY=0uLL; //a full last OSM is grown in place up to this ORAM log capacity before a new OSM is created, 0 means no growth
+    double COMPACTION_FILL_RATIO=0.0; //OSMs holding fewer live data points than this share of their capacity are merged with their neighbours, 0 disables merging underfull OSMs
+    bool USE_SHARD_HANDLES=false; //inserts return handles with the sealed ID of the OSM holding the record, deletes with a handle only access that OSM
+    number SHARD_HANDLE_DUMMIES=1uLL; //number of other OSMs accessed with dummy operations by a delete with a handle (only used if USE_SHARD_HANDLES)
+    number HISTOGRAM_FANOUT=0uLL; //fanout of the hierarchical prefix-count histograms (faster range counts, memory is still linear in the domain), 0 means flat histograms that are scanned completely
+    bool CHECK_HISTOGRAMS=false; //before the querying phase, the histograms are recounted from the records of the OSMs and repaired if they differ
+    bool USE_SUBTREE_AGGREGATES=false; //the nodes store the number of records and the sum of AGGREGATE_COLUMN of their subtrees, COUNT, SUM and MEAN are answered without retrieving records
+    number AGGREGATE_COLUMN=0uLL; //column that is summed up in the subtree aggregates (only used if USE_SUBTREE_AGGREGATES)
+    bool STREAM_RESULTS=false; //COUNT, SUM and MEAN are computed while the records are read from the OSMs, the records are not stored
+
     bool USE_GAMMA=false;
 
     #pragma endregion
@@ -146,12 +176,10 @@ namespace MENHIR{
     vector<number> *INSERTION_MEASUREMENTS;
     vector<number> *DELETION_MEASUREMENTS;
     number INSERTION_TOTAL;
+    number DELETION_TOTAL=0;
+    number QUERYING_TOTAL=0; //runtime of automated_querying in ns, used for the query throughput
     vector<measurement> *QUERY_MEASUREMENTS;
     number NUM_THREADS=1;
     bool DELETION=false;
-    chrono::steady_clock::time_point timestampBeforeORAMs;
-    chrono::steady_clock::time_point timestampAfterORAMs;			 
-    chrono::steady_clock::time_point startTimeQuery;
-    chrono::steady_clock::time_point endTimeQuery;
     #pragma endregion
 }
\ No newline at end of file
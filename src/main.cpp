@@ -57,7 +57,7 @@ int main(int argc, char* argv[])
 			#ifndef SERVERLESS
 			srv.bind("queryServer", &queryServer);
 			srv.bind("stopQueryPhase", &stopQueryPhase); //writesOutput
-			srv.run();
+			runServer();
 			#endif
 			return 0;
 
@@ -79,10 +79,11 @@ int main(int argc, char* argv[])
 
 		#ifndef SERVERLESS
 		srv.bind("receiveDataFromCrowd", &receiveDataFromCrowd);
+		srv.bind("receiveBatchFromCrowd", &receiveBatchFromCrowd);
 		srv.bind("stopCollectionPhase", &stopCollectionPhase);
 		srv.bind("queryServer", &queryServer); 
 		srv.bind("stopQueryPhase", &stopQueryPhase); 
-		srv.run();
+		runServer();
 		#endif
 
 	}
@@ -16,22 +16,50 @@
 /**
  * @brief Construct a new OSMInterface::OSMInterface object based on global variables.
  * First computes how many Oblivious sorted multi map (AVL Trees) are required to store all data. Then generate volume sanitizers. 
- * INPUT_DATA is split and the new OSMs are created in parallel.
+ * INPUT_DATA is split and the new OSMs are created in parallel by the worker pool.
  * 
  */
 OSMInterface::OSMInterface(){
+    this->workers=make_unique<WorkerPool>(WORKER_POOL_SIZE, PIN_WORKERS);
+    if(USE_SHARD_HANDLES){
+        this->handleSealer=make_unique<HandleSealer>();
+    }
+    LOG(INFO, boost::wformat(L"Started %d workers for accessing the OSMs.") %this->workers->size());
+
+    //the noise of the first sanitizers is needed to choose the number of OSMs. 
+    //As the capacity of the OSMs is not known yet, their noise is truncated at the largest OSM the sharding can choose.
+    size_t numGenerated=0;
+    if(AUTO_SHARDING){
+        this->maxPerTree=max(NUM_DATAPOINTS, 1ull);
+        generateVolumeSanitizer();
+        numGenerated=1;
+    }
 
+    //number of data points put into each OSM at the start, only the last OSM may hold less
+    size_t perOSM;
+    if(AUTO_SHARDING){
+        this->numOSMs=chooseSharding();
+        perOSM=ceil((double)NUM_DATAPOINTS/(double)this->numOSMs);
+    }else{
+        perOSM=pow(2,ORAM_LOG_CAPACITY)-1;
+        this->numOSMs=ceil((double)NUM_DATAPOINTS/(double)perOSM );
+    }
     this->maxPerTree=pow(2,ORAM_LOG_CAPACITY)-1;
     LOG_PARAMETER(this->maxPerTree);
-    this->numOSMs=ceil((double)NUM_DATAPOINTS/(double)this->maxPerTree );
     LOG_PARAMETER(this->numOSMs);
+    if(AUTO_SHARDING and USE_TRUNCATED_LAPLACE){
+        //the truncation bound of the first sanitizers differs from the capacity of the OSMs, so they are generated again
+        this->volumeSanitizers.clear();
+        numGenerated=0;
+    }
     this->USE_ORAM=USE_ORAM;
     
-    size_t numGenerate=NUM_ATTRIBUTES;
+    //each call generates one sanitizer per column
+    size_t numGenerate=1;
     if(!USE_GAMMA){
-        numGenerate*=this->numOSMs;
+        numGenerate=this->numOSMs;
     }
-    for(size_t i=0;i<numGenerate;i++){
+    for(size_t i=numGenerated;i<numGenerate;i++){
         LOG(INFO, boost::wformat(L"Generating sanitizers for  %d/%d. (USE GAMMA %d)") %(i+1) %numGenerate %USE_GAMMA);
         generateVolumeSanitizer();
     }    
@@ -43,9 +71,9 @@ OSMInterface::OSMInterface(){
     vector<vector<vector<db_t>>> inputDataSplits;
     for(size_t osmIndex=0;osmIndex<this->numOSMs;osmIndex++){
         LOG(INFO, boost::wformat(L"Creating OSM data split %d/%d.") %(osmIndex+1) %this->numOSMs );       
-        size_t thisNumAtStart=this->maxPerTree;
+        size_t thisNumAtStart=perOSM;
         if(osmIndex==(this->numOSMs-1)){
-            thisNumAtStart=INPUT_DATA.size()%(this->maxPerTree+1);
+            thisNumAtStart=INPUT_DATA.size()%(perOSM+1);
         }        
         int start=end-thisNumAtStart+1;
         LOG(INFO, boost::wformat(L"start %d, end %d, num %d") %start %end %thisNumAtStart);
@@ -58,7 +86,6 @@ OSMInterface::OSMInterface(){
         }
     }
    
-	thread threads[this->numOSMs];	
 	promise<tuple<void*,vector<hist_t>>> promises[this->numOSMs];
 	future<tuple<void*,vector<hist_t>>> futures[this->numOSMs];
     for (size_t osmIndex = 0; osmIndex <this->numOSMs; osmIndex++){
@@ -70,20 +97,16 @@ OSMInterface::OSMInterface(){
             LOG(INFO, boost::wformat(L"Creating LinearOblivDB for OSM  %d/%d with %d datapoints") %(osmIndex+1) %this->numOSMs %thisSize);
         }
         futures[osmIndex] = promises[osmIndex].get_future();
-		threads[osmIndex] = thread(
-			&OSMInterface::createNewTreeWithDataParallel,
-            this,
-            osmIndex,
-            inputSplit,
-            thisSize,
-			&promises[osmIndex]);
+        promise<tuple<void*,vector<hist_t>>> *thisPromise=&promises[osmIndex];
+        this->workers->submit(osmIndex, [this, osmIndex, inputSplit, thisSize, thisPromise](){
+            createNewTreeWithDataParallel(osmIndex, inputSplit, thisSize, thisPromise);
+        });
 	}
 
     for(size_t osmIndex=0; osmIndex<this->numOSMs;osmIndex++){
 		void * ptr;
         vector<hist_t> osmHistos;
         tie(ptr, osmHistos)=futures[osmIndex].get();
-		threads[osmIndex].join();
         if(USE_ORAM){
             DOSM::AVLTree *oblivTree=(DOSM::AVLTree *) ptr;
             this->trees.push_back(oblivTree);
@@ -92,12 +115,157 @@ OSMInterface::OSMInterface(){
             this->lists.push_back(oblivList);
         }
         this->histograms.push_back(osmHistos);
+        this->osmIDs.push_back(this->nextOSMID++);
 
     }
 
+    if(USE_LSM){
+        //the OSMs created from the input data are the oldest levels, new data points are collected in the write buffer
+        createNewBuffer();
+    }
+
+}
+
+/**
+ * @brief Destroy the OSMInterface::OSMInterface object. Waits for the background creation of a spare OSM and for a running merge or rebuild, 
+ * joins their threads and deletes their results, the copies of the OSMs and the OSMs.
+ * 
+ */
+OSMInterface::~OSMInterface(){
+    if(this->sparePending){
+        void *ptr;
+        vector<hist_t> osmHistos;
+        tie(ptr, osmHistos)=this->spareFuture.get();
+        if(USE_ORAM){
+            delete (DOSM::AVLTree *) ptr;
+        }else{
+            delete (LinearDB::LinearOblivDB *) ptr;
+        }
+    }
+    if(this->spareThread.joinable()){
+        this->spareThread.join();
+    }
+    if(this->mergePending){
+        delete get<0>(this->mergeFuture.get());
+    }
+    if(this->mergeThread.joinable()){
+        this->mergeThread.join();
+    }
+
+    dropReplicas();
+    for(size_t i=0;i<this->trees.size();i++){
+        delete this->trees[i];
+    }
+    for(size_t i=0;i<this->lists.size();i++){
+        delete this->lists[i];
+    }
 }
 
 
+/**
+ * @brief Chooses the number of OSMs and their capacity for the AUTO_SHARDING mode and sets ORAM_LOG_CAPACITY accordingly.
+ * For every number of OSMs k, the time the OSMs need for one query is predicted (for a sample of QUERIES if they are known, otherwise for a range of width RANGEQUERY_RANGE):
+ * each OSM visits getMaxHeight() nodes for the descent plus its share of the result and its volume padding. 
+ * With USE_GAMMA, the padding per OSM grows with k as in getNoiseRangeQuery(), otherwise every OSM adds the full noise of its own sanitizers.
+ * Each node access reads and writes a path of ORAM_LOG_CAPACITY+1 buckets; the time per bucket is measured with a small calibration tree.
+ * As the OSMs are processed by the workers in parallel, k OSMs take ceil(k/workers) rounds. 
+ * Layouts whose ORAMs exceed RAM_BUDGET are skipped. The predicted time of the chosen layout is stored in PREDICTED_QUERY_TIME.
+ * Only numbers of OSMs that are reached when the data points are split into OSMs of equal size are considered (e.g. not 6 OSMs for 10 data points).
+ * 
+ * @return size_t : number of OSMs
+ */
+size_t OSMInterface::chooseSharding(){
+    number n=max(NUM_DATAPOINTS, 1ull);
+    number numWorkers=this->workers->size();
+    number blockSize=DOSM::getNumBytesWhenSerialized(COLUMN_FORMAT, VALUE_SIZE);
+
+    //calibration with dummy node accesses on a small tree
+    number calibrationLogCapacity=10;
+    vector<vector<db_t>> emptyData;
+    DOSM::AVLTree calibration(COLUMN_FORMAT, VALUE_SIZE, calibrationLogCapacity, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &emptyData, 0, true, AVL_ONLY);
+    double timePerBucket=calibration.measureAccessTime(64)/(double)(calibrationLogCapacity+1);
+
+    //expected number of records in the result and noise of a query. If the queries are already known, a sample of them is evaluated on INPUT_DATA.
+    //The noise is the mean noise of a node of the sanitizer times the number of nodes covering the range in a tree with fan-out DP_K.
+    vector<tuple<uint,double,double>> ranges; //column, from, to
+    for(size_t q=0;q<QUERIES.size() and q<32;q++){
+        ranges.push_back(make_tuple(QUERIES[q].whereIndex, DBT::toDouble(QUERIES[q].whereFrom), DBT::toDouble(QUERIES[q].whereTo)));
+    }
+    if(ranges.empty()){
+        double from=DBT::toDouble(MIN_VALUE[WHERE_INDEX]);
+        double width=(POINT_QUERIES)? 0.0 : (double) RANGEQUERY_RANGE;
+        ranges.push_back(make_tuple(WHERE_INDEX, from, from+width));
+    }
+    double result=0.0;
+    double noise=0.0;
+    for(auto[column, from, to] : ranges){
+        if(QUERIES.empty()){
+            double domain=DBT::toDouble(MAX_VALUE[column]-MIN_VALUE[column])+DBT::toDouble(DATA_RESOLUTION[column]);
+            result+=(double) n*min((to-from+DBT::toDouble(DATA_RESOLUTION[column]))/domain, 1.0);
+        }else{
+            for(size_t i=0;i<INPUT_DATA.size();i++){
+                double value=DBT::toDouble(INPUT_DATA[i][column]);
+                result+=(value>=from and value<=to)? 1.0 : 0.0;
+            }
+        }
+        const VolumeSanitizer &np=this->volumeSanitizers[column];
+        double meanNoise=np.noises->mean();
+        double domain=DBT::toDouble(MAX_VALUE[column]-MIN_VALUE[column])+DBT::toDouble(DATA_RESOLUTION[column]);
+        double buckets=max((to-from+DBT::toDouble(DATA_RESOLUTION[column]))/domain*np.dp_buckets, 1.0);
+        double nodes=(double) (DP_K-1)*log(buckets)/log((double) max(DP_K, 2ull))+1.0;
+        noise+=meanNoise*nodes;
+    }
+    result=result/(double) ranges.size();
+    noise=noise/(double) ranges.size();
+
+    double budget=(double) RAM_BUDGET*1024.0*1024.0;
+    size_t bestK=0;
+    number bestLogCapacity=0;
+    double bestTime=0.0;
+    double bestMemory=0.0;
+    for(number k=1;k<=max(4*numWorkers, 1ull) and k<=n;k++){
+        number perOSM=(n+k-1)/k;
+        if((n+perOSM-1)/perOSM!=k){
+            continue;
+        }
+        //+1 for the NULL_NODE
+        number logCapacity=max((number) ceil(log2((double) perOSM+2.0)), 3ull);
+        //storage and position map of all ORAMs including the replicas
+        double memory=(double) (k*NUM_REPLICAS)*(double) ((1ull<<logCapacity)*ORAM_Z+ORAM_Z)*(double) (blockSize+2*sizeof(number));
+
+        double perOSMRetrieved;
+        if(USE_GAMMA){
+            perOSMRetrieved=(double) gammaNodes(k, 1.0/(1 << DP_BETA), max((number) ceil(result+noise), 1ull));
+        }else{
+            perOSMRetrieved=result/(double) k+noise;
+        }
+        double accesses=(double) DOSM::AVLTree::getMaxHeight(perOSM)+perOSMRetrieved;
+        double rounds=ceil((double) k/(double) numWorkers);
+        double time=rounds*accesses*(double) (logCapacity+1)*timePerBucket;
+        LOG(DEBUG, boost::wformat(L"Sharding with %d OSMs (log capacity %d, %d MB): predicted %s per query") %k %logCapacity %(number)(memory/1024.0/1024.0) %timeToString((long long) time));
+
+        //layouts within the budget are preferred, otherwise the one with the least memory is taken
+        bool fits=(RAM_BUDGET==0 or memory<=budget);
+        bool bestFits=(RAM_BUDGET==0 or bestMemory<=budget);
+        bool better=(bestK==0) or (fits and not bestFits) or (fits and bestFits and time<bestTime) or (not fits and not bestFits and memory<bestMemory);
+        if(better){
+            bestK=k;
+            bestLogCapacity=logCapacity;
+            bestTime=time;
+            bestMemory=memory;
+        }
+    }
+    if(RAM_BUDGET>0 and bestMemory>budget){
+        LOG(WARNING, boost::wformat(L"No layout of the OSMs fits into the RAM budget of %d MB. Using the smallest one (%d MB).") %RAM_BUDGET %(number)(bestMemory/1024.0/1024.0));
+    }
+
+    ORAM_LOG_CAPACITY=bestLogCapacity;
+    PREDICTED_QUERY_TIME=(number) bestTime;
+    LOG(INFO, boost::wformat(L"Auto sharding: %d OSMs with log capacity %d for %d datapoints and %d workers, predicted %s per query in the OSMs.") 
+                %bestK %bestLogCapacity %n %numWorkers %timeToString((long long) bestTime));
+    return bestK;
+}
+
 /**
  * @brief Creates  a new Oblivious Sorted Multi-map ("OSM",AVL Trees) using a given data. 
  * Additionally, this function creates a histogram for each attribute over the domain from the given data. Ths is later used for volume sanitation. 
@@ -112,16 +280,12 @@ void OSMInterface::createNewTreeWithDataParallel(size_t osmIndex, vector<vector<
 
     vector<hist_t> osmHistos=createNewHistogram();
     for(size_t j=0;j<thisSize;j++){
-        vector<db_t> element=inputSplit[j];
-        for(size_t att=0;att<NUM_ATTRIBUTES;att++){
-            size_t histoIndex=(size_t) abs(DBT::toDouble(element[att])-DBT::toDouble(MIN_VALUE[att]))/DBT::toDouble(DATA_RESOLUTION[att]);
-            osmHistos[att][histoIndex].second+=1ull;
-        }
+        addToHistograms(&osmHistos, inputSplit[j], 1ull, false);
     }
 
     void * ptr;
     if(USE_ORAM){
-        DOSM::AVLTree *oblivTree=new DOSM::AVLTree(COLUMN_FORMAT, VALUE_SIZE, ORAM_LOG_CAPACITY, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &inputSplit, thisSize, USE_ORAM);
+        DOSM::AVLTree *oblivTree=new DOSM::AVLTree(COLUMN_FORMAT, VALUE_SIZE, ORAM_LOG_CAPACITY, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &inputSplit, thisSize, USE_ORAM, INDEX_MODE);
         ptr=(void *) oblivTree;
     }else{
         LinearDB::LinearOblivDB *oblivList=new LinearDB::LinearOblivDB(COLUMN_FORMAT,&inputSplit, thisSize);
@@ -138,7 +302,7 @@ void OSMInterface::createNewTreeWithDataParallel(size_t osmIndex, vector<vector<
 void OSMInterface::createNewTree(){
     if(USE_ORAM){
         vector<vector<db_t>> emptyVec;
-        DOSM::AVLTree *oblivTree=new DOSM::AVLTree(COLUMN_FORMAT, VALUE_SIZE, ORAM_LOG_CAPACITY, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &emptyVec, 0, USE_ORAM);
+        DOSM::AVLTree *oblivTree=new DOSM::AVLTree(COLUMN_FORMAT, VALUE_SIZE, ORAM_LOG_CAPACITY, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &emptyVec, 0, USE_ORAM, INDEX_MODE);
         this->trees.push_back(oblivTree);
     }else{
 		LinearDB::LinearOblivDB* oblivList=new LinearDB::LinearOblivDB(COLUMN_FORMAT);
@@ -147,7 +311,8 @@ void OSMInterface::createNewTree(){
 }
 
 /**
- * @brief Creates a new histogram data structure without any data.
+ * @brief Creates a new histogram data structure without any data. Both layouts have one bucket per DATA_RESOLUTION step of the domain, 
+ * so their memory is linear in the domain size.
  * 
  * @return vector<hist_t> 
  */
@@ -156,9 +321,32 @@ vector<hist_t> OSMInterface::createNewHistogram(){
     for(size_t i=0;i<NUM_ATTRIBUTES;i++){
         hist_t thisHisto;
         size_t numBuckets=(size_t)ceil((DBT::toDouble(MAX_VALUE[i])-DBT::toDouble(MIN_VALUE[i])+1.0)/DBT::toDouble(DATA_RESOLUTION[i]));
+        thisHisto.numBuckets=numBuckets;
+        thisHisto.minValue=DBT::toDouble(MIN_VALUE[i]);
+        thisHisto.resolution=DBT::toDouble(DATA_RESOLUTION[i]);
+        if(HISTOGRAM_FANOUT>1){
+            //one bucket more than the domain so that countBelow() is defined for all bucket indices up to numBuckets
+            //every level is padded to a multiple of the fanout, the top level consists of one group of siblings
+            thisHisto.fanout=HISTOGRAM_FANOUT;
+            thisHisto.levelOffsets.push_back(0);
+            number levelSize=numBuckets+1;
+            while(true){
+                number padded=((levelSize+HISTOGRAM_FANOUT-1)/HISTOGRAM_FANOUT)*HISTOGRAM_FANOUT;
+                thisHisto.levelOffsets.push_back(thisHisto.levelOffsets.back()+padded);
+                if(padded==HISTOGRAM_FANOUT){
+                    break;
+                }
+                levelSize=padded/HISTOGRAM_FANOUT;
+            }
+            thisHisto.counts.assign(thisHisto.levelOffsets.back(), 0ull);
+            histsForNewOSM.push_back(thisHisto);
+            continue;
+        }
+        thisHisto.values.reserve(numBuckets);
+        thisHisto.counts.assign(numBuckets, 0ull);
         db_t val=MIN_VALUE[i];
         for(size_t j=0;j<numBuckets;j++){
-            thisHisto.push_back(make_pair(val,0ull));
+            thisHisto.values.push_back(DBT::toDouble(val));
             val=val+DATA_RESOLUTION[i];
 
         }
@@ -167,6 +355,97 @@ vector<hist_t> OSMInterface::createNewHistogram(){
     return histsForNewOSM;
 }
 
+/**
+ * @brief Counts a data point in the histograms of an OSM. Keys outside of the domain (e.g. of the NULL node) are counted in the closest bucket.
+ * The counters are updated with masked additions instead of writing one counter: flat histograms add the masked weight to every bucket, 
+ * hierarchical histograms add it to all fanout siblings of the ancestor of the bucket on every level (as countBelow() reads them). 
+ * For flat histograms, the accessed counters are thus independent of the keys, so a dummy update (weight 0) looks like a real one. 
+ * For hierarchical histograms, only the group of siblings on each level depends on the keys.
+ * Histograms that are counted from all records of an OSM (creation, merges, checkHistograms()) only add to the counters of the bucket, 
+ * like the bulk construction of the OSMs their access pattern depends on the data anyway.
+ * 
+ * @param osmHistos : histograms of the OSM, one per column
+ * @param keys : the keys of the data point
+ * @param weight : added to the counters, 0ull-1ull removes a data point that was counted before
+ * @param masked : if false, only the counters of the bucket are updated
+ */
+void OSMInterface::addToHistograms(vector<hist_t> *osmHistos, vector<db_t> keys, number weight, bool masked){
+    for(size_t att=0;att<NUM_ATTRIBUTES;att++){
+        hist_t *histogram=&(*osmHistos)[att];
+        size_t histoIndex=(size_t) abs(DBT::toDouble(keys[att])-DBT::toDouble(MIN_VALUE[att]))/DBT::toDouble(DATA_RESOLUTION[att]);
+        histoIndex=min(histoIndex, (size_t) histogram->numBuckets-1);
+        if(histogram->fanout==0 and not masked){
+            histogram->counts[histoIndex]+=weight;
+            continue;
+        }
+        if(histogram->fanout==0){
+            number *counts=histogram->counts.data();
+            size_t numBuckets=histogram->size();
+            #pragma omp simd
+            for(size_t i=0;i<numBuckets;i++){
+                number isBucket=(number) (i==histoIndex);
+                counts[i]+=weight & (0ull-isBucket);
+            }
+            continue;
+        }
+        for(size_t level=0;level+1<histogram->levelOffsets.size();level++){
+            if(not masked){
+                histogram->counts[histogram->levelOffsets[level]+histoIndex]+=weight;
+                histoIndex/=histogram->fanout;
+                continue;
+            }
+            number *siblings=histogram->counts.data()+histogram->levelOffsets[level]+(histoIndex-histoIndex%histogram->fanout);
+            number position=histoIndex%histogram->fanout;
+            for(size_t i=0;i<histogram->fanout;i++){
+                number isNode=(number) (i==position);
+                siblings[i]+=weight & (0ull-isNode);
+            }
+            histoIndex/=histogram->fanout;
+        }
+    }
+}
+
+/**
+ * @brief Recounts the histograms of every OSM from its records (AVLTree::exportRecords) and compares them with the histograms maintained by inserts and deletes.
+ * Records marked as deleted are not counted. Only available with ORAMs.
+ * 
+ * @param repair : if true, histograms that differ are replaced by the recounted ones
+ * @return number : number of OSMs whose histograms differ
+ */
+number OSMInterface::checkHistograms(bool repair){
+    if(not USE_ORAM){
+        return 0;
+    }
+    endQuerying();
+    installMerge(true);
+    number inconsistent=0;
+    for(size_t i=0;i<this->numOSMs;i++){
+        vector<hist_t> recounted=createNewHistogram();
+        vector<DOSM::RankRecord> records;
+        this->workers->submit(i, [&](){
+            records=this->trees[i]->exportRecords();
+        }).get();
+        for(size_t j=0;j<records.size();j++){
+            if(records[j].valid){
+                addToHistograms(&recounted, records[j].keys, 1ull, false);
+            }
+        }
+        bool same=true;
+        for(size_t att=0;att<NUM_ATTRIBUTES;att++){
+            same=same and (recounted[att].counts==this->histograms[i][att].counts);
+        }
+        if(same){
+            continue;
+        }
+        inconsistent++;
+        LOG(WARNING, boost::wformat(L"The histograms of OSM %d do not match its records.") %i);
+        if(repair){
+            this->histograms[i]=recounted;
+        }
+    }
+    return inconsistent;
+}
+
 /**
  * @brief Inserts a new data point into the database (without providing a value). 
  * The new data point is inserted into the last OSM. The corresponding histogram is updated accordingly.
@@ -175,21 +454,102 @@ vector<hist_t> OSMInterface::createNewHistogram(){
  * @return size_t : Hash of the corresponding entry.
  */
 size_t OSMInterface::insert(vector<db_t> key){
-    if(this->trees.back()->size()==maxPerTree){
-        createNewTree();
-        vector<hist_t> osmHistos =createNewHistogram();
-        this->histograms.push_back(osmHistos);
-        this->numOSMs=this->numOSMs+1;
-    }
+    prepareLastOSM();
     size_t hash=0;
-    if(USE_ORAM){   
-        hash=this->trees.back()->insert(key);
-    }else{
-        hash=this->lists.back()->insert(key);
-    }
+    this->workers->submit(this->numOSMs-1, [&](){
+        if(USE_ORAM){   
+            hash=this->trees.back()->insert(key);
+        }else{
+            hash=this->lists.back()->insert(key);
+        }
+    }).get();
+    addToHistograms(&this->histograms.back(), key);
     return hash;
 }
 
+/**
+ * @brief Inserts a batch of data points into the database. The batch is split so that no OSM exceeds its capacity (or the write buffer LSM_BUFFER_SIZE); 
+ * each part is inserted with one call to AVLTree::insertBatch.
+ * 
+ * @param keys : data points to be inserted
+ * @param insertedInto : if not nullptr, the IDs of the OSMs the entries were inserted into are appended in the order of keys
+ * @return vector<size_t> : Hashes of the corresponding entries in the order of keys.
+ */
+vector<size_t> OSMInterface::insertBatch(vector<vector<db_t>> keys, vector<number> *insertedInto){
+    vector<size_t> hashes;
+    size_t done=0;
+    while(done<keys.size()){
+        prepareLastOSM();
+        size_t capacity=(USE_LSM)? LSM_BUFFER_SIZE : this->trees.back()->getCapacity();
+        size_t free=capacity-this->trees.back()->size();
+        size_t num=min(free, keys.size()-done);
+        vector<vector<db_t>> part(keys.begin()+done, keys.begin()+done+num);
+
+        this->workers->submit(this->numOSMs-1, [&](){
+            if(USE_ORAM){
+                vector<size_t> partHashes=this->trees.back()->insertBatch(part);
+                hashes.insert(hashes.end(), partHashes.begin(), partHashes.end());
+            }else{
+                for (size_t i = 0; i < part.size(); i++){
+                    hashes.push_back(this->lists.back()->insert(part[i]));
+                }
+            }
+        }).get();
+        for(size_t i=0;i<part.size();i++){
+            addToHistograms(&this->histograms.back(), part[i]);
+        }
+        if(insertedInto!=nullptr){
+            insertedInto->insert(insertedInto->end(), num, this->osmIDs.back());
+        }
+        done+=num;
+        prepareSpareOSM();
+    }
+    return hashes;
+}
+
+/**
+ * @brief Inserts a new data point like insert() and returns a handle that also contains the (sealed) ID of the OSM holding it. 
+ * Requires USE_SHARD_HANDLES.
+ * 
+ * @param key : data point to be inserted
+ * @return RecordHandle : handle to be passed to deleteEntry()
+ */
+RecordHandle OSMInterface::insertWithHandle(vector<db_t> key){
+    size_t hash=insert(key);
+    return this->handleSealer->seal(this->osmIDs.back(), hash);
+}
+
+/**
+ * @brief Inserts a batch of data points like insertBatch() and returns a handle for each of them. Requires USE_SHARD_HANDLES.
+ * 
+ * @param keys : data points to be inserted
+ * @return vector<RecordHandle> : handles in the order of keys
+ */
+vector<RecordHandle> OSMInterface::insertBatchWithHandles(vector<vector<db_t>> keys){
+    vector<number> insertedInto;
+    vector<size_t> hashes=insertBatch(keys, &insertedInto);
+    vector<RecordHandle> handles;
+    handles.reserve(hashes.size());
+    for(size_t i=0;i<hashes.size();i++){
+        handles.push_back(this->handleSealer->seal(insertedInto[i], hashes[i]));
+    }
+    return handles;
+}
+
+/**
+ * @brief Current index of the OSM with the passed ID. OSMs that were merged are replaced by the OSM they were merged into.
+ * 
+ * @param osmID 
+ * @return size_t 
+ */
+size_t OSMInterface::resolveOSM(number osmID){
+    while(this->mergedInto.count(osmID)>0){
+        osmID=this->mergedInto[osmID];
+    }
+    auto position=find(this->osmIDs.begin(), this->osmIDs.end(), osmID);
+    return position-this->osmIDs.begin();
+}
+
 #ifndef NDEBUG
 /**
  * @brief Inserts a new data point into the database (without providing a value). The hash is already fixed.
@@ -201,36 +561,740 @@ size_t OSMInterface::insert(vector<db_t> key){
  */
 void OSMInterface::insert(vector<db_t> key, size_t nodeHash){
 
-    if(this->trees.back()->size()==maxPerTree){
-        createNewTree();
-        createNewHistogram();
-        this->numOSMs=this->numOSMs+1;       
-    }
-    if(USE_ORAM){   
-        this->trees.back()->insert(key,nodeHash);
-    }else{
-        this->lists.back()->insert(key,nodeHash);
-    }
+    prepareLastOSM();
+    this->workers->submit(this->numOSMs-1, [&](){
+        if(USE_ORAM){   
+            this->trees.back()->insert(key,nodeHash);
+        }else{
+            this->lists.back()->insert(key,nodeHash);
+        }
+    }).get();
+    addToHistograms(&this->histograms.back(), key);
 }
 #endif
 
 /**
- * @brief Delete entry from the database. For this purpose, for each OSM the delete operation is called. Only in one OSM actually data is deleted, in the others dummy operations are conducted.
+ * @brief Delete entry from the database. For this purpose, for each OSM the delete operation is called by its worker in parallel. Only in one OSM actually data is deleted, in the others dummy operations are conducted.
+ * 
+ * In tombstone mode, the entry is only marked as deleted in each OSM and OSMs with too many marked entries are rebuilt in the background.
+ * If COMPACTION_FILL_RATIO is set, underfull OSMs are merged with their neighbours in the background afterwards (startCompaction()).
+ * 
+ * With USE_SHARD_HANDLES, the overload taking a RecordHandle only accesses the OSM holding the entry.
  * 
- * TODO: Also delete from Histograms! Maybe store information about which OSM was used in the hash.
+ * The histograms of every accessed OSM are updated with the keys of the node it deleted, the OSMs without a matching node execute a dummy update with weight 0 (see addToHistograms()).
  * @param key : Key in the passed column of the node to be deleted
  * @param nodeHash : Hash of the node to be deleted
  * @param column : column for the key 
  */
 void OSMInterface::deleteEntry(db_t key, size_t nodeHash, ulong column){
-    #pragma omp for
+    endQuerying();
+    installMerge(false);
+    vector<future<void>> done;
+    vector<uchar> found(this->numOSMs);
+    vector<vector<db_t>> removedKeys(this->numOSMs);
+    for(size_t i=0;i<this->numOSMs;i++){
+        done.push_back(this->workers->submit(i, [this, i, key, nodeHash, column, &found, &removedKeys](){
+            if(USE_TOMBSTONES){
+                found[i]=this->trees[i]->markDeleted(key,nodeHash,column,&removedKeys[i]);
+            }else{
+                found[i]=this->trees[i]->deleteEntry(key,nodeHash,column,&removedKeys[i]);
+            }
+        }));
+    }
+    for(size_t i=0;i<done.size();i++){
+        done[i].get();
+    }
+    for(size_t i=0;i<this->numOSMs;i++){
+        addToHistograms(&this->histograms[i], removedKeys[i], 0ull-(number) found[i]);
+    }
+    //the records of a running merge were already exported, so the delete is repeated on its result
+    if(this->mergePending){
+        this->deletesDuringMerge.push_back(make_tuple(key,nodeHash,column));
+    }
+    startCompaction();
+}
+
+/**
+ * @brief Delete entry from the database using the handle returned by insertWithHandle(). Only the OSM holding the entry and SHARD_HANDLE_DUMMIES 
+ * randomly chosen other OSMs are accessed, so the cost of a delete does not grow with the number of OSMs. 
+ * The other OSMs execute the same (dummy) delete operations, so the host cannot tell which of the accessed OSMs held the entry.
+ * Handles that fail authentication are rejected without accessing any OSM.
+ * 
+ * @param key : Key in the passed column of the node to be deleted
+ * @param handle : Handle of the node to be deleted
+ * @param column : column for the key 
+ */
+void OSMInterface::deleteEntry(db_t key, RecordHandle handle, ulong column){
+    auto[valid, osmID]=this->handleSealer->open(handle);
+    if(not valid){
+        LOG(ERROR, L"Rejected a delete with an invalid record handle.");
+        return;
+    }
+    endQuerying();
+    installMerge(false);
+    size_t owner=resolveOSM(osmID);
+    if(owner>=this->numOSMs){
+        LOG(ERROR, L"The OSM of a record handle does not exist anymore.");
+        return;
+    }
+
+    vector<size_t> others;
     for(size_t i=0;i<this->numOSMs;i++){
-        this->trees[i]->deleteEntry(key,nodeHash,column);
+        if(i!=owner){
+            others.push_back(i);
+        }
+    }
+    shuffle(others.begin(), others.end(), GENERATOR);
+    vector<size_t> accessed(others.begin(), others.begin()+min((size_t) SHARD_HANDLE_DUMMIES, others.size()));
+    accessed.push_back(owner);
+    sort(accessed.begin(), accessed.end());
+
+    size_t nodeHash=handle.nodeHash;
+    vector<future<void>> done;
+    vector<uchar> found(this->numOSMs);
+    vector<vector<db_t>> removedKeys(this->numOSMs);
+    for(size_t i : accessed){
+        done.push_back(this->workers->submit(i, [this, i, key, nodeHash, column, &found, &removedKeys](){
+            if(USE_TOMBSTONES){
+                found[i]=this->trees[i]->markDeleted(key,nodeHash,column,&removedKeys[i]);
+            }else{
+                found[i]=this->trees[i]->deleteEntry(key,nodeHash,column,&removedKeys[i]);
+            }
+        }));
+    }
+    for(size_t i=0;i<done.size();i++){
+        done[i].get();
+    }
+    for(size_t i : accessed){
+        addToHistograms(&this->histograms[i], removedKeys[i], 0ull-(number) found[i]);
     }
+    if(this->mergePending){
+        this->deletesDuringMerge.push_back(make_tuple(key,nodeHash,column));
+    }
+    startCompaction();
 }  
 
+/**
+ * @brief Ensures that a new data point can be inserted into the last OSM. 
+ * If the last OSM is full, it is grown up to GROW_LOG_CAPACITY (growLastOSM()). Afterwards, a new OSM is created or the OSM prepared by prepareSpareOSM() is appended. In LSM mode, a full write buffer is merged instead and finished merges are installed.
+ * 
+ */
+void OSMInterface::prepareLastOSM(){
+    //the copies of the querying phase are read-only
+    endQuerying();
+    //a running compaction of the last OSM has to be installed before inserting into it
+    installMerge(this->mergePending and this->mergeLast==this->numOSMs-1);
+    if(USE_LSM){
+        if(this->trees.back()->size()>=LSM_BUFFER_SIZE){
+            flushBuffer();
+        }
+        return;
+    }
+    if(this->numOSMs>0 and this->trees.back()->size()>=this->trees.back()->getCapacity() and this->trees.back()->getORAMLogCapacity()<GROW_LOG_CAPACITY){
+        growLastOSM();
+    }
+    if(this->numOSMs==0 or this->trees.back()->size()>=this->trees.back()->getCapacity()){
+        if(this->sparePending){
+            installSpareOSM();
+        }else{
+            createNewTree();
+            vector<hist_t> osmHistos =createNewHistogram();
+            this->histograms.push_back(osmHistos);
+            this->osmIDs.push_back(this->nextOSMID++);
+        }
+        this->numOSMs=this->numOSMs+1;
+        ensureVolumeSanitizers();
+    }
+    prepareSpareOSM();
+}
+
+/**
+ * @brief Adds a level to the ORAM of the last OSM, which doubles its capacity (AVLTree::growORAM). 
+ * Each additional OSM adds its own padding to every query, so growing the last OSM keeps the number of OSMs small.
+ * Growing only changes the position map and appends empty buckets, the data points are moved to the new level lazily when they are accessed.
+ * 
+ */
+void OSMInterface::growLastOSM(){
+    DOSM::AVLTree *last=this->trees.back();
+    this->workers->submit(this->numOSMs-1, [last](){
+        last->growORAM();
+    }).get();
+    this->maxPerTree=max(this->maxPerTree, (size_t) last->getCapacity());
+    LOG(INFO, boost::wformat(L"Grew OSM %d to %d datapoints (log capacity %d).") %this->numOSMs %last->getCapacity() %last->getORAMLogCapacity());
+}
+
+/**
+ * @brief Starts creating the next OSM in the background if the last OSM holds at least SPARE_OSM_THRESHOLD times its capacity and cannot grow any further. 
+ * Creating an empty OSM initializes the whole ORAM and its position map, which otherwise delays the insert that fills the last OSM. 
+ * Not used in LSM mode, where the write buffers are small.
+ * 
+ */
+void OSMInterface::prepareSpareOSM(){
+    if(not USE_SPARE_OSM or USE_LSM or this->sparePending or this->numOSMs==0){
+        return;
+    }
+    if(this->trees.back()->getORAMLogCapacity()<GROW_LOG_CAPACITY){
+        return;
+    }
+    if((double) this->trees.back()->size()<SPARE_OSM_THRESHOLD*(double) this->trees.back()->getCapacity()){
+        return;
+    }
+    LOG(DEBUG, boost::wformat(L"Creating OSM %d in the background.") %(this->numOSMs+1));
+    this->sparePending=true;
+    this->sparePromise=promise<tuple<void *,vector<hist_t>>>();
+    this->spareFuture=this->sparePromise.get_future();
+    this->spareThread=thread(
+        &OSMInterface::createSpareOSMParallel,
+        this,
+        ORAM_LOG_CAPACITY,
+        &this->sparePromise);
+}
+
+/**
+ * @brief Creates an empty OSM and its histograms. This function is run in a separate thread by prepareSpareOSM().
+ * 
+ * @param logCapacity : log capacity of the ORAM of the new OSM
+ * @param promise : after execution this contains a pointer to the OSM and the histograms
+ */
+void OSMInterface::createSpareOSMParallel(number logCapacity, promise<tuple<void *,vector<hist_t>>> *promise){
+    void *ptr;
+    if(USE_ORAM){
+        vector<vector<db_t>> emptyVec;
+        ptr=new DOSM::AVLTree(COLUMN_FORMAT, VALUE_SIZE, logCapacity, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &emptyVec, 0, USE_ORAM, INDEX_MODE);
+    }else{
+        ptr=new LinearDB::LinearOblivDB(COLUMN_FORMAT);
+    }
+    promise->set_value(make_tuple(ptr, createNewHistogram()));
+}
+
+/**
+ * @brief Appends the OSM created by prepareSpareOSM() as last OSM. Waits if it is not finished yet.
+ * 
+ */
+void OSMInterface::installSpareOSM(){
+    void *ptr;
+    vector<hist_t> osmHistos;
+    tie(ptr, osmHistos)=this->spareFuture.get();
+    this->spareThread.join();
+    this->sparePending=false;
+    if(USE_ORAM){
+        this->trees.push_back((DOSM::AVLTree *) ptr);
+    }else{
+        this->lists.push_back((LinearDB::LinearOblivDB *) ptr);
+    }
+    this->histograms.push_back(osmHistos);
+    this->osmIDs.push_back(this->nextOSMID++);
+}
+
+/**
+ * @brief Creates a new empty write buffer for the LSM mode and appends it as last OSM. 
+ * The buffer is a small AVLTree, so inserts only pay for paths of length log(LSM_BUFFER_SIZE).
+ * 
+ */
+void OSMInterface::createNewBuffer(){
+    DOSM::AVLTree *buffer=new DOSM::AVLTree(COLUMN_FORMAT, VALUE_SIZE, LSM_BUFFER_SIZE, ORAM_Z, STASH_FACTOR, BATCH_SIZE, USE_ORAM, INDEX_MODE);
+    this->trees.push_back(buffer);
+    vector<hist_t> osmHistos =createNewHistogram();
+    this->histograms.push_back(osmHistos);
+    this->osmIDs.push_back(this->nextOSMID++);
+    this->numOSMs=this->numOSMs+1;
+    ensureVolumeSanitizers();
+}
+
+/**
+ * @brief Merges the full write buffer in the background. The buffer is merged together with the newest OSMs as long as each of them holds 
+ * at most LSM_SIZE_RATIO times as many records as the records merged so far (and the result fits into maxPerTree). 
+ * The records are exported here, the bulk construction of the new OSM runs in a separate thread. Until the merge is installed, 
+ * the old OSMs stay in place and are queried as before. New data points go into a new write buffer.
+ * 
+ */
+void OSMInterface::flushBuffer(){
+    //only one merge runs at a time
+    installMerge(true);
+
+    size_t last=this->numOSMs-1;
+    size_t first=last;
+    number merged=this->trees[last]->size();
+    while(first>0){
+        number olderSize=this->trees[first-1]->size();
+        if(olderSize>LSM_SIZE_RATIO*merged or olderSize+merged>maxPerTree){
+            break;
+        }
+        merged+=olderSize;
+        first--;
+    }
+
+    vector<DOSM::RankRecord> records=exportOSMs(first, last);
+    LOG(INFO, boost::wformat(L"Merging OSMs %d-%d (%d datapoints) in the background.") %first %last %merged);
+    startMerge(first, last, records, 0ull);
+
+    createNewBuffer();
+}
+
+/**
+ * @brief Exports the records of the OSMs first to last (AVLTree::exportRecords) in the order of the OSMs. 
+ * The records are exported by the worker of each OSM, as each ORAM is only accessed from one thread.
+ * 
+ * @param first : index of the first OSM
+ * @param last : index of the last OSM
+ * @return vector<DOSM::RankRecord> 
+ */
+vector<DOSM::RankRecord> OSMInterface::exportOSMs(size_t first, size_t last){
+    vector<vector<DOSM::RankRecord>> osmRecords(last-first+1);
+    vector<future<void>> exported;
+    for(size_t i=first;i<=last;i++){
+        exported.push_back(this->workers->submit(getWorkerIndex(i,0), [this, i, first, &osmRecords](){
+            osmRecords[i-first]=this->trees[i]->exportRecords();
+        }));
+    }
+    for(size_t i=0;i<exported.size();i++){
+        exported[i].get();
+    }
+
+    vector<DOSM::RankRecord> records;
+    for(size_t i=0;i<osmRecords.size();i++){
+        records.insert(records.end(), osmRecords[i].begin(), osmRecords[i].end());
+    }
+    return records;
+}
+
+/**
+ * @brief Starts building the OSM that replaces the OSMs first to last in a separate thread (mergeOSMsParallel). 
+ * Until installMerge() is called, the old OSMs stay in place and are queried as before.
+ * 
+ * @param first : index of the first OSM that is replaced
+ * @param last : index of the last OSM that is replaced
+ * @param records : records exported from the OSMs first to last
+ * @param minLogCapacity : lower bound for the log capacity of the new ORAM
+ */
+void OSMInterface::startMerge(size_t first, size_t last, vector<DOSM::RankRecord> records, number minLogCapacity){
+    this->mergeFirst=first;
+    this->mergeLast=last;
+    this->mergePending=true;
+    this->mergePromise=promise<tuple<DOSM::AVLTree *, vector<hist_t>>>();
+    this->mergeFuture=this->mergePromise.get_future();
+    this->mergeThread=thread(
+        &OSMInterface::mergeOSMsParallel,
+        this,
+        records,
+        minLogCapacity,
+        &this->mergePromise);
+}
+
+/**
+ * @brief Builds a new OSM from the passed records with the non-oblivious bulk construction (createTreeStructureNonObliv and ORAM::load). 
+ * The hashes of the records are kept, records marked as deleted are dropped. This function is run in a separate thread by startMerge().
+ * The histograms of the new OSM are counted from the remaining records, so records deleted from the old OSMs are no longer included.
+ * 
+ * @param records : records of all OSMs that are merged
+ * @param minLogCapacity : lower bound for the log capacity of the new ORAM, e.g. if further data points are inserted into the new OSM
+ * @param promise : after execution this contains a pointer to the new OSM and its histograms
+ */
+void OSMInterface::mergeOSMsParallel(vector<DOSM::RankRecord> records, number minLogCapacity, promise<tuple<DOSM::AVLTree *, vector<hist_t>>> *promise){
+    vector<hist_t> osmHistos=createNewHistogram();
+    for(size_t j=0;j<records.size();j++){
+        if(not records[j].valid){
+            continue;
+        }
+        addToHistograms(&osmHistos, records[j].keys, 1ull, false);
+    }
+    promise->set_value(make_tuple(buildTreeFromRecords(records, minLogCapacity), osmHistos));
+}
+
+/**
+ * @brief Builds a new OSM from the passed records with the non-oblivious bulk construction. The hashes of the records are kept, records marked as deleted are dropped. 
+ * As the ORAM is newly loaded, the positions of all blocks are independent of the ORAMs the records were exported from.
+ * 
+ * @param records : records exported from one or multiple OSMs
+ * @param minLogCapacity : lower bound for the log capacity of the new ORAM
+ * @return DOSM::AVLTree* 
+ */
+DOSM::AVLTree *OSMInterface::buildTreeFromRecords(vector<DOSM::RankRecord> records, number minLogCapacity){
+    vector<vector<db_t>> inputData;
+    vector<size_t> nodeHashes;
+    inputData.reserve(records.size());
+    nodeHashes.reserve(records.size());
+    for(size_t i=0;i<records.size();i++){
+        if(not records[i].valid){
+            continue;
+        }
+        inputData.push_back(records[i].keys);
+        nodeHashes.push_back(records[i].nodeHash);
+    }
+    size_t num=inputData.size();
+    //+1 for the NULL_NODE
+    number logCapacity=max({(number) ceil(log2((double) num+2.0)), 3ull, minLogCapacity});
+    return new DOSM::AVLTree(COLUMN_FORMAT, VALUE_SIZE, logCapacity, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &inputData, num, USE_ORAM, INDEX_MODE, &nodeHashes);
+}
+
+/**
+ * @brief Replaces the merged OSMs by the result of the running merge and their histograms by the histograms counted from the merged records. 
+ * Without USE_GAMMA, the volume sanitizers of the removed OSMs are dropped as well, so there is still one sanitizer per OSM and column.
+ * Deletes that arrived while the merge was running are repeated on the new OSM (marked in tombstone mode, removed otherwise), so deletes never wait for a merge.
+ * 
+ * @param wait : if true, waits for the merge to finish. Otherwise the merge is only installed if it is already finished.
+ */
+void OSMInterface::installMerge(bool wait){
+    if(not this->mergePending){
+        return;
+    }
+    if(not wait and this->mergeFuture.wait_for(chrono::seconds(0))!=future_status::ready){
+        return;
+    }
+    DOSM::AVLTree *mergedTree;
+    vector<hist_t> mergedHistos;
+    tie(mergedTree, mergedHistos)=this->mergeFuture.get();
+    this->mergeThread.join();
+
+    for(size_t i=this->mergeFirst;i<=this->mergeLast;i++){
+        delete this->trees[i];
+    }
+    this->trees.erase(this->trees.begin()+this->mergeFirst, this->trees.begin()+this->mergeLast+1);
+    this->trees.insert(this->trees.begin()+this->mergeFirst, mergedTree);
+    this->histograms.erase(this->histograms.begin()+this->mergeFirst, this->histograms.begin()+this->mergeLast+1);
+    this->histograms.insert(this->histograms.begin()+this->mergeFirst, mergedHistos);
+    //handles of records in the merged OSMs are forwarded to the new OSM
+    for(size_t i=this->mergeFirst;i<=this->mergeLast;i++){
+        this->mergedInto[this->osmIDs[i]]=this->nextOSMID;
+    }
+    this->osmIDs.erase(this->osmIDs.begin()+this->mergeFirst, this->osmIDs.begin()+this->mergeLast+1);
+    this->osmIDs.insert(this->osmIDs.begin()+this->mergeFirst, this->nextOSMID++);
+    this->numOSMs=this->trees.size();
+    if(not USE_GAMMA and this->volumeSanitizers.size()>this->numOSMs*NUM_ATTRIBUTES){
+        size_t removed=min((this->mergeLast-this->mergeFirst)*NUM_ATTRIBUTES, this->volumeSanitizers.size()-this->numOSMs*NUM_ATTRIBUTES);
+        auto begin=this->volumeSanitizers.begin()+(this->mergeFirst+1)*NUM_ATTRIBUTES;
+        this->volumeSanitizers.erase(begin, begin+removed);
+    }
+    this->mergePending=false;
+    for(size_t i=0;i<this->deletesDuringMerge.size();i++){
+        auto[key,nodeHash,column]=this->deletesDuringMerge[i];
+        vector<db_t> removedKeys;
+        bool found;
+        if(USE_TOMBSTONES){
+            found=mergedTree->markDeleted(key,nodeHash,column,&removedKeys);
+        }else{
+            found=mergedTree->deleteEntry(key,nodeHash,column,&removedKeys);
+        }
+        addToHistograms(&this->histograms[this->mergeFirst], removedKeys, 0ull-(number) found);
+    }
+    this->deletesDuringMerge.clear();
+    LOG(INFO, boost::wformat(L"Installed merged OSM with %d datapoints. Number of OSMs: %d") %mergedTree->size() %this->numOSMs);
+}
+
+/**
+ * @brief Starts rebuilding the oldest OSM in which at least TOMBSTONE_RATIO of the records are marked as deleted. 
+ * Only one rebuild or merge runs at a time. The rebuild uses the same background bulk construction as the merges of the LSM mode, 
+ * the marked records are dropped. The write buffer of the LSM mode is not rebuilt as it is merged anyway.
+ * If no OSM has to be rebuilt and COMPACTION_FILL_RATIO is set, underfull OSMs are merged instead (startUnderfullMerge()).
+ * 
+ */
+void OSMInterface::startCompaction(){
+    if(this->mergePending){
+        return;
+    }
+    size_t numCandidates=(USE_LSM)? this->numOSMs-1 : this->numOSMs;
+    for(size_t i=0;i<numCandidates and USE_TOMBSTONES;i++){
+        number tombstones=this->trees[i]->getNumTombstones();
+        if(tombstones==0 or (double) tombstones<TOMBSTONE_RATIO*(double) this->trees[i]->size()){
+            continue;
+        }
+        vector<DOSM::RankRecord> records=exportOSMs(i, i);
+        LOG(INFO, boost::wformat(L"Rebuilding OSM %d (%d of %d datapoints deleted) in the background.") %i %tombstones %records.size());
+
+        //the last OSM keeps its (possibly grown) capacity, as new data points are inserted into it
+        number minLogCapacity=(not USE_LSM and i==this->numOSMs-1)? this->trees[i]->getORAMLogCapacity() : 0ull;
+        startMerge(i, i, records, minLogCapacity);
+        return;
+    }
+    if(COMPACTION_FILL_RATIO>0.0){
+        startUnderfullMerge();
+    }
+}
+
+/**
+ * @brief Number of data points in an OSM that are not marked as deleted.
+ * 
+ * @param osmIndex 
+ * @return number 
+ */
+number OSMInterface::getNumLive(size_t osmIndex){
+    return this->trees[osmIndex]->size()-this->trees[osmIndex]->getNumTombstones();
+}
+
+/**
+ * @brief Searches for an OSM which holds less than COMPACTION_FILL_RATIO*capacity live data points and merges it with its neighbours in the background, 
+ * as long as the merged data points still fit into one OSM. Nothing is done if no neighbour can be added.
+ * Fewer OSMs reduce the number of ORAM accesses and the noise added per query.
+ * 
+ * @return true : a merge was started
+ * @return false : there is no underfull OSM that can be merged
+ */
+bool OSMInterface::startUnderfullMerge(){
+    size_t numCandidates=(USE_LSM)? this->numOSMs-1 : this->numOSMs;
+    for(size_t i=0;i<numCandidates;i++){
+        number capacity=this->trees[i]->getCapacity();
+        number merged=getNumLive(i);
+        if((double) merged>=COMPACTION_FILL_RATIO*(double) capacity){
+            continue;
+        }
+        size_t first=i;
+        size_t last=i;
+        while(last+1<numCandidates and merged+getNumLive(last+1)<=this->maxPerTree){
+            last++;
+            merged+=getNumLive(last);
+        }
+        while(first>0 and merged+getNumLive(first-1)<=this->maxPerTree){
+            first--;
+            merged+=getNumLive(first);
+        }
+        if(first==last){
+            continue;
+        }
+
+        vector<DOSM::RankRecord> records=exportOSMs(first, last);
+        LOG(INFO, boost::wformat(L"Merging underfull OSMs %d-%d (%d datapoints) in the background.") %first %last %merged);
+
+        //the last OSM keeps its (possibly grown) capacity, as new data points are inserted into it
+        number minLogCapacity=(not USE_LSM and last==this->numOSMs-1)? this->trees[last]->getORAMLogCapacity() : 0ull;
+        startMerge(first, last, records, minLogCapacity);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Waits for a running merge of the LSM mode or rebuild of the tombstone mode and installs it. Afterwards, the set of OSMs only changes with the next insertion or deletion.
+ * 
+ */
+void OSMInterface::finishMerges(){
+    installMerge(true);
+}
+
+/**
+ * @brief Prepares the querying phase: if CHECK_HISTOGRAMS is set, the histograms are checked against the records and repaired (checkHistograms()).
+ * Afterwards, it waits for running merges, creates the read-only copies of the OSMs (createReplicas()) 
+ * and, if ORAM_CONCURRENCY is larger than 1, lets ORAM_CONCURRENCY workers query each copy at the same time.
+ * 
+ */
+void OSMInterface::prepareQuerying(){
+    if(CHECK_HISTOGRAMS){
+        number inconsistent=checkHistograms(true);
+        if(inconsistent>0){
+            LOG(WARNING, boost::wformat(L"Repaired the histograms of %d OSMs.") %inconsistent);
+        }
+    }
+    createReplicas();
+    setConcurrentAccess(ORAM_CONCURRENCY>1);
+}
+
+/**
+ * @brief Called before the OSMs are changed. Drops the copies of the OSMs and the concurrent access of the querying phase.
+ * The workers finish their queued tasks first, so no lane still reads a front-end or a copy that is removed.
+ * 
+ */
+void OSMInterface::endQuerying(){
+    if(this->numLanes==1 and this->replicas.empty()){
+        return;
+    }
+    this->workers->drain();
+    setConcurrentAccess(false);
+    dropReplicas();
+}
+
+/**
+ * @brief Enables or disables the thread-safe ORAM front-end (ConcurrentORAM) of all OSMs and their copies. 
+ * While enabled, submitFindInterval() spreads the queries for one copy of an OSM across ORAM_CONCURRENCY workers; 
+ * the node accesses of the concurrent range scans are aggregated into batches of at most BATCH_SIZE requests.
+ * Only range scans of the index mode AVL_ONLY are read-only, so other index modes keep one worker per copy.
+ * 
+ * @param enable 
+ */
+void OSMInterface::setConcurrentAccess(bool enable){
+    enable=enable and USE_ORAM and INDEX_MODE==AVL_ONLY;
+    if(not enable and this->numLanes==1){
+        return;
+    }
+    for(size_t r=0;r<getNumReplicas();r++){
+        for(size_t i=0;i<this->numOSMs;i++){
+            getReplica(i,r)->setConcurrentAccess(enable);
+        }
+    }
+    this->numLanes=(enable)? ORAM_CONCURRENCY : 1;
+    if(enable){
+        LOG(INFO, boost::wformat(L"Up to %d workers query each OSM at the same time.") %this->numLanes);
+    }
+}
+
+/**
+ * @brief Creates NUM_REPLICAS-1 read-only copies of every OSM for the querying phase. 
+ * Each copy is a new ORAM loaded with the records of the OSM, so the positions of its blocks are drawn independently. 
+ * Every copy is accessed by its own worker (if the pool is large enough) and submitFindInterval() assigns queries round-robin to the copies.
+ * The copies are dropped with the next insertion or deletion.
+ * 
+ */
+void OSMInterface::createReplicas(){
+    finishMerges();
+    dropReplicas();
+    if(not USE_ORAM or NUM_REPLICAS<=1){
+        return;
+    }
+
+    //the records are exported by the worker of the OSM, as each ORAM is only accessed from one thread
+    vector<vector<DOSM::RankRecord>> records(this->numOSMs);
+    vector<future<void>> exported;
+    for(size_t i=0;i<this->numOSMs;i++){
+        exported.push_back(this->workers->submit(getWorkerIndex(i,0), [this, i, &records](){
+            records[i]=this->trees[i]->exportRecords();
+        }));
+    }
+    for(size_t i=0;i<exported.size();i++){
+        exported[i].get();
+    }
+
+    this->replicas=vector<vector<DOSM::AVLTree *>>(NUM_REPLICAS-1, vector<DOSM::AVLTree *>(this->numOSMs, nullptr));
+    vector<future<void>> built;
+    for(size_t r=1;r<NUM_REPLICAS;r++){
+        for(size_t i=0;i<this->numOSMs;i++){
+            //same ORAM size as the OSM, so queries on all copies cost the same
+            number logCapacity=this->trees[i]->getORAMLogCapacity();
+            built.push_back(this->workers->submit(getWorkerIndex(i,r), [this, i, r, &records, logCapacity](){
+                this->replicas[r-1][i]=buildTreeFromRecords(records[i], logCapacity);
+            }));
+        }
+    }
+    for(size_t i=0;i<built.size();i++){
+        built[i].get();
+    }
+    LOG(INFO, boost::wformat(L"Created %d replicas of each of the %d OSMs.") %(NUM_REPLICAS-1) %this->numOSMs);
+}
+
+/**
+ * @brief Deletes the read-only copies of the OSMs. Afterwards, all queries are answered by the OSMs themselves.
+ * Queries that were already handed to the workers may still read the copies, so the workers finish their queued tasks first.
+ * 
+ */
+void OSMInterface::dropReplicas(){
+    if(this->replicas.empty()){
+        return;
+    }
+    this->workers->drain();
+    for(size_t r=0;r<this->replicas.size();r++){
+        for(size_t i=0;i<this->replicas[r].size();i++){
+            delete this->replicas[r][i];
+        }
+    }
+    this->replicas.clear();
+}
+
+/**
+ * @brief Number of copies that can answer a query for each OSM, including the OSM itself.
+ * 
+ * @return size_t 
+ */
+size_t OSMInterface::getNumReplicas(){
+    return this->replicas.size()+1;
+}
+
+/**
+ * @brief Returns copy replica of the OSM osmIndex. Copy 0 is the OSM itself.
+ * 
+ * @param osmIndex 
+ * @param replica 
+ * @return DOSM::AVLTree* 
+ */
+DOSM::AVLTree *OSMInterface::getReplica(size_t osmIndex, size_t replica){
+    if(replica==0){
+        return this->trees[osmIndex];
+    }
+    return this->replicas[replica-1][osmIndex];
+}
+
+/**
+ * @brief Index of the worker queue for a copy of an OSM. The copies of all OSMs are laid out one after another, 
+ * so the copies of one OSM are spread across different workers. If multiple workers query the same copy at the same time, 
+ * each of them is one lane and the lanes are laid out after the copies.
+ * 
+ * @param osmIndex 
+ * @param replica 
+ * @param lane 
+ * @return size_t 
+ */
+size_t OSMInterface::getWorkerIndex(size_t osmIndex, size_t replica, size_t lane){
+    return (lane*getNumReplicas()+replica)*this->numOSMs+osmIndex;
+}
+
+/**
+ * @brief If every OSM uses its own volume sanitizers (USE_GAMMA is false), new sanitizers are generated until there is one set for each OSM.
+ * 
+ */
+void OSMInterface::ensureVolumeSanitizers(){
+    while(not USE_GAMMA and this->volumeSanitizers.size()<this->numOSMs*NUM_ATTRIBUTES){
+        generateVolumeSanitizer();
+    }
+}
+
+/**
+ * @brief Counts the data points of a histogram that fall into [from,to]. For flat histograms, every bucket is read and the counts are masked instead of branching,
+ * so the runtime only depends on the number of buckets. The loop has no data-dependent control flow and is vectorized by the compiler.
+ * Hierarchical histograms are answered with two prefix counts (see countBelow()), which read a fixed number of nodes that is logarithmic in the number of buckets.
+ * 
+ * @param histogram 
+ * @param from : start point of the interval
+ * @param to : end point of the interval
+ * @return number 
+ */
+number OSMInterface::countInInterval(const hist_t &histogram, double from, double to){
+    if(histogram.fanout>0){
+        //buckets [first,last) lie in the interval, the bounds are clamped to the domain
+        double first=ceil((from-histogram.minValue)/histogram.resolution);
+        double last=floor((to-histogram.minValue)/histogram.resolution)+1.0;
+        double maxBucket=(double) histogram.numBuckets;
+        first=min(max(first, 0.0), maxBucket);
+        last=min(max(last, 0.0), maxBucket);
+        number lower=countBelow(histogram, (number) first);
+        number upper=countBelow(histogram, (number) last);
+        number nonEmpty=(number) (last>first);
+        return (upper-lower) & (0ull-nonEmpty);
+    }
+    const double *values=histogram.values.data();
+    const number *counts=histogram.counts.data();
+    size_t numBuckets=histogram.size();
+    number count=0;
+    #pragma omp simd reduction(+:count)
+    for(size_t i=0;i<numBuckets;i++){
+        number inInterval=(number) ((values[i]>=from) & (values[i]<=to));
+        count+=counts[i] & (0ull-inInterval);
+    }
+    return count;
+}
+
+/**
+ * @brief Counts the data points of a hierarchical histogram in the buckets below the passed bucket.
+ * On every level, all siblings of the ancestor of the bucket are read and the ones left of the ancestor are added with a mask.
+ * Thus, each call reads fanout nodes per level, independent of the bucket and the data.
+ * 
+ * @param histogram : a hierarchical histogram
+ * @param bucket : index of the bucket, at most histogram.numBuckets
+ * @return number 
+ */
+number OSMInterface::countBelow(const hist_t &histogram, number bucket){
+    number count=0;
+    number node=bucket;
+    for(size_t level=0;level+1<histogram.levelOffsets.size();level++){
+        const number *siblings=histogram.counts.data()+histogram.levelOffsets[level]+(node-node%histogram.fanout);
+        number position=node%histogram.fanout;
+        for(size_t i=0;i<histogram.fanout;i++){
+            number isLeft=(number) (i<position);
+            count+=siblings[i] & (0ull-isLeft);
+        }
+        node/=histogram.fanout;
+    }
+    return count;
+}
+
 /**
  * @brief Get the Total number of data points in each ODB for a query by scanning all histograms. Runtime depends on the domain size of the input data. This algorithm is oblivious.
+ * The histograms of the OSMs are scanned in parallel.
  * 
  * @param from : start point of the interval
  * @param to : end point of the interval
@@ -238,18 +1302,16 @@ void OSMInterface::deleteEntry(db_t key, size_t nodeHash, ulong column){
  * @return tuple<size_t,vector<size_t>> 
  */
 tuple<number,vector<number>> OSMInterface::getTotalFromHistograms(db_t from, db_t to, size_t column){
-    vector<number> counts;
+    vector<number> counts(this->numOSMs, 0ull);
+    double fromValue=DBT::toDouble(from);
+    double toValue=DBT::toDouble(to);
+    #pragma omp parallel for if(this->numOSMs>1)
+    for(size_t osmIndex=0; osmIndex<this->numOSMs;osmIndex++){
+        counts[osmIndex]=countInInterval(this->histograms[osmIndex][column], fromValue, toValue);
+    }
     number total=0;
     for(size_t osmIndex=0; osmIndex<this->numOSMs;osmIndex++){
-        auto histogram=this->histograms[osmIndex][column];
-        number count=0;
-        for(size_t i=0;i<histogram.size();i++){
-            pair<db_t,number> entry=histogram[i]; //getting the value and its frequency
-            bool inInterval= (entry.first>= from and entry.first<=to);
-            count+=_IF_THEN(inInterval, entry.second, (number)0);
-        }
-        counts.push_back(count);
-        total+=count;
+        total+=counts[osmIndex];
     }
     return make_tuple(total,counts);
 }
@@ -257,77 +1319,254 @@ tuple<number,vector<number>> OSMInterface::getTotalFromHistograms(db_t from, db_
 
 /**
  * @brief Queries an OSM to find all elements that fall into the queried interval. 
- * This function is a wrapper for parallelization, called by findInterval().
+ * This function is a wrapper for parallelization, called by the worker of the OSM for queries submitted with submitFindInterval().
  * 
  * @param osmIndex : Index of the OSM to be queried
+ * @param replica : copy of the OSM that answers the query, 0 is the OSM itself
  * @param startKey : Start of the interval
  * @param endKey : end of the interval
  * @param column : Column to be queried
  * @param estimate : number of data points to retrieve for volume sanitation from this OSM
- * @param promise : for parallelization, is set after execution. Then it contains a list of records and information wether these are dummies or not.
+ * @param pending : the promise of this OSM is set after execution. Then it contains a list of records and information wether these are dummies or not.
  */
-void OSMInterface::findIntervalParallel(size_t osmIndex, db_t startKey, db_t endKey, ushort column, number estimate,promise<dbResponse> *promise){
-    dbResponse  records;
-    //LOG(INFO,boost::wformat(L"Parallelized accessing osm %d") %osmIndex);
-
-    if(USE_ORAM){
-        records= this->trees[osmIndex]->findIntervalMenhir(startKey, endKey, column, estimate);
-    }else{
-        records=this->lists[osmIndex]->findInterval(startKey, endKey, column, estimate);
-    } 
-    promise->set_value(records);
+void OSMInterface::findIntervalParallel(size_t osmIndex, size_t replica, db_t startKey, db_t endKey, ushort column, number estimate, shared_ptr<PendingQuery> pending){
+    try{
+        dbResponse  records;
+        if(USE_ORAM){
+            records= getReplica(osmIndex, replica)->findIntervalMenhir(startKey, endKey, column, estimate);
+        }else{
+            records=this->lists[osmIndex]->findInterval(startKey, endKey, column, estimate);
+        } 
+        pending->finishedORAMs[osmIndex]=chrono::steady_clock::now();
+        pending->promises[osmIndex].set_value(records);
+    }catch(...){
+        pending->promises[osmIndex].set_exception(current_exception());
+    }
 }
 
-
 /**
- * @brief Query all OSMs in parallel to find all elements that fall into the queried interval. 
+ * @brief Dispatches a query to the workers of all OSMs and returns without waiting. 
+ * As each worker processes its queue in order, several queries can be in flight: OSM i can already serve the next query while OSM j still serves the current one.
+ * If replicas were created, consecutive queries are answered by different copies of the OSMs and thus by different workers.
+ * With concurrent access, consecutive queries for the same copy are additionally spread across numLanes workers.
+ * The results are collected with collectFindInterval().
  * 
  * @param startKey : Start of the interval
  * @param endKey : end of the interval
  * @param column : Column to be queried
  * @param estimates  : vector of containing information for each OSM, how many data points have to be retrieved for volume sanitation
- * @return dbResponse : Contains a list of records and information wether these are dummies or not.
+ * @param timing : timing context of the query, beforeORAMs is set here
+ * @return shared_ptr<PendingQuery> 
  */
-dbResponse OSMInterface::findInterval(db_t startKey, db_t endKey, ushort column, vector<number> estimates){
-
-   
-	thread threads[this->numOSMs];	
-	promise<dbResponse> promises[this->numOSMs];
-	future<dbResponse> futures[this->numOSMs];
-
-	timestampBeforeORAMs = chrono::steady_clock::now();
+shared_ptr<PendingQuery> OSMInterface::submitFindInterval(db_t startKey, db_t endKey, ushort column, vector<number> estimates, QueryTiming timing){
+    shared_ptr<PendingQuery> pending=make_shared<PendingQuery>();
+    pending->promises=vector<promise<dbResponse>>(this->numOSMs);
+    pending->finishedORAMs=vector<chrono::steady_clock::time_point>(this->numOSMs);
+    pending->timing=timing;
+    pending->timing.beforeORAMs=chrono::steady_clock::now();
+    size_t queryIndex=this->nextQuery.fetch_add(1);
+    size_t replica=queryIndex%getNumReplicas();
+    size_t lane=(queryIndex/getNumReplicas())%this->numLanes;
 
     for (size_t i = 0; i <this->numOSMs; i++){
         LOG(INFO, boost::wformat(L"estimate %d  for dosm %i") % estimates[i] %i);
-		futures[i] = promises[i].get_future();
-		threads[i] = thread(
-			&OSMInterface::findIntervalParallel,
-            this,
-            i,
-            startKey, 
-            endKey, 
-            column, 
-            estimates[i],
-			&promises[i]);
-	}
-
+        pending->futures.push_back(pending->promises[i].get_future());
+        number estimate=estimates[i];
+        this->workers->submit(getWorkerIndex(i,replica,lane), [this, i, replica, startKey, endKey, column, estimate, pending](){
+            findIntervalParallel(i, replica, startKey, endKey, column, estimate, pending);
+        });
+    }
+    return pending;
+}
 
+/**
+ * @brief Waits until all OSMs answered a query submitted with submitFindInterval() and merges the results. 
+ * Sets afterORAMs in the timing context of the query to the time the last OSM finished.
+ * 
+ * @param pending 
+ * @return dbResponse : Contains a list of records and information wether these are dummies or not.
+ */
+dbResponse OSMInterface::collectFindInterval(shared_ptr<PendingQuery> pending){
     dbResponse allRecords;
-    for(size_t i=0; i<this->numOSMs;i++){
-		dbResponse records= futures[i].get();
-		threads[i].join();
+    pending->timing.afterORAMs=pending->timing.beforeORAMs;
+    for(size_t i=0; i<pending->futures.size();i++){
+		dbResponse records= pending->futures[i].get();
         LOG(INFO, boost::wformat(L"got %d datapoints from osm %d ") % records.size() %i);
+        pending->timing.afterORAMs=max(pending->timing.afterORAMs, pending->finishedORAMs[i]);
         if(RETRIEVE_EXACTLY.size()!=0 and i!=0 ){
             continue;
         }
         allRecords.insert(end(allRecords), begin(records), end(records));
     }
-    timestampAfterORAMs = chrono::steady_clock::now();
-
+    return allRecords;
+}
 
+/**
+ * @brief Query all OSMs in parallel to find all elements that fall into the queried interval and waits for the result. The queries are dispatched to the worker pool.
+ * 
+ * @param startKey : Start of the interval
+ * @param endKey : end of the interval
+ * @param column : Column to be queried
+ * @param estimates  : vector of containing information for each OSM, how many data points have to be retrieved for volume sanitation
+ * @param timing : if not null, beforeORAMs and afterORAMs are set in this timing context
+ * @return dbResponse : Contains a list of records and information wether these are dummies or not.
+ */
+dbResponse OSMInterface::findInterval(db_t startKey, db_t endKey, ushort column, vector<number> estimates, QueryTiming *timing){
+    QueryTiming thisTiming;
+    if(timing!=nullptr){
+        thisTiming=*timing;
+    }
+    shared_ptr<PendingQuery> pending=submitFindInterval(startKey, endKey, column, estimates, thisTiming);
+    dbResponse allRecords=collectFindInterval(pending);
+    if(timing!=nullptr){
+        *timing=pending->timing;
+    }
     return allRecords;
 }
 
+/**
+ * @brief Query all OSMs in parallel with the same access pattern as findInterval(), but the records of OSM i are passed to visitors[i] as soon as they were read 
+ * instead of being collected. visitors[i] is only called by the worker serving OSM i, so the visitors of different OSMs do not need to be synchronized.
+ * Waits until all OSMs finished.
+ * 
+ * @param startKey : Start of the interval
+ * @param endKey : end of the interval
+ * @param column : Column to be queried
+ * @param estimates  : vector of containing information for each OSM, how many data points have to be retrieved for volume sanitation
+ * @param visitors : one per OSM, called with each record and wether it is a dummy
+ * @param timing : if not null, beforeORAMs and afterORAMs are set in this timing context
+ * @return number : total number of visited records
+ */
+number OSMInterface::scanInterval(db_t startKey, db_t endKey, ushort column, vector<number> estimates, vector<recordVisitor> visitors, QueryTiming *timing){
+    if(timing!=nullptr){
+        timing->beforeORAMs=chrono::steady_clock::now();
+    }
+    size_t queryIndex=this->nextQuery.fetch_add(1);
+    size_t replica=queryIndex%getNumReplicas();
+    size_t lane=(queryIndex/getNumReplicas())%this->numLanes;
+
+    shared_ptr<vector<promise<number>>> promises=make_shared<vector<promise<number>>>(this->numOSMs);
+    vector<future<number>> futures;
+    for (size_t i = 0; i <this->numOSMs; i++){
+        futures.push_back((*promises)[i].get_future());
+        number estimate=estimates[i];
+        recordVisitor visit=visitors[i];
+        this->workers->submit(getWorkerIndex(i,replica,lane), [this, i, replica, startKey, endKey, column, estimate, visit, promises](){
+            try{
+                number visited=0;
+                if(USE_ORAM){
+                    visited=getReplica(i, replica)->scanInterval(startKey, endKey, column, estimate, visit);
+                }else{
+                    dbResponse records=this->lists[i]->findInterval(startKey, endKey, column, estimate);
+                    for(size_t r=0;r<records.size();r++){
+                        visit(get<0>(records[r]), get<1>(records[r]));
+                    }
+                    visited=records.size();
+                }
+                (*promises)[i].set_value(visited);
+            }catch(...){
+                (*promises)[i].set_exception(current_exception());
+            }
+        });
+    }
+
+    //all OSMs have to finish before returning, as the visitors may refer to the state of the caller
+    number total=0;
+    exception_ptr error=nullptr;
+    for (size_t i = 0; i < futures.size(); i++){
+        try{
+            total+=futures[i].get();
+        }catch(...){
+            error=current_exception();
+        }
+    }
+    if(error!=nullptr){
+        rethrow_exception(error);
+    }
+    if(timing!=nullptr){
+        timing->afterORAMs=chrono::steady_clock::now();
+    }
+    return total;
+}
+
+/**
+ * @brief Number of records and sum of AGGREGATE_COLUMN over all records whose key in the passed column lies in [startKey, endKey]. 
+ * Requires USE_SUBTREE_AGGREGATES. Each OSM answers with two padded descents over its subtree aggregates, the OSMs are queried in parallel by their workers.
+ * No records are retrieved, so no volume sanitation is required.
+ * 
+ * @param startKey : Start of the interval
+ * @param endKey : end of the interval
+ * @param column : Column to be queried
+ * @param timing : if not null, beforeORAMs and afterORAMs are set in this timing context
+ * @return tuple<number,double> : number of records and sum of AGGREGATE_COLUMN
+ */
+tuple<number,double> OSMInterface::aggregateInterval(db_t startKey, db_t endKey, ushort column, QueryTiming *timing){
+    return aggregateOSMs([startKey, endKey, column](DOSM::AVLTree *tree){
+        return tree->aggregateInterval(startKey, endKey, column);
+    }, timing);
+}
+
+/**
+ * @brief Number of records and sum of AGGREGATE_COLUMN over all records with a key smaller than bound (or equal to bound if inclusive) in the passed column.
+ * Requires USE_SUBTREE_AGGREGATES. Each OSM answers with one padded descent, so a fixed lower end of several intervals only has to be counted once.
+ * 
+ * @param bound 
+ * @param inclusive 
+ * @param column : Column to be queried
+ * @param timing : if not null, beforeORAMs and afterORAMs are set in this timing context
+ * @return tuple<number,double> : number of records and sum of AGGREGATE_COLUMN
+ */
+tuple<number,double> OSMInterface::aggregateBelow(db_t bound, bool inclusive, ushort column, QueryTiming *timing){
+    return aggregateOSMs([bound, inclusive, column](DOSM::AVLTree *tree){
+        return tree->aggregateBelow(bound, inclusive, column);
+    }, timing);
+}
+
+/**
+ * @brief Runs an aggregate over the subtree aggregates on every OSM in parallel and adds up the results. 
+ * The copy of the OSMs and the lane are picked round robin as for other queries.
+ * 
+ * @param aggregate : called by the workers with the copy of the OSM to aggregate over
+ * @param timing : if not null, beforeORAMs and afterORAMs are set in this timing context
+ * @return tuple<number,double> : number of records and sum of AGGREGATE_COLUMN over all OSMs
+ */
+tuple<number,double> OSMInterface::aggregateOSMs(function<tuple<number,double>(DOSM::AVLTree *)> aggregate, QueryTiming *timing){
+    if(not USE_SUBTREE_AGGREGATES or not this->USE_ORAM){
+        __throw_invalid_argument("Subtree aggregates are only maintained if USE_SUBTREE_AGGREGATES is set and ORAMs are used.");
+    }
+    if(timing!=nullptr){
+        timing->beforeORAMs=chrono::steady_clock::now();
+    }
+    size_t queryIndex=this->nextQuery.fetch_add(1);
+    size_t replica=queryIndex%getNumReplicas();
+    size_t lane=(queryIndex/getNumReplicas())%this->numLanes;
+
+    shared_ptr<vector<promise<tuple<number,double>>>> promises=make_shared<vector<promise<tuple<number,double>>>>(this->numOSMs);
+    vector<future<tuple<number,double>>> futures;
+    for (size_t i = 0; i <this->numOSMs; i++){
+        futures.push_back((*promises)[i].get_future());
+        this->workers->submit(getWorkerIndex(i,replica,lane), [this, i, replica, aggregate, promises](){
+            try{
+                (*promises)[i].set_value(aggregate(getReplica(i, replica)));
+            }catch(...){
+                (*promises)[i].set_exception(current_exception());
+            }
+        });
+    }
+
+    number count=0;
+    double sum=0.0;
+    for (size_t i = 0; i < futures.size(); i++){
+        auto[osmCount, osmSum]=futures[i].get();
+        count+=osmCount;
+        sum+=osmSum;
+    }
+    if(timing!=nullptr){
+        timing->afterORAMs=chrono::steady_clock::now();
+    }
+    return make_tuple(count, sum);
+}
+
 
 
 /**
@@ -397,14 +1636,20 @@ void OSMInterface::generateVolumeSanitizer(){
 	LOG(INFO, L"Generating DP noise tree...");
 
     // For each column, the dp_level (DP noise tree) of the corresponding volume sanitizer is computed and stored for later use. 
+    // Only the sanitizers added by this call are filled, the ones generated before keep their noise.
+    size_t firstNew=this->volumeSanitizers.size()-NUM_ATTRIBUTES;
 	for(int ii=0; ii< (int) NUM_ATTRIBUTES; ii++){
-		VolumeSanitizer* np= &this->volumeSanitizers[ii];
+		VolumeSanitizer* np= &this->volumeSanitizers[firstNew+ii];
 		auto buckets = np->dp_buckets;
-		map<pair<number, number>, number> m;
+		vector<number> levelSizes;
+		for (auto l = 0uLL; l < np->dp_levels; l++){
+			levelSizes.push_back((number) ceil(buckets));
+			buckets /= DP_K;
+		}
+		shared_ptr<NoiseTree> tree=make_shared<NoiseTree>(levelSizes);
 
 		for (auto l = 0uLL; l < np->dp_levels; l++){
-			for (auto j = 0uLL; j < buckets; j++){
-				pair<number,number> key= make_pair(l,j);
+			for (auto j = 0uLL; j < levelSizes[l]; j++){
 				//if point query or range =1 then np->dp_levels is 1 resulting in sensitivity 1/epsilon
 				//else it will be the same as log_k(N)/epsilon
                 int value=0;
@@ -420,13 +1665,12 @@ void OSMInterface::generateVolumeSanitizer(){
                 }else{
                     value = (int) sampleLaplace(np->dp_alpha, lambda);
                 }
-                m[key] = value;
+                tree->set(l, j, value);
 			}
-			buckets /= DP_K;
 		}
-		np->noises=m;
+		np->noises=tree;
 		// count number of nodes in DP tree
-		number dpNodes = np->noises.size();			
+		number dpNodes = np->noises->size();			
 		LOG(INFO, boost::wformat(L"For column %1%: DP tree has %2% elements") % ii % dpNodes);
 	}
 }
@@ -43,6 +43,17 @@ pair<number, number> avg(function<number(const measurement&)> getter){
 	return {sum, values.size() > 0 ? sum / values.size() : 0};
 };
 
+/**
+ * @brief Computes the throughput in operations per second from the runtimes (in microseconds) of single operations.
+ * 
+ * @param measurements : e.g. INSERTION_MEASUREMENTS or DELETION_MEASUREMENTS
+ * @return number : operations per second, 0 if there are no measurements
+ */
+number getThroughput(vector<number> *measurements){
+	number total = accumulate(measurements->begin(), measurements->end(), 0uLL);
+	return total > 0 ? (number) (measurements->size() * 1000000uLL / total) : 0;
+}
+
 /**
  * @brief Determine if string is a float.
  * 
@@ -219,6 +230,7 @@ void writeOutput(){
 	PUT_PARAMETER(QUERY_INDEX);
 	PUT_PARAMETER(WHERE_INDEX);
 	root.put("QUERY_FUNCTION", toInt(QUERY_FUNCTION));
+	root.put("ADDITIONAL_QUERY_FUNCTIONS", additionalQueryFunctionsToString());
 	PUT_PARAMETER(POINT_QUERIES);
 	PUT_PARAMETER(NUM_QUERIES);
 	PUT_PARAMETER(MAX_SENSITIVITY);
@@ -231,6 +243,32 @@ void writeOutput(){
 	PUT_PARAMETER(STASH_FACTOR);
 	PUT_PARAMETER(USE_ORAM);
 	PUT_PARAMETER(BATCH_SIZE);
+	root.put("INDEX_MODE", toInt(INDEX_MODE));
+	PUT_PARAMETER(LEAF_PAGE_SIZE);
+	PUT_PARAMETER(RANK_REBUILD_THRESHOLD);
+	PUT_PARAMETER(USE_LSM);
+	PUT_PARAMETER(LSM_BUFFER_SIZE);
+	PUT_PARAMETER(LSM_SIZE_RATIO);
+	PUT_PARAMETER(USE_TOMBSTONES);
+	PUT_PARAMETER(TOMBSTONE_RATIO);
+	PUT_PARAMETER(WORKER_POOL_SIZE);
+	PUT_PARAMETER(PIN_WORKERS);
+	PUT_PARAMETER(QUERIES_IN_FLIGHT);
+	PUT_PARAMETER(NUM_REPLICAS);
+	PUT_PARAMETER(ORAM_CONCURRENCY);
+	PUT_PARAMETER(AUTO_SHARDING);
+	PUT_PARAMETER(RAM_BUDGET);
+	PUT_PARAMETER(USE_SPARE_OSM);
+	PUT_PARAMETER(SPARE_OSM_THRESHOLD);
+	PUT_PARAMETER(GROW_LOG_CAPACITY);
+	PUT_PARAMETER(COMPACTION_FILL_RATIO);
+	PUT_PARAMETER(USE_SHARD_HANDLES);
+	PUT_PARAMETER(SHARD_HANDLE_DUMMIES);
+	PUT_PARAMETER(HISTOGRAM_FANOUT);
+	PUT_PARAMETER(CHECK_HISTOGRAMS);
+	PUT_PARAMETER(USE_SUBTREE_AGGREGATES);
+	PUT_PARAMETER(AGGREGATE_COLUMN);
+	PUT_PARAMETER(STREAM_RESULTS);
 	PUT_PARAMETER(DP_BUCKETS);
 	PUT_PARAMETER(DP_K);
 	PUT_PARAMETER(DP_BETA);
@@ -262,6 +300,12 @@ void writeOutput(){
 	pt::ptree aggregates;
 	aggregates.put("insertionTotal", INSERTION_TOTAL);
 	aggregates.put("insertionMean", INSERTION_TOTAL/NUM_DATAPOINTS);
+	aggregates.put("deletionTotal", DELETION_TOTAL);
+	aggregates.put("insertionThroughput", getThroughput(INSERTION_MEASUREMENTS));
+	aggregates.put("deletionThroughput", getThroughput(DELETION_MEASUREMENTS));
+	aggregates.put("queryThroughput", QUERYING_TOTAL > 0 ? (number) (QUERY_MEASUREMENTS->size() * 1000000000uLL / QUERYING_TOTAL) : 0);
+	aggregates.put("predictedORAMTimePerQuery", PREDICTED_QUERY_TIME);
+	aggregates.put("oramTimePerQuery", avg([](measurement v) { return get<1>(v); }).second);
 	aggregates.put("timeTotal", timePair.first);
 	aggregates.put("timePerQuery", timePair.second);
 	aggregates.put("realTotal", realPair.first);
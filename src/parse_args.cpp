@@ -35,8 +35,9 @@ void readCommandlineArgs(int argc, char* argv[]){
 			 __throw_invalid_argument(oss.str().c_str());
 		}
 	};
-	string columnsString, resolutionString, aggregateFuncString, logLevelString, dataSourceString, retrieveExactlyString="";
+	string columnsString, resolutionString, aggregateFuncString, additionalAggString, logLevelString, dataSourceString, retrieveExactlyString="";
 	string minString, maxString="";
+	string indexModeString="";
 
 	po::options_description desc("range query processor", 120);
 	desc.add_options()("help,h", "produce help message");
@@ -64,7 +65,8 @@ void readCommandlineArgs(int argc, char* argv[]){
 	desc.add_options()("query-epsilon", po::value<double>(&QUERY_RESPONSE_EPSILON)->default_value(QUERY_RESPONSE_EPSILON), "Privacy Budget available at the beginning. This budget is used up by answering queries. DEFAULT:");
 	desc.add_options()("interactiveQueries", po::value<bool>(&INTERACTIVE_QUERIES)->default_value(INTERACTIVE_QUERIES), "allows QUERIES to be posed in an interactive manner against artifical or from-file data. DEFAULT:"+INTERACTIVE_QUERIES);
 	desc.add_options()("numQueries", po::value<number>(&NUM_QUERIES)->default_value(NUM_QUERIES), "number of synthetic QUERIES to generate or real QUERIES to read. DEFAULT:"+NUM_QUERIES);
-	desc.add_options()("agg", po::value<string>(&aggregateFuncString)->default_value(aggregateFuncString), "defines the default function run for queries when automated querying. Options are: SUM, MEAN, VARIANCE, COUNT, MIN_COUNT, MAX_COUNT. Default is SUM.");
+	desc.add_options()("agg", po::value<string>(&aggregateFuncString)->default_value(aggregateFuncString), "defines the default function run for queries when automated querying. Options are: SUM, MEAN, VARIANCE, COUNT, MIN_COUNT, MAX_COUNT, MEDIAN, PERCENTILE. Default is SUM.");
+	desc.add_options()("additionalAgg", po::value<string>(&additionalAggString)->default_value(additionalAggString), "comma separated list of further functions (same options as agg) that are computed from the records retrieved for each query. The epsilon of a query is split evenly between all its functions.");
 	desc.add_options()("queryIndex", po::value<uint>(&QUERY_INDEX)->default_value(QUERY_INDEX), "Will run the QUERIES against the ith attribute. Index starts with 0. DEFAULT:"+QUERY_INDEX);
 	desc.add_options()("whereIndex", po::value<uint>(&WHERE_INDEX)->default_value(WHERE_INDEX), "If there are more than one column, this column can be used for filtering data points. The aggregate is computed over the column given by QUERY_INDEX. Index starts with 0. DEFAULT:"+WHERE_INDEX);
 	desc.add_options()("pointQueries", po::value<bool>(&POINT_QUERIES)->default_value(POINT_QUERIES), "if set, will run point QUERIES (against left endpoint) instead of range QUERIES. DEFAULT:"+POINT_QUERIES);
@@ -86,6 +88,32 @@ void readCommandlineArgs(int argc, char* argv[]){
 	desc.add_options()("stashFactor", po::value<number>(&STASH_FACTOR)->default_value(STASH_FACTOR), "Constant for changing the ORAMs Stash size. Usually it is 4  but can be changed if failures occure.");
 	desc.add_options()("logcapacity", po::value<number>(&ORAM_LOG_CAPACITY)->default_value(ORAM_LOG_CAPACITY), "Depth of the tree in the ORAM. Usually 2^16.");
 	desc.add_options()("batch", po::value<number>(&BATCH_SIZE)->default_value(BATCH_SIZE), "batch size to use in storage adapters"); 
+	desc.add_options()("indexMode", po::value<string>(&indexModeString)->default_value(indexModeString), "Index used for range scans in each OSM. Options: AVL_ONLY, LEAF_PAGES, RANK_LAYOUT. LEAF_PAGES packs consecutive records of each column into one ORAM block. RANK_LAYOUT stores records sorted by rank, so range scans can fetch BATCH_SIZE records at once. Default: AVL_ONLY");
+	desc.add_options()("rankRebuildThreshold", po::value<number>(&RANK_REBUILD_THRESHOLD)->default_value(RANK_REBUILD_THRESHOLD), "Number of inserts and deletes after which the rank layout is rebuilt if indexMode is RANK_LAYOUT.");
+	desc.add_options()("leafPageSize", po::value<number>(&LEAF_PAGE_SIZE)->default_value(LEAF_PAGE_SIZE), "Number of records per leaf page if indexMode is LEAF_PAGES. Must be at least 2.");
+	desc.add_options()("useLSM", po::value<bool>(&USE_LSM)->default_value(USE_LSM), "If set, new records are inserted into a small write buffer OSM. Full buffers are merged into larger OSMs in the background using the bulk tree construction. Only used with ORAMs.");
+	desc.add_options()("lsmBufferSize", po::value<number>(&LSM_BUFFER_SIZE)->default_value(LSM_BUFFER_SIZE), "Number of records in the write buffer before it is merged if useLSM is set.");
+	desc.add_options()("lsmSizeRatio", po::value<number>(&LSM_SIZE_RATIO)->default_value(LSM_SIZE_RATIO), "If useLSM is set, an OSM is merged with newer records as long as it holds at most lsmSizeRatio times as many records. Must be at least 2.");
+	desc.add_options()("useTombstones", po::value<bool>(&USE_TOMBSTONES)->default_value(USE_TOMBSTONES), "If set, deletes only mark the record as deleted with one padded lookup. OSMs are rebuilt in the background once enough records are marked. Only used with ORAMs.");
+	desc.add_options()("tombstoneRatio", po::value<double>(&TOMBSTONE_RATIO)->default_value(TOMBSTONE_RATIO), "If useTombstones is set, an OSM is rebuilt once this share of its records is marked as deleted. Must be in (0,1].");
+	desc.add_options()("workerPoolSize", po::value<number>(&WORKER_POOL_SIZE)->default_value(WORKER_POOL_SIZE), "Number of long-lived worker threads used to access the OSMs in parallel. The OSMs are assigned round-robin to the workers. If 0, one worker per hardware thread is used.");
+	desc.add_options()("pinWorkers", po::value<bool>(&PIN_WORKERS)->default_value(PIN_WORKERS), "If set, worker i is pinned to core i (modulo the number of cores).");
+	desc.add_options()("queriesInFlight", po::value<number>(&QUERIES_IN_FLIGHT)->default_value(QUERIES_IN_FLIGHT), "Number of queries that are admitted at the same time. The queries are pipelined across the workers of the OSMs. Also sets the number of threads of the RPC server.");
+	desc.add_options()("replicas", po::value<number>(&NUM_REPLICAS)->default_value(NUM_REPLICAS), "Number of copies of each OSM used in the querying phase, including the OSM itself. Each copy has its own ORAM and worker, queries are assigned round-robin to the copies. Copies are dropped on the next insertion or deletion.");
+	desc.add_options()("oramConcurrency", po::value<number>(&ORAM_CONCURRENCY)->default_value(ORAM_CONCURRENCY), "Number of workers that query the same OSM at the same time in the querying phase. Their ORAM requests are aggregated into batches of at most --batch requests. Only used with the index mode AVL_ONLY.");
+	desc.add_options()("autoSharding", po::value<bool>(&AUTO_SHARDING)->default_value(AUTO_SHARDING), "If set, the number of OSMs and their capacity (--logcapacity) are chosen from the number of workers, the RAM budget and the number of data points so that the predicted query time is minimal.");
+	desc.add_options()("ramBudget", po::value<number>(&RAM_BUDGET)->default_value(RAM_BUDGET), "Memory in MB available for the ORAMs of all OSMs including replicas. Only used with --autoSharding. If 0, the memory is not limited.");
+	desc.add_options()("useSpareOSM", po::value<bool>(&USE_SPARE_OSM)->default_value(USE_SPARE_OSM), "If set, the next empty OSM is created in the background once the last OSM is filled up to spareOSMThreshold, so inserts do not wait for the creation of a new ORAM.");
+	desc.add_options()("spareOSMThreshold", po::value<double>(&SPARE_OSM_THRESHOLD)->default_value(SPARE_OSM_THRESHOLD), "If useSpareOSM is set, the next OSM is created once this share of the capacity of the last OSM is used. Must be in (0,1].");
+	desc.add_options()("growLogCapacity", po::value<number>(&GROW_LOG_CAPACITY)->default_value(GROW_LOG_CAPACITY), "If larger than --logcapacity, a full last OSM is grown in place by one ORAM level at a time up to this log capacity before a new OSM is created. Fewer OSMs add less padding to each query. If 0, OSMs do not grow. Not used with useLSM.");
+	desc.add_options()("compactionFillRatio", po::value<double>(&COMPACTION_FILL_RATIO)->default_value(COMPACTION_FILL_RATIO), "After deletions, an OSM holding fewer live records than this share of its capacity is merged with its neighbours in the background, as long as the result fits into one OSM. Must be in [0,1). If 0, underfull OSMs are not merged.");
+	desc.add_options()("useShardHandles", po::value<bool>(&USE_SHARD_HANDLES)->default_value(USE_SHARD_HANDLES), "Inserts return a handle that contains the encrypted and authenticated index of the OSM holding the record. Deletes with a handle only access that OSM and shardHandleDummies other OSMs instead of all OSMs.");
+	desc.add_options()("shardHandleDummies", po::value<number>(&SHARD_HANDLE_DUMMIES)->default_value(SHARD_HANDLE_DUMMIES), "If useShardHandles is set, number of randomly chosen other OSMs on which a delete with a handle executes dummy operations.");
+	desc.add_options()("histogramFanout", po::value<number>(&HISTOGRAM_FANOUT)->default_value(HISTOGRAM_FANOUT), "If at least 2, the histograms used for volume sanitation are k-ary prefix-count trees with this fanout. Counting the data points of a range then reads a fixed number of nodes that is logarithmic in the domain size instead of scanning every bucket. The tree still has one leaf per bucket, so its memory (about k/(k-1) counters per bucket and column in each OSM) stays linear in the domain size. If 0, flat histograms are used and scanned completely for every query.");
+	desc.add_options()("checkHistograms", po::value<bool>(&CHECK_HISTOGRAMS)->default_value(CHECK_HISTOGRAMS), "Before the querying phase, the histograms that are maintained by inserts and deletes are recounted from the records of the OSMs and repaired if they differ. Requires ORAMs.");
+	desc.add_options()("useSubtreeAggregates", po::value<bool>(&USE_SUBTREE_AGGREGATES)->default_value(USE_SUBTREE_AGGREGATES), "If set, each node stores the number of records and the sum of aggregateColumn in its subtrees. COUNT, SUM and MEAN (of aggregateColumn) over a range are then answered with two padded descents per OSM instead of retrieving the records. Requires ORAMs and cannot be combined with useTombstones.");
+	desc.add_options()("aggregateColumn", po::value<number>(&AGGREGATE_COLUMN)->default_value(AGGREGATE_COLUMN), "Column that is summed up in the subtree aggregates if useSubtreeAggregates is set.");
+	desc.add_options()("streamResults", po::value<bool>(&STREAM_RESULTS)->default_value(STREAM_RESULTS), "If set, queries that only ask for COUNT, SUM and MEAN are aggregated while the records are read from the OSMs instead of storing all records. Such queries are not pipelined. Has no effect if retrieveExactly is set.");
 	
 	//options useful for evaluation
 	desc.add_options()("insertBulk", po::value<bool>(&INSERT_BULK)->default_value(INSERT_BULK), "Set true to insert data in a bulk into the database. THIS OPERATION IS NOT OBLIVIOUS and only for measurment purposes.");
@@ -287,11 +315,159 @@ void readCommandlineArgs(int argc, char* argv[]){
 		}
 	}
 
+	if(additionalAggString!=""){
+		vector<string> valsA;
+		boost::algorithm::split(valsA, additionalAggString, boost::is_any_of(","));
+		for(auto val : valsA){
+			AggregateFunc temp=aggregateFuncFromString(val);
+			if(temp==AggregateFunc::AggregateFunc_INVALID){
+				LOG(WARNING, L"Function "+toWString(val)+L" passed with -additionalAgg was not valid and is ignored.");
+			}else{
+				ADDITIONAL_QUERY_FUNCTIONS.push_back(temp);
+			}
+		}
+	}
+
 	if(retrieveExactlyString!=""){
 		RETRIEVE_EXACTLY=retieveExactlyfromString(retrieveExactlyString);
 	}
 
 
+	if(indexModeString!=""){
+		INDEX_MODE_T temp=indexModefromString(indexModeString);
+		if(temp==INDEX_MODE_T::INDEX_MODE_T_INVALID){
+			LOG(INFO, L"Option passed with --indexMode was not valid. The index mode will be set to " +toWString(toString(INDEX_MODE)));
+		}else{
+			INDEX_MODE=temp;
+		}
+	}
+
+	if (INDEX_MODE==LEAF_PAGES and LEAF_PAGE_SIZE<2)
+	{
+		LOG(WARNING, L"Leaf pages must hold at least 2 records. Setting LEAF_PAGE_SIZE to 2.");
+		LEAF_PAGE_SIZE=2;
+	}
+
+	if (INDEX_MODE==RANK_LAYOUT and RANK_REBUILD_THRESHOLD<1)
+	{
+		LOG(WARNING, L"The rank layout must be rebuilt after at least one update. Setting RANK_REBUILD_THRESHOLD to 1.");
+		RANK_REBUILD_THRESHOLD=1;
+	}
+
+	if (USE_LSM and not USE_ORAM)
+	{
+		LOG(WARNING, L"The LSM mode requires ORAMs. Setting USE_LSM to false.");
+		USE_LSM=false;
+	}
+
+	if (USE_LSM and LSM_BUFFER_SIZE<1)
+	{
+		LOG(WARNING, L"The write buffer must hold at least 1 record. Setting LSM_BUFFER_SIZE to 1.");
+		LSM_BUFFER_SIZE=1;
+	}
+
+	if (USE_LSM and LSM_SIZE_RATIO<2)
+	{
+		LOG(WARNING, L"OSMs must grow by at least factor 2 per merge. Setting LSM_SIZE_RATIO to 2.");
+		LSM_SIZE_RATIO=2;
+	}
+
+	if (USE_TOMBSTONES and not USE_ORAM)
+	{
+		LOG(WARNING, L"The tombstone mode requires ORAMs. Setting USE_TOMBSTONES to false.");
+		USE_TOMBSTONES=false;
+	}
+
+	if (USE_TOMBSTONES and (TOMBSTONE_RATIO<=0 or TOMBSTONE_RATIO>1))
+	{
+		LOG(WARNING, L"The tombstone ratio must be in (0,1]. Setting TOMBSTONE_RATIO to 0.25.");
+		TOMBSTONE_RATIO=0.25;
+	}
+
+	if (QUERIES_IN_FLIGHT<1)
+	{
+		LOG(WARNING, L"At least one query has to be in flight. Setting QUERIES_IN_FLIGHT to 1.");
+		QUERIES_IN_FLIGHT=1;
+	}
+
+	if (NUM_REPLICAS<1)
+	{
+		LOG(WARNING, L"Each OSM has at least one copy. Setting NUM_REPLICAS to 1.");
+		NUM_REPLICAS=1;
+	}
+
+	if (NUM_REPLICAS>1 and not USE_ORAM)
+	{
+		LOG(WARNING, L"Replicas require ORAMs. Setting NUM_REPLICAS to 1.");
+		NUM_REPLICAS=1;
+	}
+
+	if (ORAM_CONCURRENCY<1)
+	{
+		LOG(WARNING, L"At least one worker has to query each OSM. Setting ORAM_CONCURRENCY to 1.");
+		ORAM_CONCURRENCY=1;
+	}
+
+	if (ORAM_CONCURRENCY>1 and (not USE_ORAM or INDEX_MODE!=AVL_ONLY))
+	{
+		LOG(WARNING, L"Concurrent access to an OSM requires ORAMs and the index mode AVL_ONLY. Setting ORAM_CONCURRENCY to 1.");
+		ORAM_CONCURRENCY=1;
+	}
+
+	if (AUTO_SHARDING and not USE_ORAM)
+	{
+		LOG(WARNING, L"Auto sharding requires ORAMs. Setting AUTO_SHARDING to false.");
+		AUTO_SHARDING=false;
+	}
+
+	if (USE_SPARE_OSM and (SPARE_OSM_THRESHOLD<=0 or SPARE_OSM_THRESHOLD>1))
+	{
+		LOG(WARNING, L"The threshold for the spare OSM must be in (0,1]. Setting SPARE_OSM_THRESHOLD to 0.75.");
+		SPARE_OSM_THRESHOLD=0.75;
+	}
+
+	if (GROW_LOG_CAPACITY>0 and not USE_ORAM)
+	{
+		LOG(WARNING, L"Growing OSMs requires ORAMs. Setting GROW_LOG_CAPACITY to 0.");
+		GROW_LOG_CAPACITY=0;
+	}
+
+	if (COMPACTION_FILL_RATIO<0 or COMPACTION_FILL_RATIO>=1)
+	{
+		LOG(WARNING, L"The compaction fill ratio must be in [0,1). Setting COMPACTION_FILL_RATIO to 0.");
+		COMPACTION_FILL_RATIO=0.0;
+	}
+
+	if (COMPACTION_FILL_RATIO>0 and not USE_ORAM)
+	{
+		LOG(WARNING, L"Merging underfull OSMs requires ORAMs. Setting COMPACTION_FILL_RATIO to 0.");
+		COMPACTION_FILL_RATIO=0.0;
+	}
+
+	if (USE_SHARD_HANDLES and not USE_ORAM)
+	{
+		LOG(WARNING, L"Record handles require ORAMs. Setting USE_SHARD_HANDLES to false.");
+		USE_SHARD_HANDLES=false;
+	}
+
+	if (HISTOGRAM_FANOUT==1)
+	{
+		LOG(WARNING, L"The histogram fanout must be 0 or at least 2. Setting HISTOGRAM_FANOUT to 0.");
+		HISTOGRAM_FANOUT=0;
+	}
+
+	if (USE_SUBTREE_AGGREGATES and (not USE_ORAM or USE_TOMBSTONES))
+	{
+		LOG(WARNING, L"Subtree aggregates require ORAMs and are not maintained for records marked as deleted. Setting USE_SUBTREE_AGGREGATES to false.");
+		USE_SUBTREE_AGGREGATES=false;
+	}
+
+	if (USE_SUBTREE_AGGREGATES and NUM_ATTRIBUTES <= AGGREGATE_COLUMN)
+	{
+		LOG(WARNING, L"The aggregate column is larger than the number of columns of the table. Setting USE_SUBTREE_AGGREGATES to false.");
+		USE_SUBTREE_AGGREGATES=false;
+	}
+
 	if(dataSourceString!=""){
 		DATASOURCE_T temp=datasourcefromString(dataSourceString);
 		if(temp==DATASOURCE_T::DATASOURCE_T_INVALID){
@@ -392,6 +568,7 @@ void logGlobals(){
 	LOG_PARAMETER(QUERY_INDEX);
 	LOG_PARAMETER(WHERE_INDEX);
 	LOG(INFO,boost::wformat(L"QUERY_FUNCTION = %1%") % (toInt(QUERY_FUNCTION)) );
+	LOG(INFO,L"ADDITIONAL_QUERY_FUNCTIONS: "+toWString(additionalQueryFunctionsToString()));
 	LOG_PARAMETER(POINT_QUERIES);
 	LOG_PARAMETER(NUM_QUERIES);
 	LOG_PARAMETER(MAX_SENSITIVITY);
@@ -403,6 +580,32 @@ void logGlobals(){
 	LOG_PARAMETER(STASH_FACTOR);
 	LOG_PARAMETER(USE_ORAM);
 	LOG_PARAMETER(BATCH_SIZE);
+	LOG(INFO,boost::wformat(L"INDEX_MODE = %1%") % (toInt(INDEX_MODE)) );
+	LOG_PARAMETER(LEAF_PAGE_SIZE);
+	LOG_PARAMETER(RANK_REBUILD_THRESHOLD);
+	LOG_PARAMETER(USE_LSM);
+	LOG_PARAMETER(LSM_BUFFER_SIZE);
+	LOG_PARAMETER(LSM_SIZE_RATIO);
+	LOG_PARAMETER(USE_TOMBSTONES);
+	LOG_PARAMETER(TOMBSTONE_RATIO);
+	LOG_PARAMETER(WORKER_POOL_SIZE);
+	LOG_PARAMETER(PIN_WORKERS);
+	LOG_PARAMETER(QUERIES_IN_FLIGHT);
+	LOG_PARAMETER(NUM_REPLICAS);
+	LOG_PARAMETER(ORAM_CONCURRENCY);
+	LOG_PARAMETER(AUTO_SHARDING);
+	LOG_PARAMETER(RAM_BUDGET);
+	LOG_PARAMETER(USE_SPARE_OSM);
+	LOG_PARAMETER(SPARE_OSM_THRESHOLD);
+	LOG_PARAMETER(GROW_LOG_CAPACITY);
+	LOG_PARAMETER(COMPACTION_FILL_RATIO);
+	LOG_PARAMETER(USE_SHARD_HANDLES);
+	LOG_PARAMETER(SHARD_HANDLE_DUMMIES);
+	LOG_PARAMETER(HISTOGRAM_FANOUT);
+	LOG_PARAMETER(CHECK_HISTOGRAMS);
+	LOG_PARAMETER(USE_SUBTREE_AGGREGATES);
+	LOG_PARAMETER(AGGREGATE_COLUMN);
+	LOG_PARAMETER(STREAM_RESULTS);
 	LOG_PARAMETER(DP_K);
 	LOG_PARAMETER(DP_BETA);
 	LOG_PARAMETER(DP_EPSILON);
@@ -31,6 +31,7 @@ void prepareDOSM(){
 
 
 		long long overheadTotal=0;
+		long long overheadTotalDel=0;
 
 		if (DATASOURCE!=CROWD){
 
@@ -85,13 +86,16 @@ void prepareDOSM(){
 					LOG(TRACE, boost::wformat(L"Removing the %d th  datapoint: { duration %7s}") 
 									%(int)i
 									% timeToString(overheadPutDel)); 
+					overheadTotalDel=overheadTotalDel+overheadPutDel;
 					MENHIR::DELETION_MEASUREMENTS->push_back(overheadPutDel);
 				}
 
 			}
+			INTERFACE->prepareQuerying(); //merges of the LSM mode have to be installed and the OSMs are copied before querying starts
 
 			long long overheadMean=overheadTotal/(int) NUM_DATAPOINTS;
 			MENHIR::INSERTION_TOTAL=overheadTotal;
+			MENHIR::DELETION_TOTAL=overheadTotalDel;
 			LOG(TRACE, boost::wformat(L"Put %d datapoints: { duration %7s, mean %7s}") 
 							%(int)NUM_DATAPOINTS
 							% timeToString(overheadTotal) 
@@ -100,6 +104,11 @@ void prepareDOSM(){
 							%(int)NUM_DATAPOINTS
 							% timeToString(overheadTotal) 
 							% timeToString(overheadMean));		
+			if(MENHIR::INSERTION_MEASUREMENTS->size()>0){
+				LOG(INFO, boost::wformat(L"Throughput: %d inserts/s, %d deletes/s") 
+								%getThroughput(MENHIR::INSERTION_MEASUREMENTS)
+								%getThroughput(MENHIR::DELETION_MEASUREMENTS));
+			}
 			LOG(INFO,L"Finished inserting Datapoints");
 
 		}
@@ -9,6 +9,8 @@
 
 #include <chrono>
 #include <ctime>
+#include <deque>
+#include <mutex>
 #include <numeric>
 #include <signal.h> //for chatching SIGINT
 #include <string>
@@ -23,27 +25,54 @@ using namespace std;
 using namespace DBT;
 namespace MENHIR{
 
+	//noise sampling and the privacy budget are shared by all queries, so only the access to the OSMs runs concurrently
+	mutex queryLock;
+
 	/**
 	 * @brief This function processes a query. 
 	 * It first determins the noise required for volume padding for the query to ge executed.
 	 * Then it executes a query by calling the corresponding function of the OSM Interface.
 	 * With the results, the corrsponding query function is called to compute a differentially private aggregate.
+	 * Several queries can run at the same time (e.g. from the threads of the RPC server), only the access to the OSMs is executed concurrently.
+	 * Only the aggregate defined by the query itself is returned, see runMultiQuery() for queries with additional outputs.
 	 * 
 	 * @param query 
 	 * @return tuple<db_t, double,Error> : Tuple containing the differentially private aggregate as db_t or double (depending on the function) or, if an Error occurred, the corrsponding information on the error. 
 	 */
 	tuple<db_t, double,Error> runQuery(Query query){
-		
+		return runMultiQuery(query)[0];
+	}
+
+	/**
+	 * @brief Processes a query as runQuery() and returns the aggregate of the query followed by one aggregate for each entry of query.outputs. 
+	 * The records are retrieved only once and all aggregates are computed from them.
+	 * 
+	 * @param query 
+	 * @return vector<tuple<db_t, double,Error>> : one tuple per output as returned by runQuery(). If the query could not be answered, all tuples contain the Error.
+	 */
+	vector<tuple<db_t, double,Error>> runMultiQuery(Query query){
+		size_t numOutputs=1+query.outputs.size();
+		unique_lock<mutex> guard(queryLock);
+		if(answeredByAggregates(query) and isQuantile(query)){
+			//every step of the search samples noise, so the lock is kept
+			return {computeQuantileAggregates(query, nullptr)};
+		}else if(answeredByAggregates(query)){
+			guard.unlock();
+			auto[count,sum]=INTERFACE->aggregateInterval(query.whereFrom, query.whereTo, query.whereIndex);
+			guard.lock();
+			return {computeQueryFunctionAggregates(query, count, sum)};
+		}
+
 		auto[estimate,noiseToAdd, err]=getTotalNoise(query);
 		if(err.code!=0){
 			//This clauses catches cases where the DP tree is not deep enough
-			return make_tuple(db_t(0),0.0,err);
+			return vector<tuple<db_t,double,Error>>(numOutputs, make_tuple(db_t(0),0.0,err));
 	
 		}
 
 		if(estimate==0){
 	        Error err=Error(400,L"The query could not be answered as it was estimated that no elements with in this range apply. This could be because to little data has been collected.");
-			return make_tuple(db_t(0),0.0,err);
+			return vector<tuple<db_t,double,Error>>(numOutputs, make_tuple(db_t(0),0.0,err));
 		
 		}
 		
@@ -57,43 +86,33 @@ namespace MENHIR{
 			estimate=RETRIEVE_EXACTLY_NOW;
 		}
 
-		auto allRecords=INTERFACE->findInterval(query.whereFrom, query.whereTo, query.whereIndex, noiseToAdd);//
-		
-
-				
-		vector<db_t> values=vector<db_t>();
-		vector<bool> ignoring=vector<bool>();
-		for(size_t i=0;i<allRecords.size();i++){
-			vector<db_t> record;
-			bool dummy=false;
-			tie(record,dummy)=allRecords[i];
-			values.push_back(record[query.attributeIndex]);
-			bool padding =(record[query.whereIndex]>query.whereTo or record[query.whereIndex]<query.whereFrom);
-			dummy=padding*true+ (not padding)* dummy;
-			ignoring.push_back(dummy);
+		if(streamable(query)){
+			guard.unlock();
+			auto[aggregates, counts]=scanQuery(query, noiseToAdd, nullptr);
+			guard.lock();
+			return computeStreamedOutputs(query, aggregates);
 		}
 
-		auto ret=computeQueryFunctionPrivate(query,values,ignoring);
-		return ret;
+		shared_ptr<PendingQuery> pending=INTERFACE->submitFindInterval(query.whereFrom, query.whereTo, query.whereIndex, noiseToAdd, QueryTiming());
+		guard.unlock();
+		auto allRecords=INTERFACE->collectFindInterval(pending);
+		guard.lock();
+
+		return computeQueryOutputs(query, allRecords);
 	}
 
 	/**
-	 * @brief This function processes a query in the setting of automated evaluation.
-	 * It first determins the noise required for volume padding for the query to ge executed.
-	 * Then it executes a query by calling the corresponding function of the OSM Interface.
-	 * With the results, the corrsponding query function is called to compute a differentially private aggregate.
+	 * @brief Determines the noise for a query in the setting of automated evaluation. This is the part of runQueryEval() before the OSMs are accessed.
 	 * 
 	 * @param query 
-	 * @return tuple<number,dbResponse,Error> : Tuple containing the differentially private aggregate as db_t or double (depending on the function) or, if an Error occurred, the corrsponding information on the error. 
+	 * @return tuple<number,vector<number>,Error> : total number of additional data points, the number for each OSM and an Error if the query can not be answered
 	 */
-	tuple<number,dbResponse,Error> runQueryEval(Query query){
-
-		dbResponse allRecords;
+	tuple<number,vector<number>,Error> getQueryEstimate(Query query){
 
 		auto[estimate,noiseToAdd, err]=getTotalNoise(query);
 		if(err.code!=0){
 			//This clauses catches cases where the DP tree is not deep enough
-			return make_tuple((number)0, allRecords,err);
+			return make_tuple((number)0, noiseToAdd, err);
 
 		}
 
@@ -103,7 +122,7 @@ namespace MENHIR{
 			wstring errString=L"The query could not be answered as it was estimated that no elements with in this range apply. This could be because to little data has been collected.";
 	        Error err=Error(errString);
 			LOG(ERROR, err.err_string);
-			return make_tuple(estimate,allRecords,err);
+			return make_tuple(estimate,noiseToAdd,err);
 		}
 
 		if(RETRIEVE_EXACTLY.size()!=0){
@@ -113,28 +132,321 @@ namespace MENHIR{
                 noiseToAdd.push_back(RETRIEVE_EXACTLY_NOW);
             }
 		}
+		return make_tuple(estimate, noiseToAdd, Error());
+	}
+
+	/**
+	 * @brief Computes the differentially private aggregate for the records returned for a query in the setting of automated evaluation. 
+	 * This is the part of runQueryEval() after the OSMs were accessed.
+	 * 
+	 * @param query 
+	 * @param allRecords : vector of data as returned by the OSMInterface 
+	 */
+	void finishQueryEval(Query query, dbResponse allRecords){
+		computeQueryOutputs(query, allRecords);
+	}
+
+	/**
+	 * @brief Checks wether all aggregates of a query can be computed while the records are read from the OSMs (see STREAM_RESULTS). 
+	 * This is the case for COUNT, SUM and MEAN. The other functions need several passes over the records or all values at once.
+	 * 
+	 * @param query 
+	 * @return true 
+	 * @return false 
+	 */
+	bool streamable(Query query){
+		if(not STREAM_RESULTS or RETRIEVE_EXACTLY.size()!=0){
+			return false;
+		}
+		for(QueryOutput output : getQueryOutputs(query)){
+			if(output.agg!=AggregateFunc::COUNT and output.agg!=AggregateFunc::SUM and output.agg!=AggregateFunc::MEAN){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Reads the records of the WHERE range of a query from all OSMs and adds them to one StreamingAggregate per output of the query without storing them.
+	 * Each OSM fills its own aggregates, which are merged after all OSMs finished.
+	 * 
+	 * @param query 
+	 * @param noiseToAdd : number of dummies for each OSM
+	 * @param timing : if not null, beforeORAMs and afterORAMs are set in this timing context
+	 * @return tuple<vector<StreamingAggregate>,ScanCounts> : one aggregate per output (see getQueryOutputs()) and the number of returned records for the measurements
+	 */
+	tuple<vector<StreamingAggregate>,ScanCounts> scanQuery(Query query, vector<number> noiseToAdd, QueryTiming *timing){
+		vector<QueryOutput> outputs=getQueryOutputs(query);
+		vector<StreamingAggregate> empty;
+		for(QueryOutput output : outputs){
+			empty.push_back(StreamingAggregate(COLUMN_FORMAT[output.attributeIndex], MIN_VALUE[output.attributeIndex], MAX_VALUE[output.attributeIndex]));
+		}
+		vector<vector<StreamingAggregate>> aggregatesPerOSM(INTERFACE->numOSMs, empty);
+		vector<ScanCounts> countsPerOSM(INTERFACE->numOSMs, ScanCounts{0, 0, 0});
+
+		vector<recordVisitor> visitors;
+		for(size_t i=0;i<INTERFACE->numOSMs;i++){
+			vector<StreamingAggregate> &aggregates=aggregatesPerOSM[i];
+			ScanCounts &counts=countsPerOSM[i];
+			visitors.push_back([&query, &outputs, &aggregates, &counts](const vector<db_t> &record, bool dummy){
+				bool padding =(record[query.whereIndex]>query.whereTo or record[query.whereIndex]<query.whereFrom);
+				bool ignore=padding or dummy;
+				for(size_t o=0;o<outputs.size();o++){
+					aggregates[o].add(record[outputs[o].attributeIndex], ignore);
+				}
+				counts.records++;
+				counts.noise+=dummy;
+				counts.padding+=(not dummy) and (record[query.attributeIndex]>query.to or record[query.attributeIndex]<query.from);
+			});
+		}
+		INTERFACE->scanInterval(query.whereFrom, query.whereTo, query.whereIndex, noiseToAdd, visitors, timing);
+
+		vector<StreamingAggregate> aggregates=empty;
+		ScanCounts counts={0, 0, 0};
+		for(size_t i=0;i<INTERFACE->numOSMs;i++){
+			for(size_t o=0;o<outputs.size();o++){
+				aggregates[o].merge(aggregatesPerOSM[i][o]);
+			}
+			counts.records+=countsPerOSM[i].records;
+			counts.padding+=countsPerOSM[i].padding;
+			counts.noise+=countsPerOSM[i].noise;
+		}
+		return make_tuple(aggregates, counts);
+	}
+
+	/**
+	 * @brief Computes the differentially private aggregates of a query from the aggregates filled by scanQuery(). 
+	 * The noise is added with the same sensitivity as for the subtree aggregates (see computeQueryFunctionAggregates()).
+	 * 
+	 * @param query 
+	 * @param aggregates : one per output
+	 * @return vector<tuple<db_t,double, Error>> : one tuple per output
+	 */
+	vector<tuple<db_t,double, Error>> computeStreamedOutputs(Query query, vector<StreamingAggregate> aggregates){
+		vector<QueryOutput> outputs=getQueryOutputs(query);
+		vector<tuple<db_t,double, Error>> results;
+		for(size_t o=0;o<outputs.size();o++){
+			uint index=outputs[o].attributeIndex;
+			const StreamingAggregate &aggregate=aggregates[o];
+			double result_d=0;
+			Error err;
+			if(outputs[o].agg == AggregateFunc::SUM){
+				tie(result_d, err)=dp_sum_aggregate(aggregate.getSum(), aggregate.type, outputs[o].epsilon, MIN_VALUE[index], MAX_VALUE[index]);
+			}else if(outputs[o].agg == AggregateFunc::MEAN){
+				tie(result_d, err)=dp_mean_aggregate(aggregate.count, aggregate.getSum(), aggregate.type, outputs[o].epsilon, MIN_VALUE[index], MAX_VALUE[index]);
+			}else{
+				tie(result_d, err)=dp_count_aggregate(aggregate.count, outputs[o].epsilon);
+			}
+			results.push_back(make_tuple(db_t(0), result_d, err));
+		}
+		return results;
+	}
 
-		allRecords=INTERFACE->findInterval(query.whereFrom, query.whereTo, query.whereIndex, noiseToAdd);
+	/**
+	 * @brief Processes a streamable query (see streamable()) in the setting of automated evaluation. 
+	 * 
+	 * @param query 
+	 * @param timing : timing context of the query, the timestamps for accessing the OSMs are set
+	 * @return tuple<number,ScanCounts,Error> : number of dummy data points, the number of returned records and an Error if the query can not be answered
+	 */
+	tuple<number,ScanCounts,Error> runQueryStreamedEval(Query query, QueryTiming *timing){
+		auto[estimate,noiseToAdd, err]=getQueryEstimate(query);
+		if(err.code!=0){
+			return make_tuple(estimate, ScanCounts{0, 0, 0}, err);
+		}
+		auto[aggregates, counts]=scanQuery(query, noiseToAdd, timing);
+		computeStreamedOutputs(query, aggregates);
+		return make_tuple(estimate, counts, Error());
+	}
 
-		vector<db_t> values=vector<db_t>();
+	/**
+	 * @brief Returns all aggregates a query asks for: the one defined by the query itself followed by query.outputs.
+	 * 
+	 * @param query 
+	 * @return vector<QueryOutput> 
+	 */
+	vector<QueryOutput> getQueryOutputs(Query query){
+		vector<QueryOutput> outputs={QueryOutput{query.attributeIndex, query.agg, query.epsilon, query.extra}};
+		outputs.insert(outputs.end(), query.outputs.begin(), query.outputs.end());
+		return outputs;
+	}
+
+	/**
+	 * @brief Computes all aggregates of a query (see getQueryOutputs()) from the records returned for its WHERE range. 
+	 * Each aggregate is computed by computeQueryFunctionPrivate() and consumes its own epsilon, so an output for which the budget does not suffice
+	 * returns an Error without affecting the other outputs.
+	 * 
+	 * @param query 
+	 * @param allRecords : vector of data as returned by the OSMInterface 
+	 * @return vector<tuple<db_t,double, Error>> : one tuple per output
+	 */
+	vector<tuple<db_t,double, Error>> computeQueryOutputs(Query query, dbResponse allRecords){
 		vector<bool> ignoring=vector<bool>();
-		
-		ostringstream oss;
 		for(size_t i=0;i<allRecords.size();i++){
 			bool dummy=false;
 			vector<db_t> record;
 			tie(record,dummy)=allRecords[i];
-			values.push_back(record[query.attributeIndex]);
 			bool padding =(record[query.whereIndex]>query.whereTo or record[query.whereIndex]<query.whereFrom);
 			dummy=padding*true+ (not padding)* dummy;
 			ignoring.push_back(dummy);
 		}
 
-		computeQueryFunctionPrivate(query,values,ignoring);
+		vector<tuple<db_t,double, Error>> results;
+		for(QueryOutput output : getQueryOutputs(query)){
+			Query single=query;
+			single.outputs.clear();
+			if(output.attributeIndex!=query.attributeIndex){
+				//from and to refer to the column of the query
+				single.from=MIN_VALUE[output.attributeIndex];
+				single.to=MAX_VALUE[output.attributeIndex];
+			}
+			single.attributeIndex=output.attributeIndex;
+			single.agg=output.agg;
+			single.epsilon=output.epsilon;
+			single.extra=output.extra;
+
+			vector<db_t> values=vector<db_t>();
+			for(size_t i=0;i<allRecords.size();i++){
+				values.push_back(get<0>(allRecords[i])[output.attributeIndex]);
+			}
+			results.push_back(computeQueryFunctionPrivate(single,values,ignoring));
+		}
+		return results;
+	}
+
+	/**
+	 * @brief This function processes a query in the setting of automated evaluation.
+	 * It first determins the noise required for volume padding for the query to ge executed.
+	 * Then it executes a query by calling the corresponding function of the OSM Interface.
+	 * With the results, the corrsponding query function is called to compute a differentially private aggregate.
+	 * 
+	 * @param query 
+	 * @param timing : timing context of the query, the timestamps for accessing the OSMs are set
+	 * @return tuple<number,dbResponse,Error> : Tuple containing the differentially private aggregate as db_t or double (depending on the function) or, if an Error occurred, the corrsponding information on the error. 
+	 */
+	tuple<number,dbResponse,Error> runQueryEval(Query query, QueryTiming *timing){
+
+		dbResponse allRecords;
+
+		if(answeredByAggregates(query) and isQuantile(query)){
+			computeQuantileAggregates(query, timing);
+			return make_tuple((number) 0, allRecords, Error());
+		}else if(answeredByAggregates(query)){
+			//no records are retrieved, so there are no dummy data points
+			auto[count,sum]=INTERFACE->aggregateInterval(query.whereFrom, query.whereTo, query.whereIndex, timing);
+			computeQueryFunctionAggregates(query, count, sum);
+			return make_tuple((number) 0, allRecords, Error());
+		}
+
+		auto[estimate,noiseToAdd, err]=getQueryEstimate(query);
+		if(err.code!=0){
+			return make_tuple(estimate, allRecords,err);
+		}
+
+		allRecords=INTERFACE->findInterval(query.whereFrom, query.whereTo, query.whereIndex, noiseToAdd, timing);
+		finishQueryEval(query, allRecords);
 		Error noErr=Error();
 		return make_tuple(estimate, allRecords, noErr);
 	}
 
+	/**
+	 * @brief Checks wether a query is answered from the subtree aggregates of the OSMs (see USE_SUBTREE_AGGREGATES) instead of retrieving the records.
+	 * This is the case for COUNT, for SUM and MEAN over AGGREGATE_COLUMN and for quantiles of the column the range is defined on, if the query has no additional outputs.
+	 * 
+	 * @param query 
+	 * @return true 
+	 * @return false 
+	 */
+	bool answeredByAggregates(Query query){
+		if(not query.outputs.empty()){
+			//all outputs are computed from one retrieval
+			return false;
+		}
+		bool sumOfColumn=(query.agg==AggregateFunc::SUM or query.agg==AggregateFunc::MEAN) and query.attributeIndex==AGGREGATE_COLUMN;
+		bool quantileOfColumn=isQuantile(query) and query.attributeIndex==query.whereIndex;
+		return USE_SUBTREE_AGGREGATES and RETRIEVE_EXACTLY.size()==0 and (query.agg==AggregateFunc::COUNT or sumOfColumn or quantileOfColumn);
+	}
+
+	/**
+	 * @brief Checks wether the query asks for a quantile (MEDIAN or PERCENTILE).
+	 * 
+	 * @param query 
+	 * @return true 
+	 * @return false 
+	 */
+	bool isQuantile(Query query){
+		return query.agg==AggregateFunc::MEDIAN or query.agg==AggregateFunc::PERCENTILE;
+	}
+
+	/**
+	 * @brief Returns the fraction of the records that lie at or below the quantile asked for by the query. 
+	 * For PERCENTILE, query.extra is the percentile and is clipped to [0,100].
+	 * 
+	 * @param query 
+	 * @return double 
+	 */
+	double getQuantileFraction(Query query){
+		if(query.agg==AggregateFunc::PERCENTILE){
+			return min(max(query.extra, 0), 100)/100.0;
+		}
+		return 0.5;
+	}
+
+	/**
+	 * @brief Computes a differentially private quantile of the column the range is defined on from the subtree counts of the OSMs. 
+	 * The quantile is found by a noisy binary search over the domain (see dp_quantile()). The records below the range are counted once, afterwards each step counts the records up to the candidate with one padded descent per OSM.
+	 * Selecting the record with a given rank directly would reveal a data value, the search only reveals noisy counts.
+	 * 
+	 * @param query 
+	 * @param timing : timing context of the query, may be nullptr
+	 * @return tuple<db_t,double, Error> 
+	 */
+	tuple<db_t,double, Error> computeQuantileAggregates(Query query, QueryTiming *timing){
+		uint index=query.whereIndex;
+		AType type=COLUMN_FORMAT[index];
+		double lower=max(toDouble(MIN_VALUE[index]), toDouble(query.whereFrom));
+		double upper=min(toDouble(MAX_VALUE[index]), toDouble(query.whereTo));
+		double fraction=getQuantileFraction(query);
+
+		//the records below the start of the range are the same for every step of the search, so they are only counted once
+		number prefix=get<0>(INTERFACE->aggregateBelow(query.whereFrom, false, index, timing));
+		number upToEnd=get<0>(INTERFACE->aggregateBelow(query.whereTo, true, index));
+		number total=_IF_THEN((upToEnd>=prefix), (upToEnd-prefix), 0ull);
+		auto rankDifference=[&](double mid){
+			number upToMid=get<0>(INTERFACE->aggregateBelow(fromDouble(mid, type), true, index));
+			number count=_IF_THEN((upToMid>=prefix), (upToMid-prefix), 0ull);
+			return (double) count-fraction*(double) total;
+		};
+		auto[result_d, err]=dp_quantile(rankDifference, lower, upper, toDouble(DATA_RESOLUTION[index]), query.epsilon);
+		if(timing!=nullptr){
+			timing->afterORAMs=chrono::steady_clock::now();
+		}
+		return make_tuple(fromDouble(result_d, type), result_d, err);
+	}
+
+	/**
+	 * @brief Computes the differentially private aggregate for a query that is answered from the subtree aggregates (see answeredByAggregates()). 
+	 * The noise is added to the final answer with the same sensitivity as in computeQueryFunctionPrivate().
+	 * 
+	 * @param query 
+	 * @param count : exact number of records in the queried interval
+	 * @param sum : exact sum of AGGREGATE_COLUMN over the records in the queried interval
+	 * @return tuple<db_t,double, Error> 
+	 */
+	tuple<db_t,double, Error> computeQueryFunctionAggregates(Query query, number count, double sum){
+		double result_d=0;
+		Error err;
+		AType type=COLUMN_FORMAT[query.attributeIndex];
+		if(query.agg == AggregateFunc::SUM){
+			tie(result_d, err)=dp_sum_aggregate(sum, type, query.epsilon, MIN_VALUE[query.attributeIndex], MAX_VALUE[query.attributeIndex]);
+		}else if(query.agg == AggregateFunc::MEAN){
+			tie(result_d, err)=dp_mean_aggregate(count, sum, type, query.epsilon, MIN_VALUE[query.attributeIndex], MAX_VALUE[query.attributeIndex]);
+		}else{
+			tie(result_d, err)=dp_count_aggregate(count, query.epsilon);
+		}
+		return make_tuple(db_t(0), result_d, err);
+	}
+
 	/**
 	 * @brief Depending on the aggregate type set in the query, this function calls the corresponding differentially private aggregate function for the passed data.
 	 * 
@@ -211,6 +523,26 @@ namespace MENHIR{
 			int width = DATA_RESOLUTION[query.attributeIndex].val.i;
 			tie(result_dbt,err)= report_noisy_min_finite_int( values, ignoring,upper, lower, query.epsilon, width, query.extra);
 
+		}else if(isQuantile(query)){
+			//returns an element!
+			double fraction=getQuantileFraction(query);
+			vector<double> data=vecToDouble(values);
+			number total=0;
+			for(size_t i=0;i<data.size();i++){
+				total+=not ignoring[i];
+			}
+			auto rankDifference=[&](double mid){
+				number count=0;
+				for(size_t i=0;i<data.size();i++){
+					count+=(data[i]<=mid) and not ignoring[i];
+				}
+				return (double) count-fraction*(double) total;
+			};
+			double lower=toDouble(MIN_VALUE[query.attributeIndex]);
+			double upper=toDouble(MAX_VALUE[query.attributeIndex]);
+			tie(result_d, err)=dp_quantile(rankDifference, lower, upper, toDouble(DATA_RESOLUTION[query.attributeIndex]), query.epsilon);
+			result_dbt=fromDouble(result_d, COLUMN_FORMAT[query.attributeIndex]);
+
 		}else{
 			err=Error(boost::wformat(L"No valid aggregation function set for Query "\
 				"%s. Setting results to zero.") 
@@ -223,11 +555,13 @@ namespace MENHIR{
 	/**
 	 * @brief Runs a set of QUERIES which are either read from file or generated synthetically. 
 	*  Conducts extensive measurements to assess runtime overhead.
+	*  Up to QUERIES_IN_FLIGHT queries are dispatched to the OSMs before the results of the oldest one are collected, 
+	*  so the workers of the OSMs serve the queries in a pipelined fashion.
 	 * 
 	 */
 	void automated_querying(){
 
-		LOG(INFO, boost::wformat(L"Running %1% QUERIES...") % QUERIES.size());
+		LOG(INFO, boost::wformat(L"Running %1% QUERIES (%2% in flight)...") % QUERIES.size() % QUERIES_IN_FLIGHT);
 
 		// setup Ctrl+C (SIGINT) handler
 		/*struct sigaction sigIntHandler;
@@ -245,7 +579,11 @@ namespace MENHIR{
 		sigaction(SIGINT, &sigIntHandler, NULL);
 		*/
 		int q=0;
+		int maxTries=5;
+		chrono::steady_clock::time_point startQuerying = chrono::steady_clock::now();
 
+		//queries that were dispatched to the OSMs, in the order of admission
+		deque<tuple<Query,int,number,shared_ptr<PendingQuery>>> inFlight;
 
 		for (auto query : QUERIES){
 			
@@ -259,19 +597,38 @@ namespace MENHIR{
 
 			LOG(DEBUG, L"Query: "+toWString(queryToString(query)));
 
-			int maxTries=5;
-
 			for(int j=0;j<maxTries;j++){
 				try{
-					startTimeQuery = chrono::steady_clock::now();
-					auto[estimate,allRecords,err]=runQueryEval(query);
-					endTimeQuery = chrono::steady_clock::now();
+					QueryTiming timing;
+					timing.start = chrono::steady_clock::now();
+					if(answeredByAggregates(query)){
+						//padded descents in the OSMs, the query is answered right away instead of being pipelined
+						auto[estimate,allRecords,err]=runQueryEval(query, &timing);
+						timing.end = chrono::steady_clock::now();
+						processMeasurement(query, q, estimate, allRecords, timing);
+						break;
+					}
+					if(streamable(query)){
+						//the records are not stored, so the query is answered right away instead of being pipelined
+						auto[estimate,counts,err]=runQueryStreamedEval(query, &timing);
+						timing.end = chrono::steady_clock::now();
+						if(err.code!=0){
+							LOG(ERROR, err.err_string);
+							LOG(ERROR, L"Caught error for when running query. This query will be skipped. No data is added to the output.");
+						}else{
+							processMeasurement(query, q, estimate, counts, timing);
+							break;
+						}
+						continue;
+					}
+					auto[estimate,noiseToAdd,err]=getQueryEstimate(query);
 
 					if(err.code!=0){
 						LOG(ERROR, err.err_string);
 						LOG(ERROR, L"Caught error for when running query. This query will be skipped. No data is added to the output.");
 					}else{
-						processMeasurement(query,q, estimate,allRecords);
+						shared_ptr<PendingQuery> pending=INTERFACE->submitFindInterval(query.whereFrom, query.whereTo, query.whereIndex, noiseToAdd, timing);
+						inFlight.push_back(make_tuple(query, q, estimate, pending));
 						break;
 					}
 				}catch (const std::exception &exc) { 
@@ -283,8 +640,76 @@ namespace MENHIR{
 					LOG(ERROR,errString);
 				}
 			}
+
+			while(inFlight.size()>=QUERIES_IN_FLIGHT){
+				finishOldestQuery(&inFlight, maxTries);
+			}
 			
 		}
+		while(not inFlight.empty()){
+			finishOldestQuery(&inFlight, maxTries);
+		}
+
+		QUERYING_TOTAL = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - startQuerying).count();
+		LOG(INFO, boost::wformat(L"Answered %d queries in %s (%d queries/s)") 
+				% QUERY_MEASUREMENTS->size() 
+				% timeToString(QUERYING_TOTAL) 
+				% (QUERYING_TOTAL > 0 ? QUERY_MEASUREMENTS->size() * 1000000000uLL / QUERYING_TOTAL : 0));
+		if(AUTO_SHARDING){
+			LOG(INFO, boost::wformat(L"Time in the OSMs per query: predicted %s, measured %s") 
+					% timeToString(PREDICTED_QUERY_TIME) 
+					% timeToString(avg([](measurement v) { return get<1>(v); }).second));
+		}
+	}
+
+	/**
+	 * @brief Subfunction of automated_querying(). Collects the results of the oldest query in flight, computes the aggregate and processes the measurements. 
+	 * If an exception occurs, the query is repeated without pipelining.
+	 * 
+	 * @param inFlight : queries that were dispatched to the OSMs, the first one is removed
+	 * @param maxTries : how often the query is tried in total
+	 */
+	void finishOldestQuery(deque<tuple<Query,int,number,shared_ptr<PendingQuery>>> *inFlight, int maxTries){
+		auto[query, q, estimate, pending]=inFlight->front();
+		inFlight->pop_front();
+
+		try{
+			dbResponse allRecords=INTERFACE->collectFindInterval(pending);
+			finishQueryEval(query, allRecords);
+			QueryTiming timing=pending->timing;
+			timing.end = chrono::steady_clock::now();
+			processMeasurement(query, q, estimate, allRecords, timing);
+			return;
+		}catch (const std::exception &exc) { 
+			boost::wformat errString= boost::wformat(L" Caught error from Query %3i / %3i. Try %d/%d. No data is added to the output.Error:%s") 
+						% q % QUERIES.size()
+						% 0 % maxTries
+						%toWString(exc.what());
+			LOG(ERROR,errString);
+		}
+
+		for(int j=1;j<maxTries;j++){
+			try{
+				QueryTiming timing;
+				timing.start = chrono::steady_clock::now();
+				auto[estimate,allRecords,err]=runQueryEval(query, &timing);
+				timing.end = chrono::steady_clock::now();
+
+				if(err.code!=0){
+					LOG(ERROR, err.err_string);
+					LOG(ERROR, L"Caught error for when running query. This query will be skipped. No data is added to the output.");
+				}else{
+					processMeasurement(query,q, estimate,allRecords, timing);
+					break;
+				}
+			}catch (const std::exception &exc) { 
+				boost::wformat errString= boost::wformat(L" Caught error from Query %3i / %3i. Try %d/%d. No data is added to the output.Error:%s") 
+							% q % QUERIES.size()
+							% j % maxTries
+							%toWString(exc.what());
+				LOG(ERROR,errString);
+			}
+		}
 	}
 
 	/**
@@ -294,28 +719,11 @@ namespace MENHIR{
 	 * @param q : index of query
 	 * @param estimate : number of dummy data points
 	 * @param allRecords : vector of data as returned by the OSMInterface 
+	 * @param timing : timing context of the query
 	 */
-	void processMeasurement(Query query, int q, number estimate,  dbResponse allRecords){
-		auto queryOverheadBefore = chrono::duration_cast<chrono::nanoseconds>(timestampBeforeORAMs - startTimeQuery).count();
-		auto queryOverheadORAMs	 = chrono::duration_cast<chrono::nanoseconds>(timestampAfterORAMs - timestampBeforeORAMs).count();
-		auto queryOverheadAfter	 = chrono::duration_cast<chrono::nanoseconds>(endTimeQuery- timestampAfterORAMs).count();
-
-				
-				
-		//LOG(INFO,boost::wformat(L"Query: %s") % toWString(queryToString(query)));
-		LOG(INFO, L"Query: "+toWString(queryToString(query)));
-
-		LOG(INFO,boost::wformat(L"Retrieval: number of datapoints %6i noise %d , interval [%s,%s]") 
-					% allRecords.size()
-					% estimate
-					% DBT::toWString(query.whereFrom)
-					% DBT::toWString(query.whereTo));
-
-
-
-		int noise=0;
-		int paddingRecordsNumber=0;
-		ostringstream oss;
+	void processMeasurement(Query query, int q, number estimate,  dbResponse allRecords, QueryTiming timing){
+		number noise=0;
+		number paddingRecordsNumber=0;
 		for(size_t i=0;i<allRecords.size();i++){
 			vector<db_t> record;
 			bool dummy;
@@ -332,12 +740,41 @@ namespace MENHIR{
 				paddingRecordsNumber++;
 			}
 		}	
+		processMeasurement(query, q, estimate, ScanCounts{allRecords.size(), paddingRecordsNumber, noise}, timing);
+	}
+
+	/**
+	 * @brief Subfunction of automated_querying() for processing measurements if only the number of returned records is known (see STREAM_RESULTS). 
+	 * Measurements are stored in global variable QUERY_MEASUREMENTS.
+	 * 
+	 * @param query 
+	 * @param q : index of query
+	 * @param estimate : number of dummy data points
+	 * @param counts : number of returned records, padding records and dummies
+	 * @param timing : timing context of the query
+	 */
+	void processMeasurement(Query query, int q, number estimate, ScanCounts counts, QueryTiming timing){
+		auto queryOverheadBefore = chrono::duration_cast<chrono::nanoseconds>(timing.beforeORAMs - timing.start).count();
+		auto queryOverheadORAMs	 = chrono::duration_cast<chrono::nanoseconds>(timing.afterORAMs - timing.beforeORAMs).count();
+		auto queryOverheadAfter	 = chrono::duration_cast<chrono::nanoseconds>(timing.end- timing.afterORAMs).count();
+				
+		//LOG(INFO,boost::wformat(L"Query: %s") % toWString(queryToString(query)));
+		LOG(INFO, L"Query: "+toWString(queryToString(query)));
+
+		LOG(INFO,boost::wformat(L"Retrieval: number of datapoints %6i noise %d , interval [%s,%s]") 
+					% counts.records
+					% estimate
+					% DBT::toWString(query.whereFrom)
+					% DBT::toWString(query.whereTo));
+
+		number noise=counts.noise;
+		number paddingRecordsNumber=counts.padding;
 				
-		auto realRecordsNumber = allRecords.size()-noise-paddingRecordsNumber;
-		auto elapsed = chrono::duration_cast<chrono::nanoseconds>(endTimeQuery - startTimeQuery).count();
+		auto realRecordsNumber = counts.records-noise-paddingRecordsNumber;
+		auto elapsed = chrono::duration_cast<chrono::nanoseconds>(timing.end - timing.start).count();
 				
 		if(estimate>0){
-			QUERY_MEASUREMENTS->push_back({elapsed, queryOverheadORAMs,queryOverheadBefore,queryOverheadAfter, realRecordsNumber, paddingRecordsNumber, noise,  allRecords.size()});
+			QUERY_MEASUREMENTS->push_back({elapsed, queryOverheadORAMs,queryOverheadBefore,queryOverheadAfter, realRecordsNumber, paddingRecordsNumber, noise,  counts.records});
 		}
 
 
@@ -347,7 +784,7 @@ namespace MENHIR{
 				% realRecordsNumber
 				% paddingRecordsNumber
 				% noise 
-				% allRecords.size()
+				% counts.records
 				% timeToString(elapsed) 
 				% (realRecordsNumber > 0 ? timeToString(elapsed / realRecordsNumber) : L"0 ns"));
 
@@ -366,7 +803,7 @@ namespace MENHIR{
 	 */
 	tuple<number, vector<number>,Error> getNoisePointQuery(Query query){
 		uint index=query.whereIndex; //index
-		VolumeSanitizer np=INTERFACE->volumeSanitizers[index];
+		const VolumeSanitizer &np=INTERFACE->volumeSanitizers[index];
 
 		vector<number> noiseToAdd;
 		number totalNoise=0;
@@ -397,7 +834,7 @@ namespace MENHIR{
 	 */
 	tuple<vector<pair<number,number>>,Error> getNoiseNodesForRangeQuery(Query query){
 		uint i=query.whereIndex; //index
-		VolumeSanitizer np=INTERFACE->volumeSanitizers[i];
+		const VolumeSanitizer &np=INTERFACE->volumeSanitizers[i];
 		double n_min= toDouble(MIN_VALUE[i]);
 		double n_max=toDouble(MAX_VALUE[i]);
 		double resolution=toDouble(DATA_RESOLUTION[i]);
@@ -478,7 +915,7 @@ namespace MENHIR{
 		number totalNoise=0ull;
 
 		if (USE_GAMMA){
-			VolumeSanitizer np=INTERFACE->volumeSanitizers[query.whereIndex]; //for each column and each osm there is one sanitizer
+			const VolumeSanitizer &np=INTERFACE->volumeSanitizers[query.whereIndex]; //for each column and each osm there is one sanitizer
 			number kZeroTilda;
 			vector<number> totalPerOSM;
 			tie(kZeroTilda,totalPerOSM) = INTERFACE->getTotalFromHistograms(query.whereFrom ,query.whereTo, query.whereIndex);
@@ -488,7 +925,7 @@ namespace MENHIR{
 				}
 			}
 			for (auto node : noiseNodes){
-				kZeroTilda += np.noises[node];
+				kZeroTilda += np.noises->get(node);
 			}
 			if (kZeroTilda == 0){
 				LOG(CRITICAL, L"Something is wrong, kZeroTilda cannot be 0.");
@@ -503,11 +940,12 @@ namespace MENHIR{
 			}
 		}else{
 			for(size_t osmIndex=0;osmIndex<INTERFACE->numOSMs;osmIndex++){
-				VolumeSanitizer np=INTERFACE->volumeSanitizers[query.whereIndex+osmIndex*NUM_ATTRIBUTES]; //for each column and each osm there is one sanitizer
+				const NoiseTree &noises=*INTERFACE->volumeSanitizers[query.whereIndex+osmIndex*NUM_ATTRIBUTES].noises; //for each column and each osm there is one sanitizer
 				number extra=0ull;
 				for (auto node : noiseNodes){
-					extra += np.noises[node];
-					totalNoise+=np.noises[node];
+					number noise=noises.get(node);
+					extra += noise;
+					totalNoise+=noise;
 				}
 				noiseToAdd.push_back(min(NUM_DATAPOINTS,extra));
 			}
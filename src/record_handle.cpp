@@ -0,0 +1,100 @@
+#include "record_handle.hpp"
+
+/**
+ * @brief This file contains the sealing of the OSM IDs stored in record handles (encrypt-then-MAC).
+ * The OSM ID is encrypted with AES (one block, padded with random bytes) under a fresh IV. The tag is an HMAC-SHA256 over
+ * the nodeHash, the IV and the ciphertext, so a handle cannot be moved to another record.
+ *
+ */
+
+namespace MENHIR{
+
+#define HANDLE_TAG_SIZE 16
+
+/**
+ * @brief Construct a new HandleSealer::HandleSealer object with fresh random keys. Handles are only valid for the sealer that created them.
+ *
+ */
+HandleSealer::HandleSealer(){
+    this->encryptionKey=PathORAM::getRandomBlock(KEYSIZE);
+    this->macKey=PathORAM::getRandomBlock(KEYSIZE);
+}
+
+/**
+ * @brief HMAC-SHA256 under the MAC key over the nodeHash and the passed bytes, truncated to HANDLE_TAG_SIZE bytes.
+ * 
+ * @param nodeHash 
+ * @param first : first byte of the IV and ciphertext
+ * @param last 
+ * @return bytes 
+ */
+bytes HandleSealer::computeTag(size_t nodeHash, bytes::const_iterator first, bytes::const_iterator last){
+    bytes input;
+    for(size_t i=0;i<sizeof(size_t);i++){
+        input.push_back((uchar) (nodeHash>>(8*i)));
+    }
+    input.insert(input.end(), first, last);
+    bytes digest(EVP_MAX_MD_SIZE);
+    unsigned int digestSize=0;
+    if(HMAC(EVP_sha256(), this->macKey.data(), (int) this->macKey.size(), input.data(), input.size(), digest.data(), &digestSize)==nullptr or digestSize<HANDLE_TAG_SIZE){
+        throw std::runtime_error("Computing the tag of a record handle failed.");
+    }
+    return bytes(digest.begin(), digest.begin()+HANDLE_TAG_SIZE);
+}
+
+/**
+ * @brief Creates the handle for a record.
+ *
+ * @param osmID : ID of the OSM that holds the record
+ * @param nodeHash : hash of the record
+ * @return RecordHandle
+ */
+RecordHandle HandleSealer::seal(number osmID, size_t nodeHash){
+    bytes plaintext=PathORAM::getRandomBlock(AES_BLOCK_SIZE);
+    for(size_t i=0;i<sizeof(number);i++){
+        plaintext[i]=(uchar) (osmID>>(8*i));
+    }
+    bytes iv=PathORAM::getRandomBlock(AES_BLOCK_SIZE);
+    bytes ciphertext;
+    PathORAM::encrypt(this->encryptionKey.begin(), this->encryptionKey.end(), iv.begin(), iv.end(), plaintext.begin(), plaintext.end(), ciphertext, ENCRYPT);
+
+    RecordHandle handle;
+    handle.nodeHash=nodeHash;
+    handle.sealedOSM=iv;
+    handle.sealedOSM.insert(handle.sealedOSM.end(), ciphertext.begin(), ciphertext.end());
+    bytes tag=computeTag(nodeHash, handle.sealedOSM.begin(), handle.sealedOSM.end());
+    handle.sealedOSM.insert(handle.sealedOSM.end(), tag.begin(), tag.end());
+    return handle;
+}
+
+/**
+ * @brief Checks the tag of a handle and decrypts the OSM ID.
+ *
+ * @param handle
+ * @return tuple<bool,number> : false if the handle was not created by this sealer or was modified, and the ID of the OSM
+ */
+tuple<bool,number> HandleSealer::open(RecordHandle handle){
+    if(handle.sealedOSM.size()!=2*AES_BLOCK_SIZE+HANDLE_TAG_SIZE){
+        return make_tuple(false, 0ull);
+    }
+    auto tagBegin=handle.sealedOSM.begin()+2*AES_BLOCK_SIZE;
+    bytes tag=computeTag(handle.nodeHash, handle.sealedOSM.begin(), tagBegin);
+    uchar difference=0;
+    for(size_t i=0;i<HANDLE_TAG_SIZE;i++){
+        difference|=tag[i]^tagBegin[i];
+    }
+    if(difference!=0){
+        return make_tuple(false, 0ull);
+    }
+
+    bytes plaintext;
+    auto ivEnd=handle.sealedOSM.begin()+AES_BLOCK_SIZE;
+    PathORAM::encrypt(this->encryptionKey.begin(), this->encryptionKey.end(), handle.sealedOSM.begin(), ivEnd, ivEnd, tagBegin, plaintext, DECRYPT);
+    number osmID=0;
+    for(size_t i=0;i<sizeof(number);i++){
+        osmID|=((number) plaintext[i])<<(8*i);
+    }
+    return make_tuple(true, osmID);
+}
+
+}
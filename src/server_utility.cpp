@@ -7,6 +7,9 @@
 #include "struct_querying.hpp"
 
 #include <rpc/server.h>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
 
 /**
  * @brief This file provides functions for setting up a an rpc server expose certain database functionalities via HTTP.
@@ -20,6 +23,27 @@ using namespace std;
 using namespace STATE_MACHINE;
 
 namespace MENHIR{
+
+	//the rpc server may call the handlers from several threads. Queries hold the lock shared while they access the OSMs,
+	//insertions and phase changes change the OSMs and drop their copies, so they hold it exclusively
+	shared_mutex updateLock;
+
+	/**
+	 * @brief Runs the rpc server. If more than one query may be in flight, QUERIES_IN_FLIGHT threads answer requests, 
+	 * so queries from different clients are pipelined across the OSMs.
+	 * 
+	 */
+	void runServer(){
+		#ifndef SERVERLESS
+		if(QUERIES_IN_FLIGHT>1){
+			srv.async_run(QUERIES_IN_FLIGHT);
+			//the server is only stopped by stopQueryPhase(), which exits the program
+			promise<void>().get_future().wait();
+		}else{
+			srv.run();
+		}
+		#endif
+	}
 	
 
 	/**
@@ -30,7 +54,9 @@ namespace MENHIR{
 	 * @return false 
 	 */
 	bool stopCollectionPhase(string pw){
+		lock_guard<shared_mutex> guard(updateLock);
 		if(pw==PASSWORD){
+			INTERFACE->prepareQuerying(); //merges of the LSM mode have to be installed and the OSMs are copied before querying starts
 			transitionServerState(301);
 			return true;
 		}
@@ -44,6 +70,7 @@ namespace MENHIR{
 	 */
 	void stopQueryPhase(string pw){
 		if(pw==PASSWORD){
+			lock_guard<shared_mutex> guard(updateLock);
 			STATE new_state=transitionServerState(501);
 			if(new_state==CLEANUP){
 				LOG(INFO, L"Storing relevant meansuremnts.");
@@ -54,18 +81,22 @@ namespace MENHIR{
 	}
 
 	/**
-	 * @brief Receives string of data to be inserted into the database. Data is only inserted if it follows the column format.
+	 * @brief Parses one data point from a comma separated string. The data point is only valid if it follows the column format.
 	 * 
 	 * @param datastring 
-	 * @return size_t 
+	 * @return pair<vector<db_t>,bool> : parsed data point and whether it is valid
 	 */
-	size_t receiveDataFromCrowd(string datastring){
+	pair<vector<db_t>,bool> parseCrowdRecord(string datastring){
 		vector<string> vals;
 		boost::algorithm::split(vals, datastring, boost::is_any_of(","));
 		
-		vector<db_t> data(NUM_ATTRIBUTES);
+		vector<db_t> data;
+		data.reserve(NUM_ATTRIBUTES);
 
 		bool validFlag= !(bool) (NUM_ATTRIBUTES-vals.size()); //set to invalid if to many attributes
+		if(!validFlag){
+			return {data, false};
+		}
 		for(int i=0;i<(int)NUM_ATTRIBUTES;i++){
 			string vi=vals[i];
 
@@ -96,20 +127,62 @@ namespace MENHIR{
 			}
 
 		}
+		return {data, validFlag};
+	}
+
+	/**
+	 * @brief Receives string of data to be inserted into the database. Data is only inserted if it follows the column format.
+	 * 
+	 * @param datastring 
+	 * @return size_t 
+	 */
+	size_t receiveDataFromCrowd(string datastring){
+		auto [data, validFlag]=parseCrowdRecord(datastring);
 		//The attacker learns that a submitted data point was valid
 		if(validFlag){
-			
-			if(USE_ORAM){
-				size_t hash=INTERFACE->insert(data);
-				return hash;
-			}else{
-				size_t hash=INTERFACE->insert(data);
-				return hash;
-			}
+			lock_guard<shared_mutex> guard(updateLock);
+			size_t hash=INTERFACE->insert(data);
+			return hash;
 		}
 		return (size_t)0;
-		
+	}
+
+	/**
+	 * @brief Receives a batch of data points separated by ';'. All valid data points are inserted into the database with one batched insertion.
+	 * 
+	 * @param datastring 
+	 * @return vector<size_t> : hashes of the data points in the order of the batch, 0 for invalid data points
+	 */
+	vector<size_t> receiveBatchFromCrowd(string datastring){
+		vector<string> records;
+		boost::algorithm::split(records, datastring, boost::is_any_of(";"));
 
+		vector<vector<db_t>> batch;
+		vector<bool> validFlags;
+		for(string record : records){
+			auto [data, validFlag]=parseCrowdRecord(record);
+			validFlags.push_back(validFlag);
+			if(validFlag){
+				batch.push_back(data);
+			}
+		}
+		vector<size_t> batchHashes;
+		if(batch.size()>0){
+			lock_guard<shared_mutex> guard(updateLock);
+			batchHashes=INTERFACE->insertBatch(batch);
+		}
+		//The attacker learns which submitted data points were valid
+		vector<size_t> hashes;
+		size_t j=0;
+		for(size_t i=0;i<validFlags.size();i++){
+			if(validFlags[i]){
+				hashes.push_back(batchHashes[j]);
+				j++;
+			}else{
+				hashes.push_back((size_t)0);
+			}
+		}
+		return hashes;
 	}
 
 
@@ -119,7 +192,7 @@ namespace MENHIR{
 	 * 
 	 * @param queryString 
 	 * @param pw 
-	 * @return pair<string, string> 
+	 * @return pair<string, string> : the aggregates and the errors, for queries with additional outputs separated by semicolons
 	 */
 	pair<string, string> queryServer(string queryString, string pw){
 		if(pw!=PASSWORD){
@@ -132,24 +205,61 @@ namespace MENHIR{
 		}else if (query.whereIndex >= COLUMN_FORMAT.size()){
 			throw std::invalid_argument( "whereIndex larger than number of attributs." );
 		}
-		if(query.agg==AggregateFunc::VARIANCE){
-			if(query.extra<=0){
-				query.extra=1;
-			}
-		}else if(query.agg==AggregateFunc::MAX_COUNT or query.agg==AggregateFunc::MIN_COUNT){
-			if(query.extra<=0){
-				query.extra=1;
+		for(auto output : query.outputs){
+			if (output.attributeIndex >= COLUMN_FORMAT.size()){
+				throw std::invalid_argument( "attributeIndex of output larger than number of attributs." );
 			}
 		}
+		query.extra=getValidExtra(query.agg, query.extra);
+		for(size_t i=0;i<query.outputs.size();i++){
+			query.outputs[i].extra=getValidExtra(query.outputs[i].agg, query.outputs[i].extra);
+		}
 
 		LOG(INFO, L"run Query on Server: "+toWString(queryToString(query)));
-		auto[result_dbt,result_d,err]=runQuery(query);
-		if(query.agg==AggregateFunc::MAX_COUNT or query.agg==AggregateFunc::MIN_COUNT){
-			return {DBT::toString(result_dbt), errToString(err)};
-		}else{
-			std::ostringstream oss;
-			oss << result_d;
-			return {oss.str(), errToString(err)};
+		//insertions wait until the query has finished accessing the OSMs and their copies
+		shared_lock<shared_mutex> guard(updateLock);
+		auto results=runMultiQuery(query);
+		vector<QueryOutput> outputs=getQueryOutputs(query);
+
+		//the aggregates of the outputs are separated by semicolons
+		std::ostringstream resultOss, errOss;
+		for(size_t i=0;i<results.size();i++){
+			auto[result_dbt,result_d,err]=results[i];
+			if(i>0){
+				resultOss<<";";
+				errOss<<";";
+			}
+			if(outputs[i].agg==AggregateFunc::MAX_COUNT or outputs[i].agg==AggregateFunc::MIN_COUNT or outputs[i].agg==AggregateFunc::MEDIAN or outputs[i].agg==AggregateFunc::PERCENTILE){
+				resultOss << DBT::toString(result_dbt);
+			}else{
+				resultOss << result_d;
+			}
+			errOss << errToString(err);
+		}
+		return {resultOss.str(), errOss.str()};
+	}
+
+	/**
+	 * @brief Replaces the extra parameter of an aggregate by its default if it is not valid for the aggregate function.
+	 * 
+	 * @param agg 
+	 * @param extra 
+	 * @return int 
+	 */
+	int getValidExtra(AggregateFunc agg, int extra){
+		if(agg==AggregateFunc::VARIANCE){
+			if(extra<=0){
+				return 1;
+			}
+		}else if(agg==AggregateFunc::MAX_COUNT or agg==AggregateFunc::MIN_COUNT){
+			if(extra<=0){
+				return 1;
+			}
+		}else if(agg==AggregateFunc::PERCENTILE){
+			if(extra<0 or extra>100){
+				return 50;
+			}
 		}
+		return extra;
 	}	
 }
\ No newline at end of file
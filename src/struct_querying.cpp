@@ -11,6 +11,8 @@ namespace MENHIR{
             case AggregateFunc::COUNT: return "COUNT";
             case AggregateFunc::MAX_COUNT:return "MAX_COUNT";
             case AggregateFunc::MIN_COUNT: return "MIN_COUNT";
+            case AggregateFunc::MEDIAN: return "MEDIAN";
+            case AggregateFunc::PERCENTILE: return "PERCENTILE";
             // omit default case to trigger compiler warning for missing cases
         };
         return "";
@@ -25,9 +27,11 @@ namespace MENHIR{
             case AggregateFunc::COUNT: return 3;
             case AggregateFunc::MAX_COUNT:return 4;
             case AggregateFunc::MIN_COUNT: return 5;
+            case AggregateFunc::MEDIAN: return 6;
+            case AggregateFunc::PERCENTILE: return 7;
             // omit default case to trigger compiler warning for missing cases
         };
-        return 6;
+        return 8;
     }
 
     AggregateFunc aggregateFuncFromString(string aggregateFuncString){
@@ -37,7 +41,9 @@ namespace MENHIR{
         }else if(aggregateFuncString =="VARIANCE"){ selected=AggregateFunc::VARIANCE;
         }else if(aggregateFuncString =="COUNT"){ selected=AggregateFunc::COUNT;
         }else if(aggregateFuncString =="MAX_COUNT"){ selected=AggregateFunc::MAX_COUNT;
-        }else if(aggregateFuncString =="MIN_COUNT"){ selected=AggregateFunc::MIN_COUNT;}
+        }else if(aggregateFuncString =="MIN_COUNT"){ selected=AggregateFunc::MIN_COUNT;
+        }else if(aggregateFuncString =="MEDIAN"){ selected=AggregateFunc::MEDIAN;
+        }else if(aggregateFuncString =="PERCENTILE"){ selected=AggregateFunc::PERCENTILE;}
 		return selected;
     }
 }
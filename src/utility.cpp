@@ -279,6 +279,22 @@ namespace MENHIR{
 
 	}
 
+	/**
+	 * @brief Returns ADDITIONAL_QUERY_FUNCTIONS in the format of the additionalAgg command line argument.
+	 * 
+	 * @return string 
+	 */
+	string additionalQueryFunctionsToString(){
+		std::ostringstream oss;
+		for(size_t i=0;i<ADDITIONAL_QUERY_FUNCTIONS.size();i++){
+			oss<<toString(ADDITIONAL_QUERY_FUNCTIONS[i]);
+			if(i!=ADDITIONAL_QUERY_FUNCTIONS.size()-1){
+				oss<<",";
+			}
+		}
+		return oss.str();
+	}
+
 	/**
 	 * @brief Get DATASOURCE_T value from string. Used for parsing the datasource command line argument.
 	 * 
@@ -295,6 +311,57 @@ namespace MENHIR{
 		return selected;
 	}
 
+	/**
+	 * @brief Return string for INDEX_MODE_T type.
+	 * 
+	 * @param mode 
+	 * @return string 
+	 */
+	string toString(INDEX_MODE_T mode){
+        switch (mode){
+            case INDEX_MODE_T::AVL_ONLY : return "AVL_ONLY" ;
+            case INDEX_MODE_T::LEAF_PAGES: return "LEAF_PAGES";
+            case INDEX_MODE_T::RANK_LAYOUT: return "RANK_LAYOUT";
+            case INDEX_MODE_T::INDEX_MODE_T_INVALID: return "INDEX_MODE_T_INVALID";
+
+            // omit default case to trigger compiler warning for missing cases
+        };
+        return "";
+	}
+
+	/**
+	 * @brief Return int for INDEX_MODE_T type.
+	 * 
+	 * @param mode 
+	 * @return int 
+	 */
+	int toInt(INDEX_MODE_T mode){
+        switch (mode){
+            case INDEX_MODE_T::AVL_ONLY : return 0 ;
+            case INDEX_MODE_T::LEAF_PAGES: return 1;
+            case INDEX_MODE_T::RANK_LAYOUT: return 2;
+            case INDEX_MODE_T::INDEX_MODE_T_INVALID: return 3;
+
+            // omit default case to trigger compiler warning for missing cases
+        };
+        return 3;
+	}
+
+	/**
+	 * @brief Get INDEX_MODE_T value from string. Used for parsing the indexMode command line argument.
+	 * 
+	 * @param indexModeString 
+	 * @return INDEX_MODE_T 
+	 */
+	INDEX_MODE_T indexModefromString(string indexModeString){
+		INDEX_MODE_T selected=INDEX_MODE_T::INDEX_MODE_T_INVALID;
+		if (indexModeString=="AVL_ONLY"){ selected=INDEX_MODE_T::AVL_ONLY;
+        }else if(indexModeString =="LEAF_PAGES"){ selected=INDEX_MODE_T::LEAF_PAGES;
+        }else if(indexModeString =="RANK_LAYOUT"){ selected=INDEX_MODE_T::RANK_LAYOUT;}
+		
+		return selected;
+	}
+
 	/**
 	 * @brief For an Error object, return the error code and warning message as string.
 	 * 
@@ -433,6 +500,9 @@ namespace MENHIR{
 		oss<<", agg:"<<q.agg;
 		oss<<", epsilon:"<<q.epsilon;
 		oss<<", extra:"<<q.extra;
+		for(auto output : q.outputs){
+			oss<<", output:{attributeIndex:"<<output.attributeIndex<<", agg:"<<output.agg<<", epsilon:"<<output.epsilon<<", extra:"<<output.extra<<"}";
+		}
 		oss<<"]";
 		return oss.str();
 	}
@@ -455,11 +525,14 @@ namespace MENHIR{
 		oss<<","<<q.agg;
 		oss<<","<<q.epsilon;
 		oss<<","<<q.extra;
+		for(auto output : q.outputs){
+			oss<<","<<output.attributeIndex<<","<<output.agg<<","<<output.epsilon<<","<<output.extra;
+		}
 		return oss.str();
 	}
 
 	/**
-	 * @brief Construct a query object from a string.
+	 * @brief Construct a query object from a string. Additional outputs follow the ten fields of the query as groups of four fields (attributeIndex, agg, epsilon, extra).
 	 * 
 	 * @param s 
 	 * @return Query 
@@ -479,12 +552,16 @@ namespace MENHIR{
 			auto whereFrom  = DBT::fromString(vs[5],typeW);
 			auto whereTo = DBT::fromString(vs[6],typeW);
 			
-			bool agg_index=bool(stoi(vs[7]));
+			int agg_index=stoi(vs[7]);
 			AggregateFunc agg=static_cast<AggregateFunc>(agg_index);
 
 			double epsilon=stod(vs[8]);
 			int mcount_width=stoi(vs[9]);
 		Query query=Query{attributeIndex,from,to,pointQuery,whereIndex,whereFrom,whereTo, agg, epsilon,mcount_width};
+		for(size_t i=10;i+3<vs.size();i+=4){
+			QueryOutput output={(uint) stoul(vs[i]), static_cast<AggregateFunc>(stoi(vs[i+1])), stod(vs[i+2]), stoi(vs[i+3])};
+			query.outputs.push_back(output);
+		}
 		return query;
 	}
 	
@@ -511,6 +588,12 @@ namespace MENHIR{
 
 		}else if(s=="MIN_COUNT"){
 			return AggregateFunc::MIN_COUNT;
+
+		}else if(s=="MEDIAN"){
+			return AggregateFunc::MEDIAN;
+
+		}else if(s=="PERCENTILE"){
+			return AggregateFunc::PERCENTILE;
 		}
 		return AggregateFunc::SUM;
 	}
@@ -0,0 +1,116 @@
+#include "worker_pool.hpp"
+
+/**
+ * @brief This file contains a pool of long-lived worker threads used by the OSMInterface to access the OSMs in parallel.
+ * Creating a thread for every OSM and query dominates the runtime of short queries if there are many small OSMs.
+ *
+ */
+
+namespace MENHIR{
+
+/**
+ * @brief Construct a new WorkerPool::WorkerPool object and starts the workers.
+ *
+ * @param numWorkers : number of worker threads. If 0, one worker per hardware thread is started.
+ * @param pinWorkers : if true, worker i is pinned to core i (modulo the number of cores)
+ */
+WorkerPool::WorkerPool(number numWorkers, bool pinWorkers){
+    number numCores=max(thread::hardware_concurrency(), 1u);
+    if(numWorkers==0){
+        numWorkers=numCores;
+    }
+    for(size_t i=0;i<numWorkers;i++){
+        this->queues.push_back(make_unique<WorkerQueue>());
+    }
+    for(size_t i=0;i<numWorkers;i++){
+        this->workers.push_back(thread(&WorkerPool::run, this, i));
+        if(pinWorkers){
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(i%numCores, &cpuset);
+            int rc=pthread_setaffinity_np(this->workers.back().native_handle(), sizeof(cpu_set_t), &cpuset);
+            if(rc!=0){
+                LOG(WARNING, boost::wformat(L"Worker %d could not be pinned to core %d.") %i %(i%numCores));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Destroy the WorkerPool::WorkerPool object. Tasks that are already queued are executed before the workers stop.
+ *
+ */
+WorkerPool::~WorkerPool(){
+    this->stop=true;
+    for(size_t i=0;i<this->queues.size();i++){
+        //taking the lock ensures that no worker misses the notification between checking stop and waiting
+        { lock_guard<mutex> guard(this->queues[i]->lock); }
+        this->queues[i]->wakeUp.notify_all();
+    }
+    for(size_t i=0;i<this->workers.size();i++){
+        this->workers[i].join();
+    }
+}
+
+size_t WorkerPool::size(){
+    return this->workers.size();
+}
+
+/**
+ * @brief Puts a task into the queue of the worker responsible for queueIndex (e.g. the index of an OSM).
+ * The same queueIndex is always mapped to the same worker.
+ *
+ * @param queueIndex
+ * @param task
+ * @return future<void> : ready once the task was executed
+ */
+future<void> WorkerPool::submit(size_t queueIndex, function<void()> task){
+    shared_ptr<packaged_task<void()>> packaged=make_shared<packaged_task<void()>>(task);
+    future<void> done=packaged->get_future();
+    WorkerQueue *queue=this->queues[queueIndex%this->queues.size()].get();
+    {
+        lock_guard<mutex> guard(queue->lock);
+        queue->tasks.push_back([packaged](){ (*packaged)(); });
+    }
+    queue->wakeUp.notify_one();
+    return done;
+}
+
+/**
+ * @brief Waits until every worker has executed all tasks that were queued before the call. 
+ * Must not be called from a worker, as it waits for the queue of the calling worker as well.
+ *
+ */
+void WorkerPool::drain(){
+    vector<future<void>> done;
+    for(size_t i=0;i<this->queues.size();i++){
+        done.push_back(submit(i, [](){}));
+    }
+    for(size_t i=0;i<done.size();i++){
+        done[i].get();
+    }
+}
+
+/**
+ * @brief Main loop of a worker. Executes the tasks of its queue in order until the pool is destroyed.
+ *
+ * @param workerIndex
+ */
+void WorkerPool::run(size_t workerIndex){
+    WorkerQueue *queue=this->queues[workerIndex].get();
+    while(true){
+        function<void()> task;
+        {
+            unique_lock<mutex> guard(queue->lock);
+            queue->wakeUp.wait(guard, [&](){ return this->stop or not queue->tasks.empty(); });
+            if(queue->tasks.empty()){
+                return;
+            }
+            task=move(queue->tasks.front());
+            queue->tasks.pop_front();
+        }
+        task();
+    }
+}
+
+}
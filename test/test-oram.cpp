@@ -455,6 +455,76 @@ TEST(ORAMTest, QueryAndUpdateRandom){
     }
 }
 
+TEST(ORAMTest, ConcurrentAccess){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    number CAPACITY = 200;
+    number Z = 3;
+    number BLOCK_SIZE   = 32;
+    number BATCH_SIZE   = 8;
+    shared_ptr<ORAM> oram =getORAM(CAPACITY, BLOCK_SIZE, Z, BATCH_SIZE);
+    ConcurrentORAM frontEnd(oram, BATCH_SIZE);
+
+    //every thread writes and reads its own blocks, the requests of all threads share the ORAM
+    size_t numThreads=4;
+    size_t perThread=40;
+    vector<thread> threads;
+    vector<bool> correct(numThreads, true);
+    for (size_t t = 0; t < numThreads; t++){
+        threads.push_back(thread([&frontEnd, &correct, t, perThread, BLOCK_SIZE](){
+            for (size_t i = 0; i < perThread; i++){
+                number id=t*perThread+i+1;
+                frontEnd.put(id, fromText(to_string(id), BLOCK_SIZE)).get();
+            }
+            for (size_t i = 0; i < perThread; i++){
+                number id=t*perThread+i+1;
+                bytes response=frontEnd.get(id).get();
+                correct[t]=correct[t] and response==fromText(to_string(id), BLOCK_SIZE);
+            }
+        }));
+    }
+    for (size_t t = 0; t < numThreads; t++){
+        threads[t].join();
+    }
+    for (size_t t = 0; t < numThreads; t++){
+        ASSERT_TRUE(correct[t]);
+    }
+    ASSERT_GE(frontEnd.getMeanBatchSize(), 1.0);
+    ASSERT_LE(frontEnd.getMeanBatchSize(), (double) BATCH_SIZE);
+}
+
+TEST(ORAMTest, Grow){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    number CAPACITY = 40;
+    number Z = 3;
+    number BLOCK_SIZE   = 32;
+    number BATCH_SIZE   = 1;
+    shared_ptr<ORAM> oram =getORAM(CAPACITY, BLOCK_SIZE, Z, BATCH_SIZE);
+    number height=oram->getHeight();
+
+    number numBlocks=CAPACITY;
+    for (number id = 1; id <= numBlocks; id++){
+        oram->put(id, fromText(to_string(id), BLOCK_SIZE));
+    }
+    //after each level, the old blocks are still found and the new block IDs can be used
+    for (number level = 1; level <= 3; level++){
+        oram->grow(4 * (height+level) * Z);
+        ASSERT_EQ(oram->getHeight(), height+level);
+        for (number id = numBlocks+1; id <= 2*numBlocks; id++){
+            oram->put(id, fromText(to_string(id), BLOCK_SIZE));
+        }
+        numBlocks*=2;
+        for (number id = 1; id <= numBlocks; id++){
+            bytes response;
+            oram->get(id, response);
+            ASSERT_EQ(response, fromText(to_string(id), BLOCK_SIZE));
+        }
+    }
+}
+
 int main(int argc, char ** argv) {
     testing::InitGoogleTest(&argc,argv);
     return RUN_ALL_TESTS();
@@ -5,6 +5,9 @@
 #include "database_type.hpp"
 #include "get_data_and_queries.hpp"
 #include "avl_loadtree.hpp"
+#include "osm_interface.hpp"
+#include "dp_query_functions.hpp"
+#include "querying.hpp"
 #include "path-oram/definitions.h"
 #include "path-oram/oram.hpp"
 //#include "gtest/gtest.h"
@@ -823,7 +826,8 @@ TEST(DeletionTests, deletionOfNonexistentNode){
     tree->deleteEntry(2,19,0);
 
 
-    ASSERT_EQ(tree->size(), nodes.size()-1);
+    //no node matches, so the tree is not changed
+    ASSERT_EQ(tree->size(), nodes.size());
     string expected= "Node[key:2-10, LH:3, RH:3]\n"\
                         "Node[key:2-6, LH:2, RH:2]\n"\
                         "Node[key:2-15, LH:2, RH:2]\n"\
@@ -1764,6 +1768,1470 @@ TEST(Find, FindInterval_Randomized){
 
 
 
+/**
+ * @brief Counts the real and dummy records returned for [lower,upper] and compares them with the records in data.
+ */
+void checkIntervalAgainstData(AVLTree *tree, vector<vector<db_t>> data, db_t lower, db_t upper, ulong column, number estimate){
+    DBT::dbResponse returned=tree->findIntervalMenhir(lower,upper,column,estimate);
+
+    multiset<int> expected;
+    for (size_t j = 0; j < data.size(); j++){
+        if(data[j][column]>=lower and data[j][column] <= upper){
+            expected.insert(data[j][column].val.i);
+        }
+    }
+    multiset<int> real;
+    for (size_t j = 0; j < returned.size(); j++){
+        auto[keys, dummy]=returned[j];
+        if(!dummy){
+            real.insert(keys[column].val.i);
+        }
+    }
+    ASSERT_EQ(returned.size(), expected.size()+estimate);
+    ASSERT_EQ(real, expected);
+}
+
+TEST(LeafPageTests, FindInterval_RandomizedInsertDelete){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+    number pageSizeBefore=LEAF_PAGE_SIZE;
+    LEAF_PAGE_SIZE=4;
+
+    vector<AType> thisFormat {AType::INT, AType::INT};
+    number capacity=200;
+    size_t sizeValue=0;
+
+    for(size_t seed=0;seed<3;seed++){
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(0,50);
+        AVLTree *tree=new DOSM::AVLTree(thisFormat,sizeValue,capacity, true, LEAF_PAGES);
+        ASSERT_EQ(tree->getIndexMode(), LEAF_PAGES);
+
+        vector<vector<db_t>> data;
+        vector<size_t> hashes;
+        for (size_t round = 0; round < 4; round++){
+            for(int i=0; i<30;i++){
+                vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+                hashes.push_back(tree->insert(key));
+                data.push_back(key);
+            }
+            for(int i=0; i<10;i++){
+                size_t pos=dist(rng)%data.size();
+                tree->deleteEntry(data[pos][0], hashes[pos], 0);
+                data.erase(data.begin()+pos);
+                hashes.erase(hashes.begin()+pos);
+            }
+            for (size_t q = 0; q < 5; q++){
+                db_t lower=db_t((int) dist(rng));
+                db_t upper=db_t((int) dist(rng));
+                if(upper<lower)swap(lower,upper);
+                ulong column=q%2;
+                checkIntervalAgainstData(tree, data, lower, upper, column, 1+dist(rng)%10);
+            }
+        }
+        delete tree;
+    }
+    LEAF_PAGE_SIZE=pageSizeBefore;
+}
+
+TEST(AVLTreeTests, FindInterval_RandomizedDelete){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    vector<AType> thisFormat {AType::INT, AType::INT};
+    size_t sizeValue=0;
+
+    //range scans without leaf pages follow the AVL trees and next pointers of both columns, so they are only correct if deletes maintain all of them
+    for(size_t seed=0;seed<3;seed++){
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+        vector<vector<db_t>> emptyData;
+        AVLTree *tree=new DOSM::AVLTree(thisFormat, sizeValue, 6, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &emptyData, 0, true, AVL_ONLY);
+
+        vector<vector<db_t>> data;
+        vector<size_t> hashes;
+        for(int i=0; i<40;i++){
+            vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+            hashes.push_back(tree->insert(key));
+            data.push_back(key);
+        }
+        for(int i=0; i<30;i++){
+            size_t pos=dist(rng)%data.size();
+            ulong column=i%2;
+            tree->deleteEntry(data[pos][column], hashes[pos], column);
+            data.erase(data.begin()+pos);
+            hashes.erase(hashes.begin()+pos);
+            ASSERT_EQ(tree->size(), data.size());
+        }
+        //deleting a node that is not in the tree only executes dummy operations
+        tree->deleteEntry(db_t(1), 0, 0);
+        ASSERT_EQ(tree->size(), data.size());
+
+        for(ulong column=0;column<2;column++){
+            checkIntervalAgainstData(tree, data, db_t(1), db_t(50), column, 1+dist(rng)%10);
+        }
+        delete tree;
+    }
+}
+
+TEST(LeafPageTests, FindInterval_BulkLoaded){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+    number pageSizeBefore=LEAF_PAGE_SIZE;
+    LEAF_PAGE_SIZE=3;
+
+    vector<AType> thisFormat {AType::INT};
+    number logcapacity=7;
+    size_t sizeValue=0;
+
+    vector<vector<db_t>> inputData;
+    for (int i = 0; i < 20; i++){
+        inputData.push_back(vector<db_t>{(i*7)%13});
+    }
+    INPUT_DATA=inputData;
+    AVLTree *tree=new DOSM::AVLTree(thisFormat,sizeValue, logcapacity, ORAM_Z,  STASH_FACTOR, BATCH_SIZE, &INPUT_DATA, INPUT_DATA.size(),USE_ORAM, LEAF_PAGES);
+
+    checkIntervalAgainstData(tree, inputData, db_t(0), db_t(12), 0, 1);
+    checkIntervalAgainstData(tree, inputData, db_t(3), db_t(5), 0, 4);
+    checkIntervalAgainstData(tree, inputData, db_t(12), db_t(20), 0, 30);
+
+    size_t hash=tree->insert(vector<db_t>{4});
+    inputData.push_back(vector<db_t>{4});
+    checkIntervalAgainstData(tree, inputData, db_t(3), db_t(5), 0, 2);
+    tree->deleteEntry(db_t(4), hash, 0);
+    inputData.pop_back();
+    checkIntervalAgainstData(tree, inputData, db_t(3), db_t(5), 0, 2);
+
+    delete tree;
+    LEAF_PAGE_SIZE=pageSizeBefore;
+}
+
+
+
+TEST(RankLayoutTests, FindInterval_RandomizedInsertDelete){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+    number thresholdBefore=RANK_REBUILD_THRESHOLD;
+    RANK_REBUILD_THRESHOLD=16;
+
+    vector<AType> thisFormat {AType::INT, AType::INT};
+    number capacity=200;
+    size_t sizeValue=0;
+    number batchSize=4;
+
+    for(size_t seed=0;seed<3;seed++){
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(0,50);
+        AVLTree *tree=new DOSM::AVLTree(thisFormat,sizeValue,capacity, ORAM_Z, STASH_FACTOR, batchSize, true, RANK_LAYOUT);
+        ASSERT_EQ(tree->getIndexMode(), RANK_LAYOUT);
+
+        vector<vector<db_t>> data;
+        vector<size_t> hashes;
+        for (size_t round = 0; round < 4; round++){
+            for(int i=0; i<30;i++){
+                vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+                hashes.push_back(tree->insert(key));
+                data.push_back(key);
+            }
+            for(int i=0; i<10;i++){
+                size_t pos=dist(rng)%data.size();
+                tree->deleteEntry(data[pos][0], hashes[pos], 0);
+                data.erase(data.begin()+pos);
+                hashes.erase(hashes.begin()+pos);
+            }
+            for (size_t q = 0; q < 5; q++){
+                db_t lower=db_t((int) dist(rng));
+                db_t upper=db_t((int) dist(rng));
+                if(upper<lower)swap(lower,upper);
+                ulong column=q%2;
+                checkIntervalAgainstData(tree, data, lower, upper, column, 1+dist(rng)%10);
+            }
+        }
+        delete tree;
+    }
+    RANK_REBUILD_THRESHOLD=thresholdBefore;
+}
+
+TEST(RankLayoutTests, ObliviousSortRecords){
+    vector<AType> thisFormat {AType::INT, AType::INT};
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(0,20);
+
+    vector<RankRecord> records;
+    for (size_t i = 0; i < 37; i++){
+        records.push_back(RankRecord(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))}, i+1, thisFormat));
+    }
+    for (ulong column = 0; column < 2; column++){
+        vector<RankRecord> sorted=records;
+        obliviousSortRecords(&sorted, column);
+        ASSERT_EQ(sorted.size(), records.size());
+        for (size_t i = 1; i < sorted.size(); i++){
+            ASSERT_FALSE(rankRecordSmaller(sorted[i], sorted[i-1], column));
+        }
+    }
+}
+
+
+/**
+ * @brief Collects the nodes of the tree of one column in order and checks that every node is balanced.
+ */
+void collectInOrder(AVLTree *tree, ulong ptr, ulong column, vector<AVLTreeNode> *inOrder){
+    if(ptr==NULL_PTR or inOrder->size()>tree->size()){
+        return;
+    }
+    AVLTreeNode node=tree->getNodeORAM(ptr);
+    collectInOrder(tree, node.ptrLeftChild[column], column, inOrder);
+    inOrder->push_back(node);
+    collectInOrder(tree, node.ptrRightChild[column], column, inOrder);
+    EXPECT_LE(abs(node.lHeight[column]-node.rHeight[column]),1);
+}
+
+TEST(AVLTreeTests, InsertBatch){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    vector<AType> thisFormat {AType::INT, AType::INT};
+    number capacity=200;
+    size_t sizeValue=0;
+    number batchSize=4;
+
+    for(size_t seed=0;seed<3;seed++){
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(0,50);
+        AVLTree *tree=new DOSM::AVLTree(thisFormat,sizeValue,capacity, ORAM_Z, STASH_FACTOR, batchSize, true);
+
+        vector<vector<db_t>> data;
+        vector<size_t> hashes;
+        for(int i=0; i<(int)seed*3;i++){
+            vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+            hashes.push_back(tree->insert(key));
+            data.push_back(key);
+        }
+        for (size_t round = 0; round < 3; round++){
+            vector<vector<db_t>> batch;
+            for(int i=0; i<20;i++){
+                batch.push_back(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))});
+            }
+            vector<size_t> batchHashes=tree->insertBatch(batch);
+            ASSERT_EQ(batchHashes.size(), batch.size());
+            data.insert(data.end(), batch.begin(), batch.end());
+            hashes.insert(hashes.end(), batchHashes.begin(), batchHashes.end());
+            ASSERT_EQ(tree->size(), data.size());
+
+            set<size_t> distinctHashes(hashes.begin(), hashes.end());
+            ASSERT_EQ(distinctHashes.size(), hashes.size());
+            ASSERT_EQ(distinctHashes.count(0), 0u);
+
+            for (ulong column = 0; column < 2; column++){
+                vector<AVLTreeNode> inOrder;
+                collectInOrder(tree, tree->getRoots()[column], column, &inOrder);
+                ASSERT_EQ(inOrder.size(), data.size());
+
+                multiset<int> expected;
+                for (size_t k = 0; k < data.size(); k++){
+                    expected.insert(data[k][column].val.i);
+                }
+                multiset<int> real;
+                for (size_t k = 0; k < inOrder.size(); k++){
+                    real.insert(inOrder[k].key[column].val.i);
+                    if(k>0){
+                        ASSERT_TRUE(inOrder[k-1].key[column]<=inOrder[k].key[column]);
+                        ASSERT_EQ(inOrder[k-1].next[column], inOrder[k].nodeID);
+                    }
+                }
+                ASSERT_EQ(real, expected);
+            }
+        }
+        delete tree;
+    }
+}
+
+TEST(AVLTreeTests, ScanHidesMarkedNodes){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    vector<AType> thisFormat {AType::INT};
+    number capacity=100;
+    size_t sizeValue=0;
+    number batchSize=4;
+    db_t lower=db_t(10);
+    db_t upper=db_t(20);
+
+    //both trees hold the same records in [10,20] and one marked record, which lies in the interval for the first tree and outside for the second
+    vector<number> visited;
+    for (int marked : {15, 40}){
+        AVLTree *tree=new DOSM::AVLTree(thisFormat,sizeValue,capacity, ORAM_Z, STASH_FACTOR, batchSize, true);
+        for(int i=1; i<=30;i++){
+            tree->insert(vector<db_t>{db_t(i)});
+        }
+        size_t hash=tree->insert(vector<db_t>{db_t(marked)});
+        ASSERT_TRUE(tree->markDeleted(db_t(marked), hash, 0));
+
+        multiset<int> real;
+        number numVisited=tree->scanInterval(lower, upper, 0, 3, [&real](const vector<db_t> &keys, bool dummy){
+            if(!dummy){
+                real.insert(keys[0].val.i);
+            }
+        });
+        ASSERT_EQ(real.size(), 11u);
+        visited.push_back(numVisited);
+        delete tree;
+    }
+    ASSERT_EQ(visited[0], visited[1]);
+}
+
+TEST(AggregateTests, SubtreeAggregatesMatchData){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    vector<AType> thisFormat {AType::INT, AType::INT};
+    size_t sizeValue=0;
+    USE_SUBTREE_AGGREGATES=true;
+    AGGREGATE_COLUMN=1;
+
+    //the aggregates must survive the bulk load, single and batch inserts and deletes (all of which rotate nodes)
+    for(size_t seed=0;seed<3;seed++){
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+        vector<vector<db_t>> data;
+        for(int i=0; i<20;i++){
+            data.push_back(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))});
+        }
+        vector<size_t> hashes;
+        for(size_t i=0; i<data.size();i++){
+            hashes.push_back(i+1); //nodeHash assigned by the bulk load
+        }
+        vector<vector<db_t>> inputData=data;
+        AVLTree *tree=new DOSM::AVLTree(thisFormat, sizeValue, 7, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &inputData, inputData.size(), true, AVL_ONLY);
+        ASSERT_TRUE(tree->isAugmented());
+
+        auto checkAggregates=[&](){
+            for(ulong column=0;column<2;column++){
+                for(int q=0;q<10;q++){
+                    int from=dist(rng);
+                    int to=dist(rng);
+                    number count=0;
+                    double sum=0.0;
+                    for(size_t k=0;k<data.size();k++){
+                        bool inInterval=data[k][column].val.i>=from and data[k][column].val.i<=to;
+                        count+=inInterval;
+                        sum+=inInterval*data[k][1].val.i;
+                    }
+                    auto[realCount, realSum]=tree->aggregateInterval(db_t(from), db_t(to), column);
+                    ASSERT_EQ(realCount, count);
+                    ASSERT_DOUBLE_EQ(realSum, sum);
+
+                    number below=0;
+                    for(size_t k=0;k<data.size();k++){
+                        below+=data[k][column].val.i<from;
+                    }
+                    ASSERT_EQ(get<0>(tree->aggregateBelow(db_t(from), false, column)), below);
+                }
+            }
+        };
+        checkAggregates();
+
+        for(int i=0; i<30;i++){
+            vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+            hashes.push_back(tree->insert(key));
+            data.push_back(key);
+        }
+        checkAggregates();
+
+        vector<vector<db_t>> batch;
+        for(int i=0; i<20;i++){
+            batch.push_back(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))});
+        }
+        vector<size_t> batchHashes=tree->insertBatch(batch);
+        data.insert(data.end(), batch.begin(), batch.end());
+        hashes.insert(hashes.end(), batchHashes.begin(), batchHashes.end());
+        checkAggregates();
+
+        for(int i=0; i<40;i++){
+            size_t pos=dist(rng)%data.size();
+            ulong column=i%2;
+            ASSERT_TRUE(tree->deleteEntry(data[pos][column], hashes[pos], column));
+            data.erase(data.begin()+pos);
+            hashes.erase(hashes.begin()+pos);
+        }
+        checkAggregates();
+        delete tree;
+    }
+    USE_SUBTREE_AGGREGATES=false;
+    AGGREGATE_COLUMN=0;
+}
+
+TEST(AggregateTests, QuantileSearch){
+    double budget=AVAILABLE_BUDGET;
+    AVAILABLE_BUDGET=1000000;
+    vector<double> data;
+    for(int i=1; i<=101;i++){
+        data.push_back(i);
+    }
+    for(int percentile : {50, 90, 1}){
+        double fraction=percentile/100.0;
+        auto rankDifference=[&](double mid){
+            double count=0;
+            for(double d : data){
+                count+=(d<=mid);
+            }
+            return count-fraction*data.size();
+        };
+        auto[quantile, err]=dp_quantile(rankDifference, 0, 200, 1, 10000);
+        ASSERT_FALSE(err.is_err());
+        EXPECT_EQ(quantile, ceil(fraction*data.size()));
+    }
+    AVAILABLE_BUDGET=budget;
+}
+
+TEST(AggregateTests, MultipleOutputsFromOneRetrieval){
+    double budget=AVAILABLE_BUDGET;
+    vector<AType> columnFormat=COLUMN_FORMAT;
+    vector<db_t> minValue=MIN_VALUE;
+    vector<db_t> maxValue=MAX_VALUE;
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(100), db_t(100)};
+    AVAILABLE_BUDGET=30000;
+
+    //records in [10,20] of column 1 count, the others are padding or dummies
+    dbResponse allRecords;
+    int count=0, sum=0;
+    for(int i=0;i<40;i++){
+        vector<db_t> record{db_t(i%7), db_t(i)};
+        bool dummy=(i%5==0);
+        allRecords.push_back(make_tuple(record, dummy));
+        if(not dummy and i>=10 and i<=20){
+            count++;
+            sum+=i%7;
+        }
+    }
+    Query query{0, db_t(0), db_t(100), false, 1, db_t(10), db_t(20), AggregateFunc::COUNT, 10000, 0};
+    query.outputs.push_back(QueryOutput{0, AggregateFunc::SUM, 10000, 0});
+    query.outputs.push_back(QueryOutput{1, AggregateFunc::COUNT, 10000, 0});
+
+    Query parsed=queryFromCSVString(queryToCSVString(query));
+    ASSERT_EQ(parsed.outputs.size(), 2);
+    EXPECT_EQ(parsed.outputs[0].agg, AggregateFunc::SUM);
+    EXPECT_EQ(parsed.outputs[1].attributeIndex, 1);
+
+    vector<tuple<db_t,double,Error>> results=computeQueryOutputs(query, allRecords);
+    ASSERT_EQ(results.size(), 3);
+    for(auto result : results){
+        ASSERT_FALSE(get<2>(result).is_err());
+    }
+    EXPECT_NEAR(get<1>(results[0]), count, 0.5);
+    EXPECT_NEAR(get<1>(results[1]), sum, 1);
+    EXPECT_NEAR(get<1>(results[2]), count, 0.5);
+    EXPECT_NEAR(AVAILABLE_BUDGET, 0, TOLERANCE);
+
+    AVAILABLE_BUDGET=budget;
+    COLUMN_FORMAT=columnFormat;
+    MIN_VALUE=minValue;
+    MAX_VALUE=maxValue;
+}
+
+TEST(AggregateTests, StreamingAggregateMatchesData){
+    StreamingAggregate intAggregate(AType::INT, db_t(0), db_t(50));
+    StreamingAggregate intOther(AType::INT, db_t(0), db_t(50));
+    StreamingAggregate floatAggregate(AType::FLOAT, db_t(-1.0f), db_t(1.0f));
+    number count=0;
+    int intSum=0;
+    double floatSum=0;
+    for(int i=0;i<100;i++){
+        bool ignore=(i%3==0);
+        //values above 50 are clipped
+        (i<60 ? intAggregate : intOther).add(db_t(i), ignore);
+        floatAggregate.add(db_t((float) (i%5)/4.0f), ignore);
+        if(not ignore){
+            count++;
+            intSum+=min(i, 50);
+            floatSum+=(i%5)/4.0;
+        }
+    }
+    intAggregate.merge(intOther);
+    EXPECT_EQ(intAggregate.count, count);
+    EXPECT_EQ(intAggregate.getSum(), intSum);
+    EXPECT_EQ(floatAggregate.count, count);
+    EXPECT_NEAR(floatAggregate.getSum(), floatSum, 0.0001);
+}
+
+TEST(AggregateTests, FusedSumsMatchData){
+    //13 values, so the last block of lanes is incomplete
+    vector<db_t> data;
+    vector<bool> ignoring;
+    double count=0, sum=0, sumAbsDeviation=0;
+    double center=10.0;
+    for(int i=0;i<13;i++){
+        data.push_back(db_t(i*3-6));
+        ignoring.push_back(i%4==1);
+        if(i%4!=1){
+            double clipped=min(max(i*3.0-6.0, 0.0), 20.0);
+            count++;
+            sum+=clipped;
+            sumAbsDeviation+=abs(clipped-center);
+        }
+    }
+    vector<double> values=toDoubleArray(data);
+    vector<uchar> mask=toMaskArray(ignoring);
+    FusedSums sums=fused_sums(values.data(), mask.data(), values.size(), 0.0, 20.0, center);
+    EXPECT_EQ(sums.count, count);
+    EXPECT_DOUBLE_EQ(sums.sum, sum);
+    EXPECT_DOUBLE_EQ(sums.sumAbsDeviation, sumAbsDeviation);
+
+    sums=fused_sums(values.data(), mask.data(), 0, 0.0, 20.0);
+    EXPECT_EQ(sums.count, 0.0);
+    EXPECT_EQ(sums.sum, 0.0);
+}
+
+TEST(LSMTests, InsertAndMerge){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=8;
+    USE_GAMMA=true;
+    USE_LSM=true;
+    LSM_BUFFER_SIZE=8;
+    LSM_SIZE_RATIO=2;
+
+    OSMInterface *osm=new OSMInterface();
+    ASSERT_EQ(osm->numOSMs, 1u);
+
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+    vector<vector<db_t>> data;
+    for(int i=0; i<100;i++){
+        vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+        osm->insert(key);
+        data.push_back(key);
+    }
+    osm->finishMerges();
+
+    //levels shrink from the oldest to the newest OSM, so there are only logarithmically many
+    size_t total=0;
+    for(size_t i=0;i<osm->numOSMs;i++){
+        total+=osm->trees[i]->size();
+    }
+    ASSERT_EQ(total, data.size());
+    ASSERT_LE(osm->numOSMs, 6u);
+
+    for (size_t q = 0; q < 6; q++){
+        db_t lower=db_t((int) dist(rng));
+        db_t upper=db_t((int) dist(rng));
+        if(upper<lower)swap(lower,upper);
+        ushort column=q%2;
+        DBT::dbResponse returned=osm->findInterval(lower, upper, column, vector<number>(osm->numOSMs, 1));
+
+        multiset<int> expected;
+        for (size_t j = 0; j < data.size(); j++){
+            if(data[j][column]>=lower and data[j][column] <= upper){
+                expected.insert(data[j][column].val.i);
+            }
+        }
+        multiset<int> real;
+        for (size_t j = 0; j < returned.size(); j++){
+            auto[keys, dummy]=returned[j];
+            if(!dummy){
+                real.insert(keys[column].val.i);
+            }
+        }
+        ASSERT_EQ(returned.size(), expected.size()+osm->numOSMs);
+        ASSERT_EQ(real, expected);
+    }
+
+    USE_LSM=false;
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(TombstoneTests, DeleteAndCompact){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=7;
+    USE_GAMMA=true;
+    USE_TOMBSTONES=true;
+    TOMBSTONE_RATIO=0.25;
+
+    OSMInterface *osm=new OSMInterface();
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+    vector<vector<db_t>> data;
+    vector<size_t> hashes;
+    for(int i=0; i<60;i++){
+        vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+        hashes.push_back(osm->insert(key));
+        data.push_back(key);
+    }
+
+    //deleting a third of the records triggers a rebuild of the OSM, deletes during the rebuild are repeated on the new OSM
+    for(int i=0; i<20;i++){
+        ushort column=i%2;
+        osm->deleteEntry(data.back()[column], hashes.back(), column);
+        data.pop_back();
+        hashes.pop_back();
+    }
+    osm->finishMerges();
+    ASSERT_EQ(osm->numOSMs, 1u);
+    ASSERT_LT(osm->trees[0]->size(), 60u);
+    ASSERT_EQ(osm->trees[0]->size(), data.size()+osm->trees[0]->getNumTombstones());
+
+    for (size_t q = 0; q < 6; q++){
+        db_t lower=db_t((int) dist(rng));
+        db_t upper=db_t((int) dist(rng));
+        if(upper<lower)swap(lower,upper);
+        ushort column=q%2;
+        DBT::dbResponse returned=osm->findInterval(lower, upper, column, vector<number>(osm->numOSMs, 1));
+
+        multiset<int> expected;
+        for (size_t j = 0; j < data.size(); j++){
+            if(data[j][column]>=lower and data[j][column] <= upper){
+                expected.insert(data[j][column].val.i);
+            }
+        }
+        multiset<int> real;
+        for (size_t j = 0; j < returned.size(); j++){
+            auto[keys, dummy]=returned[j];
+            if(!dummy){
+                real.insert(keys[column].val.i);
+            }
+        }
+        ASSERT_EQ(real, expected);
+    }
+
+    USE_TOMBSTONES=false;
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(WorkerPoolTests, SameQueueSameWorker){
+    WorkerPool pool(3, false);
+    ASSERT_EQ(pool.size(), 3u);
+
+    //tasks for the same queue index are executed in order by the same worker
+    vector<thread::id> ids(12);
+    vector<int> order;
+    mutex orderLock;
+    vector<future<void>> done;
+    for (size_t i = 0; i < 12; i++){
+        done.push_back(pool.submit(i, [&ids, &order, &orderLock, i](){
+            ids[i]=this_thread::get_id();
+            if(i%3==0){
+                lock_guard<mutex> guard(orderLock);
+                order.push_back(i);
+            }
+        }));
+    }
+    for (size_t i = 0; i < done.size(); i++){
+        done[i].get();
+    }
+    for (size_t i = 3; i < 12; i++){
+        ASSERT_TRUE(ids[i]==ids[i%3]);
+    }
+    ASSERT_TRUE(ids[0]!=ids[1] and ids[1]!=ids[2]);
+    ASSERT_EQ(order, vector<int>({0,3,6,9}));
+}
+
+
+TEST(ReplicaTests, QueriesOnReplicas){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=6;
+    USE_GAMMA=true;
+    NUM_REPLICAS=3;
+
+    OSMInterface *osm=new OSMInterface();
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+    vector<vector<db_t>> data;
+    for(int i=0; i<100;i++){
+        vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+        osm->insert(key);
+        data.push_back(key);
+    }
+    osm->createReplicas();
+    ASSERT_EQ(osm->numOSMs, 2u);
+    ASSERT_EQ(osm->getNumReplicas(), 3u);
+
+    //consecutive queries are answered by different copies, all of them have to return the same records
+    for (size_t q = 0; q < 6; q++){
+        db_t lower=db_t((int) dist(rng));
+        db_t upper=db_t((int) dist(rng));
+        if(upper<lower)swap(lower,upper);
+        ushort column=q%2;
+        DBT::dbResponse returned=osm->findInterval(lower, upper, column, vector<number>(osm->numOSMs, 1));
+
+        multiset<int> expected;
+        for (size_t j = 0; j < data.size(); j++){
+            if(data[j][column]>=lower and data[j][column] <= upper){
+                expected.insert(data[j][column].val.i);
+            }
+        }
+        multiset<int> real;
+        for (size_t j = 0; j < returned.size(); j++){
+            auto[keys, dummy]=returned[j];
+            if(!dummy){
+                real.insert(keys[column].val.i);
+            }
+        }
+        ASSERT_EQ(real, expected);
+
+        //streaming the records has to visit the same records, each visitor is only called by the worker of its OSM
+        vector<multiset<int>> scannedPerOSM(osm->numOSMs);
+        vector<DBT::recordVisitor> visitors;
+        for (size_t i = 0; i < osm->numOSMs; i++){
+            multiset<int> &scanned=scannedPerOSM[i];
+            visitors.push_back([&scanned, column](const vector<db_t> &keys, bool dummy){
+                if(!dummy){
+                    scanned.insert(keys[column].val.i);
+                }
+            });
+        }
+        number visited=osm->scanInterval(lower, upper, column, vector<number>(osm->numOSMs, 1), visitors);
+        ASSERT_EQ(visited, returned.size());
+        multiset<int> scanned;
+        for (size_t i = 0; i < osm->numOSMs; i++){
+            scanned.insert(scannedPerOSM[i].begin(), scannedPerOSM[i].end());
+        }
+        ASSERT_EQ(scanned, expected);
+    }
+
+    //the copies are read-only and dropped on the next insertion
+    osm->insert(vector<db_t>{db_t(1), db_t(1)});
+    ASSERT_EQ(osm->getNumReplicas(), 1u);
+
+    NUM_REPLICAS=1;
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(ConcurrentORAMTests, QueriesShareOSMs){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    number batchSizeBefore=BATCH_SIZE;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=6;
+    BATCH_SIZE=4;
+    USE_GAMMA=true;
+    ORAM_CONCURRENCY=3;
+
+    OSMInterface *osm=new OSMInterface();
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+    vector<vector<db_t>> data;
+    for(int i=0; i<100;i++){
+        vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+        osm->insert(key);
+        data.push_back(key);
+    }
+    osm->prepareQuerying();
+
+    //all queries are submitted before the first one is collected, so up to three workers scan each OSM at the same time
+    vector<tuple<db_t,db_t,ushort>> queries;
+    vector<shared_ptr<PendingQuery>> pending;
+    for (size_t q = 0; q < 9; q++){
+        db_t lower=db_t((int) dist(rng));
+        db_t upper=db_t((int) dist(rng));
+        if(upper<lower)swap(lower,upper);
+        ushort column=q%2;
+        queries.push_back(make_tuple(lower, upper, column));
+        pending.push_back(osm->submitFindInterval(lower, upper, column, vector<number>(osm->numOSMs, 1), QueryTiming()));
+    }
+    for (size_t q = 0; q < queries.size(); q++){
+        auto[lower, upper, column]=queries[q];
+        DBT::dbResponse returned=osm->collectFindInterval(pending[q]);
+
+        multiset<int> expected;
+        for (size_t j = 0; j < data.size(); j++){
+            if(data[j][column]>=lower and data[j][column] <= upper){
+                expected.insert(data[j][column].val.i);
+            }
+        }
+        multiset<int> real;
+        for (size_t j = 0; j < returned.size(); j++){
+            auto[keys, dummy]=returned[j];
+            if(!dummy){
+                real.insert(keys[column].val.i);
+            }
+        }
+        ASSERT_EQ(real, expected);
+    }
+    ASSERT_GE(osm->trees[0]->getMeanBatchSize(), 1.0);
+
+    //inserting ends the concurrent access
+    osm->insert(vector<db_t>{db_t(1), db_t(1)});
+    ASSERT_EQ(osm->trees[0]->getMeanBatchSize(), 0.0);
+
+    ORAM_CONCURRENCY=1;
+    BATCH_SIZE=batchSizeBefore;
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(VolumeSanitizerTests, NoiseTreeLayout){
+    NoiseTree tree(vector<number>{9,3,1});
+    ASSERT_EQ(tree.levels(), 3u);
+    ASSERT_EQ(tree.size(), 13u);
+    tree.set(0, 8, 5);
+    tree.set(1, 0, 7);
+    tree.set(2, 0, 11);
+    ASSERT_EQ(tree.get(make_pair(0ull, 8ull)), 5u);
+    ASSERT_EQ(tree.get(make_pair(1ull, 0ull)), 7u);
+    ASSERT_EQ(tree.get(make_pair(2ull, 0ull)), 11u);
+    //nodes outside of the tree have no noise
+    ASSERT_EQ(tree.get(make_pair(1ull, 3ull)), 0u);
+    ASSERT_EQ(tree.get(make_pair(3ull, 0ull)), 0u);
+}
+
+TEST(VolumeSanitizerTests, OneNoiseTreePerOSM){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=4;
+    USE_GAMMA=false;
+    NUM_DATAPOINTS=40;
+    INPUT_DATA.clear();
+    for(size_t i=0; i<NUM_DATAPOINTS;i++){
+        INPUT_DATA.push_back(vector<db_t>{db_t((int) i%50+1), db_t((int) i%50+1)});
+    }
+
+    OSMInterface *osm=new OSMInterface();
+    ASSERT_EQ(osm->numOSMs, 3u);
+    ASSERT_EQ(osm->volumeSanitizers.size(), osm->numOSMs*NUM_ATTRIBUTES);
+    for(size_t i=0;i<osm->volumeSanitizers.size();i++){
+        ASSERT_GT(osm->volumeSanitizers[i].noises->size(), 0u);
+    }
+    //copies of a sanitizer share its noise tree
+    VolumeSanitizer copy=osm->volumeSanitizers[1];
+    ASSERT_EQ(copy.noises.get(), osm->volumeSanitizers[1].noises.get());
+
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(HistogramTests, ScanMatchesNaiveCount){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::FLOAT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0.0f)};
+    MAX_VALUE={db_t(50), db_t(25.0f)};
+    DATA_RESOLUTION={db_t(1), db_t(0.5f)};
+    VALUE_SIZE=0;
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=4;
+    USE_GAMMA=true;
+    NUM_DATAPOINTS=40;
+    INPUT_DATA.clear();
+    for(size_t i=0; i<NUM_DATAPOINTS;i++){
+        INPUT_DATA.push_back(vector<db_t>{db_t((int) (i*7)%50+1), db_t((float) ((i*3)%50)*0.5f)});
+    }
+
+    OSMInterface *osm=new OSMInterface();
+    ASSERT_GT(osm->numOSMs, 1u);
+    number allPoints;
+    tie(allPoints, ignore)=osm->getTotalFromHistograms(db_t(0), db_t(50), 0);
+    ASSERT_GT(allPoints, 0u);
+    vector<pair<db_t,db_t>> intervals[2]={
+        {{db_t(1), db_t(50)}, {db_t(10), db_t(20)}, {db_t(17), db_t(17)}, {db_t(30), db_t(5)}},
+        {{db_t(0.0f), db_t(25.0f)}, {db_t(2.5f), db_t(7.0f)}, {db_t(3.5f), db_t(3.5f)}, {db_t(8.0f), db_t(1.0f)}}
+    };
+    for(size_t column=0;column<2;column++){
+        for(auto interval : intervals[column]){
+            number total;
+            vector<number> counts;
+            tie(total, counts)=osm->getTotalFromHistograms(interval.first, interval.second, column);
+            ASSERT_EQ(counts.size(), osm->numOSMs);
+
+            number expectedTotal=0;
+            for(size_t osmIndex=0;osmIndex<osm->numOSMs;osmIndex++){
+                hist_t histogram=osm->histograms[osmIndex][column];
+                number expected=0;
+                for(size_t i=0;i<histogram.size();i++){
+                    if(histogram.values[i]>=DBT::toDouble(interval.first) and histogram.values[i]<=DBT::toDouble(interval.second)){
+                        expected+=histogram.counts[i];
+                    }
+                }
+                ASSERT_EQ(counts[osmIndex], expected);
+                expectedTotal+=expected;
+            }
+            ASSERT_EQ(total, expectedTotal);
+        }
+    }
+
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(HistogramTests, HierarchicalMatchesBuckets){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(1000)};
+    DATA_RESOLUTION={db_t(1), db_t(7)};
+    VALUE_SIZE=0;
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=4;
+    USE_GAMMA=true;
+    HISTOGRAM_FANOUT=3;
+    NUM_DATAPOINTS=40;
+    INPUT_DATA.clear();
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,1000);
+    for(size_t i=0; i<NUM_DATAPOINTS;i++){
+        INPUT_DATA.push_back(vector<db_t>{db_t((int) dist(rng)%50+1), db_t((int) dist(rng))});
+    }
+
+    OSMInterface *osm=new OSMInterface();
+    number numRecords=0;
+    for(size_t osmIndex=0;osmIndex<osm->numOSMs;osmIndex++){
+        numRecords+=osm->trees[osmIndex]->size();
+    }
+    for(size_t column=0;column<2;column++){
+        number numBuckets=osm->histograms[0][column].numBuckets;
+        for(int q=0;q<200;q++){
+            //also covers intervals outside of the domain and empty intervals
+            int from=(int) dist(rng)%(int)(numBuckets*DATA_RESOLUTION[column].val.i+20)-10;
+            int to=(int) dist(rng)%(int)(numBuckets*DATA_RESOLUTION[column].val.i+20)-10;
+            if(q==0){
+                from=-10;
+                to=2000;
+            }
+            number total;
+            vector<number> counts;
+            tie(total, counts)=osm->getTotalFromHistograms(db_t(from), db_t(to), column);
+
+            number expectedTotal=0;
+            for(size_t osmIndex=0;osmIndex<osm->numOSMs;osmIndex++){
+                hist_t histogram=osm->histograms[osmIndex][column];
+                ASSERT_EQ(histogram.fanout, 3u);
+                number expected=0;
+                for(size_t i=0;i<histogram.numBuckets;i++){
+                    int value=(int) i*DATA_RESOLUTION[column].val.i;
+                    if(value>=from and value<=to){
+                        expected+=histogram.counts[i];
+                    }
+                }
+                ASSERT_EQ(counts[osmIndex], expected);
+                expectedTotal+=expected;
+            }
+            ASSERT_EQ(total, expectedTotal);
+            if(q==0){
+                ASSERT_EQ(total, numRecords);
+            }
+        }
+    }
+
+    HISTOGRAM_FANOUT=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(HistogramTests, MaintainedOnInsertAndDelete){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=4;
+    USE_GAMMA=true;
+
+    for(bool tombstones : {false, true}){
+        USE_TOMBSTONES=tombstones;
+        NUM_DATAPOINTS=0;
+        INPUT_DATA.clear();
+        OSMInterface *osm=new OSMInterface();
+        std::mt19937 rng(13);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+        vector<vector<db_t>> data;
+        vector<size_t> hashes;
+        for(int i=0; i<30;i++){
+            vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+            hashes.push_back(osm->insert(key));
+            data.push_back(key);
+        }
+        vector<vector<db_t>> batch;
+        for(int i=0; i<25;i++){
+            batch.push_back(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))});
+        }
+        vector<size_t> batchHashes=osm->insertBatch(batch);
+        data.insert(data.end(), batch.begin(), batch.end());
+        hashes.insert(hashes.end(), batchHashes.begin(), batchHashes.end());
+        for(int i=0; i<15;i++){
+            size_t pos=rng()%data.size();
+            ushort column=i%2;
+            osm->deleteEntry(data[pos][column], hashes[pos], column);
+            data.erase(data.begin()+pos);
+            hashes.erase(hashes.begin()+pos);
+        }
+        //a delete of a data point that does not exist only executes dummy updates
+        osm->deleteEntry(db_t(25), 12345, 0);
+        osm->finishMerges();
+
+        for(size_t column=0;column<2;column++){
+            for(int from : {1, 10, 40}){
+                int to=from+(int) dist(rng)%20;
+                number total;
+                tie(total, ignore)=osm->getTotalFromHistograms(db_t(from), db_t(to), column);
+                number expected=0;
+                for(size_t i=0;i<data.size();i++){
+                    if(data[i][column].val.i>=from and data[i][column].val.i<=to){
+                        expected++;
+                    }
+                }
+                ASSERT_EQ(total, expected);
+            }
+        }
+        ASSERT_EQ(osm->checkHistograms(false), 0u);
+
+        //the checker detects and repairs histograms that do not match the records
+        osm->histograms[0][1].counts[7]+=3;
+        ASSERT_EQ(osm->checkHistograms(true), 1u);
+        ASSERT_EQ(osm->checkHistograms(false), 0u);
+    }
+
+    USE_TOMBSTONES=false;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(AutoShardingTests, ChooseLayout){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    number workerPoolSizeBefore=WORKER_POOL_SIZE;
+    bool useGammaBefore=USE_GAMMA;
+    bool truncatedLaplaceBefore=USE_TRUNCATED_LAPLACE;
+    ORAM_LOG_CAPACITY=16;
+    WORKER_POOL_SIZE=4;
+    USE_GAMMA=true;
+    USE_TRUNCATED_LAPLACE=true;
+    AUTO_SHARDING=true;
+
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50);
+    NUM_DATAPOINTS=300;
+    INPUT_DATA.clear();
+    for(size_t i=0; i<NUM_DATAPOINTS;i++){
+        INPUT_DATA.push_back(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))});
+    }
+
+    OSMInterface *osm=new OSMInterface();
+    //the capacity is chosen for the data points per OSM and not taken from --logcapacity
+    ASSERT_LT(ORAM_LOG_CAPACITY, 16u);
+    ASSERT_GE(osm->numOSMs, 1u);
+    ASSERT_LE(osm->numOSMs, 16u);
+    ASSERT_GE(osm->numOSMs*osm->maxPerTree, NUM_DATAPOINTS);
+    ASSERT_EQ(osm->trees.size(), osm->numOSMs);
+    //the sanitizers used for choosing the layout are replaced by sanitizers truncated at the chosen capacity
+    ASSERT_EQ(osm->volumeSanitizers.size(), NUM_ATTRIBUTES);
+    for(size_t i=0;i<osm->numOSMs;i++){
+        ASSERT_LE(osm->trees[i]->size(), osm->maxPerTree);
+    }
+    ASSERT_GT(PREDICTED_QUERY_TIME, 0u);
+
+    AUTO_SHARDING=false;
+    PREDICTED_QUERY_TIME=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    WORKER_POOL_SIZE=workerPoolSizeBefore;
+    USE_GAMMA=useGammaBefore;
+    USE_TRUNCATED_LAPLACE=truncatedLaplaceBefore;
+}
+
+TEST(SpareOSMTests, RolloverToSpare){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=4;
+    USE_GAMMA=true;
+    USE_SPARE_OSM=true;
+    SPARE_OSM_THRESHOLD=0.5;
+
+    OSMInterface *osm=new OSMInterface();
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+    vector<vector<db_t>> data;
+    for(int i=0; i<40;i++){
+        vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+        osm->insert(key);
+        data.push_back(key);
+    }
+    vector<vector<db_t>> batch;
+    for(int i=0; i<20;i++){
+        batch.push_back(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))});
+    }
+    osm->insertBatch(batch);
+    data.insert(data.end(), batch.begin(), batch.end());
+
+    //the spare OSMs are only appended once the last OSM is full
+    ASSERT_EQ(osm->numOSMs, 4u);
+    ASSERT_EQ(osm->trees.size(), osm->numOSMs);
+    ASSERT_EQ(osm->histograms.size(), osm->numOSMs);
+    for(size_t i=0;i<osm->numOSMs-1;i++){
+        ASSERT_EQ(osm->trees[i]->size(), osm->maxPerTree);
+    }
+    ASSERT_EQ(osm->trees.back()->size(), data.size()-3*osm->maxPerTree);
+
+    DBT::dbResponse returned=osm->findInterval(db_t(1), db_t(50), 0, vector<number>(osm->numOSMs, 1));
+    multiset<int> expected;
+    for (size_t j = 0; j < data.size(); j++){
+        expected.insert(data[j][0].val.i);
+    }
+    multiset<int> real;
+    for (size_t j = 0; j < returned.size(); j++){
+        auto[keys, dummy]=returned[j];
+        if(!dummy){
+            real.insert(keys[0].val.i);
+        }
+    }
+    ASSERT_EQ(real, expected);
+    delete osm;
+
+    USE_SPARE_OSM=false;
+    SPARE_OSM_THRESHOLD=0.75;
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(GrowTests, GrowORAM){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    vector<AType> thisFormat {AType::INT, AType::INT};
+    size_t sizeValue=0;
+    vector<INDEX_MODE_T> indexModes{AVL_ONLY, LEAF_PAGES, RANK_LAYOUT};
+    for(INDEX_MODE_T indexMode : indexModes){
+        std::mt19937 rng(6);
+        std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+        vector<vector<db_t>> emptyData;
+        AVLTree *tree=new DOSM::AVLTree(thisFormat, sizeValue, 4, ORAM_Z, STASH_FACTOR, BATCH_SIZE, &emptyData, 0, true, indexMode);
+        ASSERT_EQ(tree->getCapacity(), 15u);
+
+        vector<vector<db_t>> data;
+        for (size_t round = 0; round < 3; round++){
+            while(data.size()<tree->getCapacity()){
+                vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+                tree->insert(key);
+                data.push_back(key);
+            }
+            //the nodes inserted before are still found after growing
+            tree->growORAM();
+            ASSERT_EQ(tree->getORAMLogCapacity(), 5+round);
+            ASSERT_EQ(tree->getCapacity(), (1ull << (5+round))-1);
+            checkIntervalAgainstData(tree, data, db_t(1), db_t(50), round%2, 2);
+        }
+        for (size_t q = 0; q < 4; q++){
+            db_t lower=db_t((int) dist(rng));
+            db_t upper=db_t((int) dist(rng));
+            if(upper<lower)swap(lower,upper);
+            checkIntervalAgainstData(tree, data, lower, upper, q%2, 1+dist(rng)%10);
+        }
+        delete tree;
+    }
+}
+
+TEST(GrowTests, GrowLastOSM){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=4;
+    GROW_LOG_CAPACITY=6;
+    USE_GAMMA=true;
+
+    OSMInterface *osm=new OSMInterface();
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+    vector<vector<db_t>> data;
+    for(int i=0; i<40;i++){
+        vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+        osm->insert(key);
+        data.push_back(key);
+    }
+    vector<vector<db_t>> batch;
+    for(int i=0; i<30;i++){
+        batch.push_back(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))});
+    }
+    osm->insertBatch(batch);
+    data.insert(data.end(), batch.begin(), batch.end());
+
+    //the first OSM grows from 15 to 63 data points before the second one is created
+    ASSERT_EQ(osm->numOSMs, 2u);
+    ASSERT_EQ(osm->trees[0]->getORAMLogCapacity(), 6u);
+    ASSERT_EQ(osm->trees[0]->size(), 63u);
+    ASSERT_EQ(osm->trees[1]->size(), data.size()-63);
+    ASSERT_EQ(osm->maxPerTree, 63u);
+
+    DBT::dbResponse returned=osm->findInterval(db_t(1), db_t(50), 1, vector<number>(osm->numOSMs, 1));
+    multiset<int> expected;
+    for (size_t j = 0; j < data.size(); j++){
+        expected.insert(data[j][1].val.i);
+    }
+    multiset<int> real;
+    for (size_t j = 0; j < returned.size(); j++){
+        auto[keys, dummy]=returned[j];
+        if(!dummy){
+            real.insert(keys[1].val.i);
+        }
+    }
+    ASSERT_EQ(real, expected);
+
+    GROW_LOG_CAPACITY=0;
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(CompactionTests, MergeUnderfullOSMs){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=5;
+    USE_GAMMA=false;
+    COMPACTION_FILL_RATIO=0.5;
+
+    OSMInterface *osm=new OSMInterface();
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+    vector<vector<db_t>> data;
+    vector<size_t> hashes;
+    for(int i=0; i<90;i++){
+        vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+        hashes.push_back(osm->insert(key));
+        data.push_back(key);
+    }
+    ASSERT_EQ(osm->numOSMs, 3u);
+
+    //deleting two thirds of the records leaves the OSMs underfull, so they are merged
+    for(int i=0; i<60;i++){
+        size_t pos=rng()%data.size();
+        ushort column=i%2;
+        osm->deleteEntry(data[pos][column], hashes[pos], column);
+        data.erase(data.begin()+pos);
+        hashes.erase(hashes.begin()+pos);
+    }
+    osm->finishMerges();
+    ASSERT_LT(osm->numOSMs, 3u);
+    ASSERT_EQ(osm->volumeSanitizers.size(), osm->numOSMs*NUM_ATTRIBUTES);
+    number stored=0;
+    for(size_t i=0;i<osm->numOSMs;i++){
+        stored+=osm->trees[i]->size();
+    }
+    ASSERT_EQ(stored, data.size());
+
+    for (size_t q = 0; q < 6; q++){
+        db_t lower=db_t((int) dist(rng));
+        db_t upper=db_t((int) dist(rng));
+        if(upper<lower)swap(lower,upper);
+        ushort column=q%2;
+        DBT::dbResponse returned=osm->findInterval(lower, upper, column, vector<number>(osm->numOSMs, 1));
+
+        multiset<int> expected;
+        for (size_t j = 0; j < data.size(); j++){
+            if(data[j][column]>=lower and data[j][column] <= upper){
+                expected.insert(data[j][column].val.i);
+            }
+        }
+        multiset<int> real;
+        for (size_t j = 0; j < returned.size(); j++){
+            auto[keys, dummy]=returned[j];
+            if(!dummy){
+                real.insert(keys[column].val.i);
+            }
+        }
+        ASSERT_EQ(real, expected);
+    }
+
+    COMPACTION_FILL_RATIO=0.0;
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
+TEST(HandleTests, DeleteWithHandle){
+    extern LOG_LEVEL CURRENT_LEVEL;
+    CURRENT_LEVEL=WARNING;
+
+    COLUMN_FORMAT={AType::INT, AType::INT};
+    NUM_ATTRIBUTES=2;
+    MIN_VALUE={db_t(0), db_t(0)};
+    MAX_VALUE={db_t(50), db_t(50)};
+    DATA_RESOLUTION={db_t(1), db_t(1)};
+    VALUE_SIZE=0;
+    NUM_DATAPOINTS=0;
+    INPUT_DATA.clear();
+    number logCapacityBefore=ORAM_LOG_CAPACITY;
+    bool useGammaBefore=USE_GAMMA;
+    ORAM_LOG_CAPACITY=4;
+    USE_GAMMA=true;
+    USE_SHARD_HANDLES=true;
+
+    OSMInterface *osm=new OSMInterface();
+    std::mt19937 rng(8);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(1,50); //key 0 equals the key of the NULL node
+    vector<vector<db_t>> data;
+    vector<RecordHandle> handles;
+    for(int i=0; i<30;i++){
+        vector<db_t> key{db_t((int) dist(rng)), db_t((int) dist(rng))};
+        handles.push_back(osm->insertWithHandle(key));
+        data.push_back(key);
+    }
+    vector<vector<db_t>> batch;
+    for(int i=0; i<25;i++){
+        batch.push_back(vector<db_t>{db_t((int) dist(rng)), db_t((int) dist(rng))});
+    }
+    vector<RecordHandle> batchHandles=osm->insertBatchWithHandles(batch);
+    data.insert(data.end(), batch.begin(), batch.end());
+    handles.insert(handles.end(), batchHandles.begin(), batchHandles.end());
+    ASSERT_EQ(osm->numOSMs, 4u);
+
+    //a modified handle is rejected
+    RecordHandle forged=handles[0];
+    forged.sealedOSM[AES_BLOCK_SIZE]^=1;
+    osm->deleteEntry(data[0][0], forged, 0);
+    forged=handles[0];
+    forged.nodeHash=handles[1].nodeHash;
+    osm->deleteEntry(data[0][0], forged, 0);
+
+    for(int i=0; i<20;i++){
+        size_t pos=rng()%data.size();
+        ushort column=i%2;
+        osm->deleteEntry(data[pos][column], handles[pos], column);
+        data.erase(data.begin()+pos);
+        handles.erase(handles.begin()+pos);
+    }
+    number stored=0;
+    for(size_t i=0;i<osm->numOSMs;i++){
+        stored+=osm->trees[i]->size();
+    }
+    ASSERT_EQ(stored, data.size());
+
+    for(ushort column=0; column<2; column++){
+        DBT::dbResponse returned=osm->findInterval(db_t(1), db_t(50), column, vector<number>(osm->numOSMs, 1));
+        multiset<int> expected;
+        for (size_t j = 0; j < data.size(); j++){
+            expected.insert(data[j][column].val.i);
+        }
+        multiset<int> real;
+        for (size_t j = 0; j < returned.size(); j++){
+            auto[keys, dummy]=returned[j];
+            if(!dummy){
+                real.insert(keys[column].val.i);
+            }
+        }
+        ASSERT_EQ(real, expected);
+    }
+
+    USE_SHARD_HANDLES=false;
+    ORAM_LOG_CAPACITY=logCapacityBefore;
+    USE_GAMMA=useGammaBefore;
+}
+
 int main(int argc, char ** argv) {
     //testing::InitGoogleMock(&__argc, __argv);
     testing::InitGoogleTest(&argc,argv);